@@ -33,12 +33,35 @@
 #include <stdio.h>
 #include <string.h>
 #include "nt3h.h"
+#include "ntag_defs.h"
+
+#ifdef NT3H_ENABLE_LOG
+/*
+ * Memory fences ordering log entry accesses against the head/tail indices.
+ * Define NT3H_LOG_ACQUIRE()/NT3H_LOG_RELEASE() to override, e.g. with a
+ * platform barrier on compilers without C11 atomics or GCC builtins.
+ */
+#if !defined(NT3H_LOG_ACQUIRE) || !defined(NT3H_LOG_RELEASE)
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define NT3H_LOG_ACQUIRE()  atomic_thread_fence(memory_order_acquire)
+#define NT3H_LOG_RELEASE()  atomic_thread_fence(memory_order_release)
+#elif defined(__GNUC__)
+#define NT3H_LOG_ACQUIRE()  __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define NT3H_LOG_RELEASE()  __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#error "Define NT3H_LOG_ACQUIRE() and NT3H_LOG_RELEASE() as memory barriers for this compiler"
+#endif
+#endif
+#endif
 
 /* NT3H specific definitions */
 #define NT3H_I2C_MEM_BLOCK_SIZE      16     /* Number of bytes in I2C memory block */
 #define NT3H_SRAM_ADDRESS            0xF8   /* Memory address of SRAM region */
 #define NT3H_SRAM_LENGTH             64     /* Length of SRAM region */
 #define NT3H_MEMORY_ERASE_VALUE      0x00U  /* Value used to erase memory */
+#define NT3H_SYNC_BLOCKS             8      /* Blocks compared per bulk read when formatting */
+#define NT3H_NUM_REGS                8      /* Number of session/configuration registers */
 
 /* Capability Container field masks */
 #define CAPABILITY_MAGIC_NUM    0xFF000000U
@@ -85,6 +108,95 @@ static nt3h_status_t read_blocks(nt3h_dev_t *dev, uint8_t addr, nt3h_block_t *bl
  */
 static nt3h_status_t write_blocks(nt3h_dev_t *dev, uint8_t addr, const nt3h_block_t *block, uint8_t cnt);
 
+/*!
+ * @brief This internal API writes block(s) of data to NT3H memory, optionally
+ * leaving the caller to wait for the last program to complete.
+ *
+ * @param[in]    dev : Pointer to NT3H device structure.
+ * @param[in]   addr : Memory address to write blocks.
+ * @param[in]  block : Pointer to memory location containing blocks to write.
+ * @param[in]    cnt : Number of blocks to write.
+ * @param[in]   wait : Wait for each block to complete, else return once the
+ *                     last block is sent.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t program_blocks(nt3h_dev_t *dev, uint8_t addr, const nt3h_block_t *block, uint8_t cnt,
+                                    bool wait);
+
+/*!
+ * @brief This internal API programs the blocks of a region that differ from
+ * their target contents, merging consecutive differing blocks into one write.
+ *
+ * @param[in]    dev : Pointer to NT3H device structure.
+ * @param[in]   addr : First block of region.
+ * @param[in] target : Target contents.
+ * @param[in]    cnt : Number of blocks, at most NT3H_SYNC_BLOCKS.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t sync_blocks(nt3h_dev_t *dev, uint8_t addr, const nt3h_block_t *target, uint8_t cnt);
+
+/*!
+ * @brief This internal API programs the static lock bytes and capability
+ * container of block 0 if they differ from their target contents.
+ *
+ * @note Only bytes 10 to 15 read back as written. Byte 0 is written with
+ *       dev->i2c_addr so the tag keeps its address, bytes 1 to 9 are
+ *       written back as read and ignored by the device.
+ *
+ * @param[in]    dev : Pointer to NT3H device structure.
+ * @param[in] target : Target block 0, of which bytes 10 to 15 are used.
+ *
+ * @return Result of API execution status, NT3H_E_INVALID_ARGS if block 0
+ *         must be written and dev->i2c_addr is 0.
+ */
+static nt3h_status_t sync_block_0(nt3h_dev_t *dev, const uint8_t *target);
+
+/*!
+ * @brief Internal implementations of the instrumented public APIs.
+ */
+static nt3h_status_t read_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, uint8_t *data, size_t len);
+static nt3h_status_t write_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, uint8_t *data, size_t len);
+static nt3h_status_t write_bytes_resume(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, const uint8_t *data,
+                                        size_t len, size_t *progress);
+static nt3h_status_t erase_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, size_t len);
+static nt3h_status_t read_register(nt3h_dev_t *dev, uint8_t reg, uint8_t *data);
+static nt3h_status_t write_register(nt3h_dev_t *dev, uint8_t reg, uint8_t mask, uint8_t data);
+static nt3h_status_t read_config(nt3h_dev_t *dev, uint8_t reg, uint8_t *data);
+static nt3h_status_t write_config(nt3h_dev_t *dev, uint8_t reg, uint8_t mask, uint8_t data);
+static nt3h_status_t read_blocks_locked(nt3h_dev_t *dev, uint8_t addr, uint8_t *data, uint8_t cnt);
+static nt3h_status_t write_blocks_locked(nt3h_dev_t *dev, uint8_t addr, const uint8_t *data, uint8_t cnt);
+static nt3h_status_t write_block_start(nt3h_dev_t *dev, uint8_t addr, const uint8_t *data);
+static nt3h_status_t write_busy(nt3h_dev_t *dev, bool *busy);
+static nt3h_status_t init(nt3h_dev_t *dev);
+static nt3h_status_t deinit(nt3h_dev_t *dev);
+static nt3h_status_t factory_reset(nt3h_dev_t *dev, bool is_2k);
+static nt3h_status_t format(nt3h_dev_t *dev, bool is_2k);
+static nt3h_status_t snapshot(nt3h_dev_t *dev, bool is_2k, nt3h_snapshot_t *snap);
+static nt3h_status_t restore(nt3h_dev_t *dev, const nt3h_snapshot_t *snap);
+static nt3h_status_t field_present(nt3h_dev_t *dev, bool *is_field_present);
+static nt3h_status_t check(nt3h_dev_t *dev);
+static nt3h_status_t lock_acquire(nt3h_dev_t *dev);
+static nt3h_status_t lock_release(nt3h_dev_t *dev);
+static nt3h_status_t set_watchdog_us(nt3h_dev_t *dev, nt3h_reg_space_t space, uint32_t period_us);
+static nt3h_status_t get_watchdog_us(nt3h_dev_t *dev, nt3h_reg_space_t space, uint32_t *period_us);
+static nt3h_status_t watchdog_autotune(nt3h_dev_t *dev, uint32_t margin_pct, uint32_t *period_us);
+static nt3h_status_t set_clock_stretch(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable);
+static nt3h_status_t get_clock_stretch(nt3h_dev_t *dev, nt3h_reg_space_t space, bool *enable);
+static nt3h_status_t set_pass_through(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable);
+static nt3h_status_t set_transfer_dir(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_transfer_dir_t dir);
+static nt3h_status_t set_fd_mode(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_fd_off_t fd_off, nt3h_fd_on_t fd_on);
+static nt3h_status_t set_sram_mirror(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable);
+static nt3h_status_t write_fields(nt3h_dev_t *dev, nt3h_reg_space_t space, const nt3h_field_value_t *fields,
+                                  size_t cnt);
+static nt3h_status_t read_field(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_field_t field, uint8_t *value);
+#ifdef NT3H_ENABLE_LOG
+static nt3h_status_t log_session_registers(nt3h_dev_t *dev);
+static nt3h_status_t log_config_registers(nt3h_dev_t *dev);
+static nt3h_status_t log_memory(nt3h_dev_t *dev, uint8_t addr, uint8_t cnt);
+#endif
+
 /*!
  * @bried This internal API is used to calculate the number of blocks needed
  * in a r/w operation to ensure all memory regions are covered.
@@ -101,10 +213,279 @@ static size_t calculate_blocks_needed(uint16_t offset, size_t len);
  */
 static nt3h_status_t null_ptr_check(nt3h_dev_t *dev);
 
+/*!
+ * @brief This internal API acquires the memory lock on behalf of a
+ * multi-block operation, if auto locking is enabled and not already held.
+ *
+ * @param[in]     dev : Pointer to NT3H device structure.
+ * @param[out] locked : Set true if the lock was acquired by this call.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t auto_lock_begin(nt3h_dev_t *dev, bool *locked);
+
+/*!
+ * @brief This internal API releases a lock taken by auto_lock_begin().
+ *
+ * @param[in]    dev : Pointer to NT3H device structure.
+ * @param[in] locked : Lock was acquired by auto_lock_begin().
+ * @param[in]   rslt : Status of the operation performed under the lock.
+ *
+ * @return Status of the operation, or of the release if the operation succeeded.
+ */
+static nt3h_status_t auto_lock_end(nt3h_dev_t *dev, bool locked, nt3h_status_t rslt);
+
+/*!
+ * @brief This internal API reads a register from either register space.
+ *
+ * @param[in]    dev : Pointer to NT3H device structure.
+ * @param[in]  space : Session or configuration registers.
+ * @param[in]    reg : Register offset.
+ * @param[out]  data : Pointer to store register value.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t read_reg_space(nt3h_dev_t *dev, nt3h_reg_space_t space, uint8_t reg, uint8_t *data);
+
+/*!
+ * @brief This internal API updates the bits selected by mask in a register of
+ * either register space, leaving the other bits untouched.
+ *
+ * @param[in]    dev : Pointer to NT3H device structure.
+ * @param[in]  space : Session or configuration registers.
+ * @param[in]    reg : Register offset.
+ * @param[in]   mask : Bits to update.
+ * @param[in]   data : New value of the masked bits.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t write_reg_space(nt3h_dev_t *dev, nt3h_reg_space_t space, uint8_t reg, uint8_t mask, uint8_t data);
+
+/*!
+ * @brief This internal API returns the bit position of the lowest set bit of a field mask.
+ */
+static uint8_t field_shift(uint8_t mask);
+
+/*!
+ * @brief This internal API applies the wear budget before EEPROM block programs.
+ *
+ * @note In reject mode credit for all n programs is taken at once or not
+ *       at all, so a multi-block write is refused before anything is
+ *       programmed. In delay mode it is called once per program.
+ *
+ * @param[in] dev : Pointer to NT3H device structure.
+ * @param[in]   n : Number of programs to reserve.
+ *
+ * @return NT3H_E_WRITE_BUDGET if the programs must be rejected.
+ */
+static nt3h_status_t wear_budget(nt3h_dev_t *dev, uint8_t n);
+
+/*!
+ * @brief This internal API accounts for a completed EEPROM block program.
+ *
+ * @param[in]  dev : Pointer to NT3H device structure.
+ * @param[in] addr : Block address programmed.
+ */
+static void wear_account(nt3h_dev_t *dev, uint8_t addr);
+
+/*!
+ * @brief This internal API finds the remap entry of a logical block.
+ *
+ * @param[in]  dev : Pointer to NT3H device structure.
+ * @param[in] addr : Logical block address.
+ *
+ * @return Pointer to entry, or NULL if the block is not remapped.
+ */
+static nt3h_remap_entry_t *remap_find(nt3h_dev_t *dev, uint8_t addr);
+
+/*!
+ * @brief This internal API picks the physical block to program for a logical block.
+ *
+ * @param[in]    dev : Pointer to NT3H device structure.
+ * @param[in]   addr : Logical block address.
+ * @param[out] entry : Remap entry of the block, NULL if not remapped.
+ *
+ * @return Physical block address.
+ */
+static uint8_t remap_write_target(nt3h_dev_t *dev, uint8_t addr, nt3h_remap_entry_t **entry);
+
+/*!
+ * @brief This internal API records a completed program of a remapped block.
+ *
+ * @param[in]      dev : Pointer to NT3H device structure.
+ * @param[in]    entry : Remap entry of the block, or NULL.
+ * @param[in] physical : Physical block programmed.
+ */
+static void remap_written(nt3h_dev_t *dev, nt3h_remap_entry_t *entry, uint8_t physical);
+
+/*!
+ * @brief This internal API counts the blocks from an address up to the first
+ * spare block of the attached remap table.
+ *
+ * @param[in]  dev : Pointer to NT3H device structure.
+ * @param[in] addr : First block address.
+ * @param[in]  max : Most blocks to count.
+ *
+ * @return Number of blocks before the first spare, max if none is in range.
+ */
+static uint8_t remap_run(const nt3h_dev_t *dev, uint8_t addr, uint8_t max);
+
+/*!
+ * @brief This internal API performs a single bus write transaction.
+ *
+ * @param[in]  dev : Pointer to NT3H device structure.
+ * @param[in] addr : Memory block address targeted, for instrumentation.
+ * @param[in] data : Bytes to send, starting with the memory address.
+ * @param[in]  len : Number of bytes to send.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t bus_write(nt3h_dev_t *dev, uint16_t addr, uint8_t *data, size_t len);
+
+/*!
+ * @brief This internal API performs a single bus read transaction.
+ *
+ * @param[in]   dev : Pointer to NT3H device structure.
+ * @param[in]  addr : Memory block address targeted, for instrumentation.
+ * @param[out] data : Buffer to store received bytes.
+ * @param[in]   len : Number of bytes to read.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t bus_read(nt3h_dev_t *dev, uint16_t addr, uint8_t *data, size_t len);
+
+/*!
+ * @brief This internal API waits for the given period using the user delay function.
+ *
+ * @param[in]       dev : Pointer to NT3H device structure.
+ * @param[in] period_ms : Time to wait, in ms.
+ */
+static void delay_ms(nt3h_dev_t *dev, uint32_t period_ms);
+
+/*!
+ * @brief This internal API waits for the given period using the finest
+ * wait primitive the user provided.
+ *
+ * @note Uses delay_us if set, else yields until time_us shows the period
+ *       has elapsed, else delay_ms rounded up to whole ms.
+ *
+ * @param[in]       dev : Pointer to NT3H device structure.
+ * @param[in] period_us : Time to wait, in us.
+ */
+static void delay_us(nt3h_dev_t *dev, uint32_t period_us);
+
+/*!
+ * @brief This internal API checks whether the driver is able to wait at all.
+ */
+static bool can_delay(const nt3h_dev_t *dev);
+
+/*!
+ * @brief This internal API waits for an EEPROM block program to complete,
+ * polling EEPROM_WR_BUSY around the calibrated program time.
+ *
+ * @param[in] dev : Pointer to NT3H device structure.
+ *
+ * @return Result of API execution status, NT3H_E_TIMEOUT if the device is
+ *         still busy after NTAG_MAX_WRITE_DELAY_MS.
+ */
+static nt3h_status_t eeprom_wait(nt3h_dev_t *dev);
+
+/*!
+ * @brief This internal API decides whether to retry a bus transaction,
+ * waiting out the backoff and updating the retry statistics.
+ *
+ * @param[in]         dev : Pointer to NT3H device structure.
+ * @param[in]        rslt : Result of the last attempt.
+ * @param[in,out] attempt : Retries made so far, 0 before the first.
+ *
+ * @return True if the transaction should be attempted again.
+ */
+static bool retry_wait(nt3h_dev_t *dev, nt3h_status_t rslt, uint8_t *attempt);
+
+#ifdef NT3H_ENABLE_LOG
+/*!
+ * @brief This internal API appends an event to the device debug log, if attached.
+ *
+ * @note Never blocks: the event is dropped if the ring is full.
+ */
+static void log_event(nt3h_dev_t *dev, nt3h_log_event_t id, uint16_t arg0, uint32_t arg1, uint32_t arg2);
+
+/*!
+ * @brief This internal API logs 8 bytes packed into arg1/arg2, least significant byte first.
+ */
+static void log_bytes(nt3h_dev_t *dev, nt3h_log_event_t id, uint16_t arg0, const uint8_t *bytes);
+
+#define LOG_EVENT(dev, id, arg0, arg1, arg2)    log_event((dev), (id), (arg0), (arg1), (arg2))
+#else
+#define LOG_EVENT(dev, id, arg0, arg1, arg2)    ((void)0)
+#endif
+
+#ifdef NT3H_ENABLE_TRACE
+/*!
+ * @brief This internal API appends a transport call to the device trace, if attached.
+ *
+ * @param[in]    dev : Pointer to NT3H device structure.
+ * @param[in]   read : Transaction direction.
+ * @param[in]   data : Bytes written or read.
+ * @param[in]    len : Number of bytes.
+ * @param[in]   rslt : Transport status.
+ */
+static void trace_record(nt3h_dev_t *dev, bool read, const uint8_t *data, size_t len, nt3h_status_t rslt);
+#endif
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+/*!
+ * @brief This internal API reports the start of an operation.
+ *
+ * @return Start timestamp, in us.
+ */
+static uint32_t instr_begin(nt3h_dev_t *dev, nt3h_op_t op, uint16_t addr, size_t len);
+
+/*!
+ * @brief This internal API reports the end of an operation and updates counters.
+ *
+ * @return Result of the operation, unchanged.
+ */
+static nt3h_status_t instr_end(nt3h_dev_t *dev, nt3h_op_t op, uint16_t addr, size_t len,
+                               uint32_t start_us, nt3h_status_t rslt);
+
+/*!
+ * @brief This internal API records a block latency sample if histograms are enabled.
+ */
+static void instr_block_latency(nt3h_dev_t *dev, nt3h_lat_class_t cls, uint32_t start_us);
+
+/* Timestamp for block latency samples, zero if no clock is available */
+#define INSTR_NOW(dev)  (((dev)->time_us != NULL) ? (dev)->time_us() : 0)
+
+/* Report start and end of a public API call around its implementation */
+#define INSTR_API_RETURN(dev, op, addr, len, call)                      \
+    do {                                                                \
+        uint32_t start_us = instr_begin((dev), (op), (addr), (len));    \
+        nt3h_status_t api_rslt = (call);                                \
+        if ((dev) != NULL)                                              \
+        {                                                               \
+            (dev)->instr.counters.api_calls++;                          \
+            if (api_rslt != NT3H_OK)                                    \
+                (dev)->instr.counters.api_errors++;                     \
+        }                                                               \
+        return instr_end((dev), (op), (addr), (len), start_us, api_rslt); \
+    } while (0)
+#else
+#define INSTR_API_RETURN(dev, op, addr, len, call)  return (call)
+#endif
+
 /*!
  * @brief This API intialises NT3H NFC device.
  */
 nt3h_status_t nt3h_init(nt3h_dev_t *dev)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_INIT, 0, 0, init(dev));
+}
+
+/*!
+ * @brief This internal API intialises NT3H NFC device.
+ */
+static nt3h_status_t init(nt3h_dev_t *dev)
 {
     nt3h_status_t rslt;
 
@@ -113,7 +494,11 @@ nt3h_status_t nt3h_init(nt3h_dev_t *dev)
         return rslt;
 
     /* Check if device is responding */
-    if ((rslt = nt3h_check(dev)) != NT3H_OK)
+    rslt = check(dev);
+
+    LOG_EVENT(dev, NT3H_EVT_INIT, rslt, 0, 0);
+
+    if (rslt != NT3H_OK)
         return rslt;
 
     // capability_cont_t cc;
@@ -143,6 +528,14 @@ nt3h_status_t nt3h_init(nt3h_dev_t *dev)
  * @brief This API de-intialises NT3H NFC device.
  */
 nt3h_status_t nt3h_deinit(nt3h_dev_t *dev)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_DEINIT, 0, 0, deinit(dev));
+}
+
+/*!
+ * @brief This internal API de-intialises NT3H NFC device.
+ */
+static nt3h_status_t deinit(nt3h_dev_t *dev)
 {
     nt3h_status_t rslt;
 
@@ -153,141 +546,530 @@ nt3h_status_t nt3h_deinit(nt3h_dev_t *dev)
     return rslt;
 }
 
-nt3h_status_t nt3h_factory_reset(nt3h_dev_t *dev)
+/*!
+ * @brief This API restores the factory values of block 0 and the
+ * configuration blocks.
+ */
+nt3h_status_t nt3h_factory_reset(nt3h_dev_t *dev, bool is_2k)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_FACTORY_RESET, 0, 0, factory_reset(dev, is_2k));
+}
+
+/*!
+ * @brief This internal API restores the factory values of block 0 and the
+ * configuration blocks.
+ */
+static nt3h_status_t factory_reset(nt3h_dev_t *dev, bool is_2k)
 {
     nt3h_status_t rslt;
+    bool locked;
+    nt3h_block_t block_0 = factory_value_block_0;
+    const nt3h_block_t config[3] = { factory_value_block_56, factory_value_block_57, factory_value_block_58 };
+    uint8_t config_block = is_2k ? NTAG_MEM_BLOCK_CONFIGURATION_2k : NTAG_MEM_BLOCK_CONFIGURATION_1k;
+
+    /* The capability container gives the variant's NDEF memory size */
+    block_0.data[NT3H_CC_MLEN_OFFSET] = is_2k ? NT3H_CC_MLEN_2K : NT3H_CC_MLEN_1K;
     
     /* Check for null pointer in device structure */
     if ((rslt = null_ptr_check(dev)) != NT3H_OK)
         return rslt;
 
-    if((rslt = write_blocks(dev, 0, &factory_value_block_0, 1)) != NT3H_OK)
+    if ((rslt = auto_lock_begin(dev, &locked)) != NT3H_OK)
         return rslt;
 
-    if((rslt = write_blocks(dev, 56, &factory_value_block_56, 1)) != NT3H_OK)
-        return rslt;
+    rslt = sync_block_0(dev, block_0.data);
 
-    if((rslt = write_blocks(dev, 57, &factory_value_block_57, 1)) != NT3H_OK)
-        return rslt;
+    if (rslt == NT3H_OK)
+        rslt = sync_blocks(dev, (uint8_t)(config_block - 2), config, 3);
 
-    if((rslt = write_blocks(dev, 58, &factory_value_block_58, 1)) != NT3H_OK)
-        return rslt;
+    return auto_lock_end(dev, locked, rslt);
+}
 
-    return rslt;
+/*!
+ * @brief This API blanks user memory, leaving an empty NDEF message.
+ */
+nt3h_status_t nt3h_format(nt3h_dev_t *dev, bool is_2k)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_FORMAT, 0, 0, format(dev, is_2k));
 }
 
 /*!
- * @brief This API reads a number of bytes from NT3H memory.
+ * @brief This internal API blanks user memory, leaving an empty NDEF message.
  */
-nt3h_status_t nt3h_read_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, uint8_t *data, size_t len)
+static nt3h_status_t format(nt3h_dev_t *dev, bool is_2k)
 {
     nt3h_status_t rslt;
+    nt3h_block_t target[NT3H_SYNC_BLOCKS];
+    const uint8_t empty_ndef[] = NT3H_EMPTY_NDEF_TLV;
+    bool locked;
 
     /* Check for null pointer in device structure */
     if ((rslt = null_ptr_check(dev)) != NT3H_OK)
         return rslt;
 
-    /* Check parameters are valid */
-    if (data == NULL || len == 0)
-        return NT3H_E_INVALID_ARGS;
+    uint8_t n_blocks = is_2k ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
 
-    /* Remove any redundant offset if offset is greater than a block length */
-    /* Incremembet address by number of blocks and subtract offset by byte equivalent */
-    addr   += (offset / NT3H_I2C_MEM_BLOCK_SIZE);
-    offset -= (offset / NT3H_I2C_MEM_BLOCK_SIZE) * NT3H_I2C_MEM_BLOCK_SIZE;
+    if ((rslt = auto_lock_begin(dev, &locked)) != NT3H_OK)
+        return rslt;
 
-    /* Calculate the number of blocks needed to cover this r/w operation. */
-    uint8_t blocks_needed = calculate_blocks_needed(offset, len);
-    
-    nt3h_block_t blocks[blocks_needed];
+    /* Logical blocks only, remap spares are skipped */
+    for (uint8_t base = 0; base < n_blocks && rslt == NT3H_OK; )
+    {
+        uint8_t addr = (uint8_t)(NTAG_MEM_BLOCK_START_USER_MEMORY + base);
+        uint8_t cnt = (uint8_t)((n_blocks - base < NT3H_SYNC_BLOCKS) ? n_blocks - base : NT3H_SYNC_BLOCKS);
 
-    if ((rslt = read_blocks(dev, addr, blocks, blocks_needed)) != NT3H_OK)
-        return rslt;
+        if ((cnt = remap_run(dev, addr, cnt)) == 0)
+        {
+            base++;
+            continue;
+        }
 
-    uint8_t *ptr = ((uint8_t *)blocks) + offset;
-    memcpy(data, ptr, len);
+        memset(target, NT3H_MEMORY_ERASE_VALUE, sizeof(target));
 
-    return rslt;
+        if (base == 0)
+            memcpy(target[0].data, empty_ndef, sizeof(empty_ndef));
+
+        rslt = sync_blocks(dev, addr, target, cnt);
+        base += cnt;
+    }
+
+    return auto_lock_end(dev, locked, rslt);
 }
 
 /*!
- * @brief This API write a number of bytes to NT3H memory.
+ * @brief This API captures all I2C readable memory of a tag.
  */
-nt3h_status_t nt3h_write_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, uint8_t *data, size_t len)
+nt3h_status_t nt3h_snapshot(nt3h_dev_t *dev, bool is_2k, nt3h_snapshot_t *snap)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_SNAPSHOT, 0, 0, snapshot(dev, is_2k, snap));
+}
+
+/*!
+ * @brief This internal API captures all I2C readable memory of a tag.
+ */
+static nt3h_status_t snapshot(nt3h_dev_t *dev, bool is_2k, nt3h_snapshot_t *snap)
 {
     nt3h_status_t rslt;
+    bool locked;
 
     /* Check for null pointer in device structure */
     if ((rslt = null_ptr_check(dev)) != NT3H_OK)
         return rslt;
 
-    /*!! Check addresses are within bounds !! */
-    if (data == NULL || len == 0)
-        return NT3H_E_INVALID_ARGS;
-
-    /* Remove any redundant offset if offset is greater than a block length */
-    /* Incremembet address by number of blocks and subtract offset by byte equivalent */
-    addr   += (offset / NT3H_I2C_MEM_BLOCK_SIZE);
-    offset -= (offset / NT3H_I2C_MEM_BLOCK_SIZE) * NT3H_I2C_MEM_BLOCK_SIZE;
+    if (snap == NULL)
+        return NT3H_E_NULL_PTR;
 
-    /* Calculate the number of blocks needed to cover this r/w operation. */
-    uint8_t blocks_needed = calculate_blocks_needed(offset, len);
+    uint8_t n_user = is_2k ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+    uint8_t config = is_2k ? NTAG_MEM_BLOCK_CONFIGURATION_2k : NTAG_MEM_BLOCK_CONFIGURATION_1k;
 
-    nt3h_block_t blocks[blocks_needed];
+    memset(snap, 0, sizeof(*snap));
+    snap->is_2k = is_2k;
 
-    if ((rslt = read_blocks(dev, addr, blocks, blocks_needed)) != NT3H_OK)
+    if ((rslt = auto_lock_begin(dev, &locked)) != NT3H_OK)
         return rslt;
 
-    uint8_t *ptr = ((uint8_t *)blocks) + offset;
-    memcpy(ptr, data, len);
+    /* One address write and one 16 byte read per block, the most the device returns per read */
+    rslt = read_blocks(dev, 0, (nt3h_block_t *)snap->block0, 1);
 
-    if ((rslt = write_blocks(dev, addr, blocks, blocks_needed)) != NT3H_OK)
-        return rslt;
+    /* Logical blocks only, remap spares are left zeroed */
+    for (uint8_t base = 0; base < n_user && rslt == NT3H_OK; )
+    {
+        uint8_t addr = (uint8_t)(NTAG_MEM_BLOCK_START_USER_MEMORY + base);
+        uint8_t cnt = remap_run(dev, addr, (uint8_t)(n_user - base));
 
-    return rslt;
+        if (cnt == 0)
+        {
+            base++;
+            continue;
+        }
+
+        rslt = read_blocks(dev, addr, (nt3h_block_t *)snap->user[base], cnt);
+        base += cnt;
+    }
+
+    if (rslt == NT3H_OK)
+        rslt = read_blocks(dev, config, (nt3h_block_t *)snap->config, 1);
+
+    for (uint8_t reg = 0; reg < NT3H_NUM_REGS && rslt == NT3H_OK; reg++)
+        rslt = read_register(dev, reg, &snap->session[reg]);
+
+    return auto_lock_end(dev, locked, rslt);
 }
 
 /*!
- * @brief This API erases a number of bytes in NT3H memory.
+ * @brief This API writes a snapshot back to a tag, programming only blocks that differ.
  */
-nt3h_status_t nt3h_erase_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, size_t len)
+nt3h_status_t nt3h_restore(nt3h_dev_t *dev, const nt3h_snapshot_t *snap)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_RESTORE, 0, 0, restore(dev, snap));
+}
+
+/*!
+ * @brief This internal API writes a snapshot back to a tag, programming only blocks that differ.
+ */
+static nt3h_status_t restore(nt3h_dev_t *dev, const nt3h_snapshot_t *snap)
 {
     nt3h_status_t rslt;
+    bool locked;
 
     /* Check for null pointer in device structure */
     if ((rslt = null_ptr_check(dev)) != NT3H_OK)
         return rslt;
 
-    /*!! Check addresses are within bounds !! */
-    if (len == 0)
-        return NT3H_E_INVALID_ARGS;
+    if (snap == NULL)
+        return NT3H_E_NULL_PTR;
 
-    /* Remove any redundant offset if offset is greater than a block length */
-    /* Incremembet address by number of blocks and subtract offset by byte equivalent */
-    addr   += (offset / NT3H_I2C_MEM_BLOCK_SIZE);
-    offset -= (offset / NT3H_I2C_MEM_BLOCK_SIZE) * NT3H_I2C_MEM_BLOCK_SIZE;
+    uint8_t n_user = snap->is_2k ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+    uint8_t config = snap->is_2k ? NTAG_MEM_BLOCK_CONFIGURATION_2k : NTAG_MEM_BLOCK_CONFIGURATION_1k;
 
-    /* Calculate the number of blocks needed to cover this r/w operation. */
-    uint8_t blocks_needed = calculate_blocks_needed(offset, len);
+    if ((rslt = auto_lock_begin(dev, &locked)) != NT3H_OK)
+        return rslt;
 
-    nt3h_block_t blocks[blocks_needed];
+    rslt = sync_block_0(dev, snap->block0);
 
-    if ((rslt = read_blocks(dev, addr, blocks, blocks_needed)) != NT3H_OK)
-        return rslt;
+    /* Logical blocks only, remap spares are skipped */
+    for (uint8_t base = 0; base < n_user && rslt == NT3H_OK; )
+    {
+        uint8_t addr = (uint8_t)(NTAG_MEM_BLOCK_START_USER_MEMORY + base);
+        uint8_t cnt = (uint8_t)((n_user - base < NT3H_SYNC_BLOCKS) ? n_user - base : NT3H_SYNC_BLOCKS);
 
-    uint8_t *ptr = ((uint8_t *)blocks) + offset;
-    memset(ptr, NT3H_MEMORY_ERASE_VALUE, len);
+        if ((cnt = remap_run(dev, addr, cnt)) == 0)
+        {
+            base++;
+            continue;
+        }
 
-    if ((rslt = write_blocks(dev, addr, blocks, blocks_needed)) != NT3H_OK)
-        return rslt;
+        rslt = sync_blocks(dev, addr, (const nt3h_block_t *)snap->user[base], cnt);
+        base += cnt;
+    }
 
-    return rslt;
-}
+    if (rslt == NT3H_OK)
+        rslt = sync_blocks(dev, config, (const nt3h_block_t *)snap->config, 1);
 
-/*!
- * @brief This API reads the 1-byte value of a Session register within NT3H memory.
+    /* NC_REG to WDT_MS are writable, the others are status or read only */
+    for (uint8_t reg = 0; reg <= NTAG_MEM_OFFSET_WDT_MS && rslt == NT3H_OK; reg++)
+    {
+        uint8_t value;
+
+        if ((rslt = read_register(dev, reg, &value)) == NT3H_OK && value != snap->session[reg])
+            rslt = write_register(dev, reg, 0xFF, snap->session[reg]);
+    }
+
+    return auto_lock_end(dev, locked, rslt);
+}
+
+/*!
+ * @brief This API reads a number of bytes from NT3H memory.
+ */
+nt3h_status_t nt3h_read_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, uint8_t *data, size_t len)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_READ_BYTES, addr, len, read_bytes(dev, addr, offset, data, len));
+}
+
+/*!
+ * @brief This internal API reads a number of bytes from NT3H memory.
+ */
+static nt3h_status_t read_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, uint8_t *data, size_t len)
+{
+    nt3h_status_t rslt;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Check parameters are valid */
+    if (data == NULL || len == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    /* Remove any redundant offset if offset is greater than a block length */
+    /* Incremembet address by number of blocks and subtract offset by byte equivalent */
+    addr   += (offset / NT3H_I2C_MEM_BLOCK_SIZE);
+    offset -= (offset / NT3H_I2C_MEM_BLOCK_SIZE) * NT3H_I2C_MEM_BLOCK_SIZE;
+
+    /* Calculate the number of blocks needed to cover this r/w operation. */
+    uint8_t blocks_needed = calculate_blocks_needed(offset, len);
+    
+    nt3h_block_t blocks[blocks_needed];
+    bool locked;
+
+    if ((rslt = auto_lock_begin(dev, &locked)) != NT3H_OK)
+        return rslt;
+
+    if ((rslt = read_blocks(dev, addr, blocks, blocks_needed)) == NT3H_OK)
+    {
+        uint8_t *ptr = ((uint8_t *)blocks) + offset;
+        memcpy(data, ptr, len);
+    }
+
+    return auto_lock_end(dev, locked, rslt);
+}
+
+/*!
+ * @brief This API write a number of bytes to NT3H memory.
+ */
+nt3h_status_t nt3h_write_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, uint8_t *data, size_t len)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_WRITE_BYTES, addr, len, write_bytes(dev, addr, offset, data, len));
+}
+
+/*!
+ * @brief This internal API write a number of bytes to NT3H memory.
+ */
+static nt3h_status_t write_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, uint8_t *data, size_t len)
+{
+    size_t progress = 0;
+
+    return write_bytes_resume(dev, addr, offset, data, len, &progress);
+}
+
+/*!
+ * @brief This API writes a number of bytes to NT3H memory, resuming from a
+ * progress cursor.
+ */
+nt3h_status_t nt3h_write_bytes_resume(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, const uint8_t *data,
+                                      size_t len, size_t *progress)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_WRITE_BYTES, addr, len, write_bytes_resume(dev, addr, offset, data, len, progress));
+}
+
+/*!
+ * @brief This internal API writes a number of bytes to NT3H memory block by
+ * block, advancing the progress cursor after each block.
+ */
+static nt3h_status_t write_bytes_resume(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, const uint8_t *data,
+                                        size_t len, size_t *progress)
+{
+    nt3h_status_t rslt;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Check parameters are valid */
+    if (data == NULL || progress == NULL || len == 0 || *progress > len)
+        return NT3H_E_INVALID_ARGS;
+
+    uint32_t start = (uint32_t)addr * NT3H_I2C_MEM_BLOCK_SIZE + offset;
+
+    /* Blocks are addressed with a single byte */
+    if (start + len > 0x100U * NT3H_I2C_MEM_BLOCK_SIZE)
+        return NT3H_E_INVALID_ARGS;
+
+    bool locked;
+
+    if ((rslt = auto_lock_begin(dev, &locked)) != NT3H_OK)
+        return rslt;
+
+    while (*progress < len)
+    {
+        nt3h_block_t block;
+        uint32_t pos       = start + *progress;
+        uint8_t block_addr = (uint8_t)(pos / NT3H_I2C_MEM_BLOCK_SIZE);
+        uint8_t at         = (uint8_t)(pos % NT3H_I2C_MEM_BLOCK_SIZE);
+        size_t room        = (size_t)(NT3H_I2C_MEM_BLOCK_SIZE - at);
+        uint8_t cnt        = (uint8_t)((len - *progress < room) ? len - *progress : room);
+
+        /* Only partially covered blocks need their old contents */
+        if (cnt < NT3H_I2C_MEM_BLOCK_SIZE && (rslt = read_blocks(dev, block_addr, &block, 1)) != NT3H_OK)
+            break;
+
+        memcpy(&block.data[at], &data[*progress], cnt);
+
+        /* On failure everything before this block is already written */
+        if ((rslt = write_blocks(dev, block_addr, &block, 1)) != NT3H_OK)
+            break;
+
+        *progress += cnt;
+    }
+
+    return auto_lock_end(dev, locked, rslt);
+}
+
+/*!
+ * @brief This API erases a number of bytes in NT3H memory.
+ */
+nt3h_status_t nt3h_erase_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, size_t len)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_ERASE_BYTES, addr, len, erase_bytes(dev, addr, offset, len));
+}
+
+/*!
+ * @brief This internal API erases a number of bytes in NT3H memory.
+ */
+static nt3h_status_t erase_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, size_t len)
+{
+    nt3h_status_t rslt;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /*!! Check addresses are within bounds !! */
+    if (len == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    /* Remove any redundant offset if offset is greater than a block length */
+    /* Incremembet address by number of blocks and subtract offset by byte equivalent */
+    addr   += (offset / NT3H_I2C_MEM_BLOCK_SIZE);
+    offset -= (offset / NT3H_I2C_MEM_BLOCK_SIZE) * NT3H_I2C_MEM_BLOCK_SIZE;
+
+    /* Calculate the number of blocks needed to cover this r/w operation. */
+    uint8_t blocks_needed = calculate_blocks_needed(offset, len);
+
+    nt3h_block_t blocks[blocks_needed];
+    bool locked;
+
+    if ((rslt = auto_lock_begin(dev, &locked)) != NT3H_OK)
+        return rslt;
+
+    if ((rslt = read_blocks(dev, addr, blocks, blocks_needed)) == NT3H_OK)
+    {
+        uint8_t *ptr = ((uint8_t *)blocks) + offset;
+        memset(ptr, NT3H_MEMORY_ERASE_VALUE, len);
+
+        rslt = write_blocks(dev, addr, blocks, blocks_needed);
+    }
+
+    return auto_lock_end(dev, locked, rslt);
+}
+
+/*!
+ * @brief This API reads whole 16-byte blocks from NT3H memory.
+ */
+nt3h_status_t nt3h_read_blocks(nt3h_dev_t *dev, uint8_t addr, uint8_t *data, uint8_t cnt)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_READ_BLOCKS, addr, (size_t)cnt * NT3H_I2C_MEM_BLOCK_SIZE,
+                     read_blocks_locked(dev, addr, data, cnt));
+}
+
+/*!
+ * @brief This internal API reads whole blocks under the auto lock.
+ */
+static nt3h_status_t read_blocks_locked(nt3h_dev_t *dev, uint8_t addr, uint8_t *data, uint8_t cnt)
+{
+    nt3h_status_t rslt;
+    bool locked;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    if ((rslt = auto_lock_begin(dev, &locked)) != NT3H_OK)
+        return rslt;
+
+    rslt = read_blocks(dev, addr, (nt3h_block_t *)data, cnt);
+
+    return auto_lock_end(dev, locked, rslt);
+}
+
+/*!
+ * @brief This API writes whole 16-byte blocks to NT3H memory.
+ */
+nt3h_status_t nt3h_write_blocks(nt3h_dev_t *dev, uint8_t addr, const uint8_t *data, uint8_t cnt)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_WRITE_BLOCKS, addr, (size_t)cnt * NT3H_I2C_MEM_BLOCK_SIZE,
+                     write_blocks_locked(dev, addr, data, cnt));
+}
+
+/*!
+ * @brief This internal API writes whole blocks under the auto lock.
+ */
+static nt3h_status_t write_blocks_locked(nt3h_dev_t *dev, uint8_t addr, const uint8_t *data, uint8_t cnt)
+{
+    nt3h_status_t rslt;
+    bool locked;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    if ((rslt = auto_lock_begin(dev, &locked)) != NT3H_OK)
+        return rslt;
+
+    rslt = write_blocks(dev, addr, (const nt3h_block_t *)data, cnt);
+
+    return auto_lock_end(dev, locked, rslt);
+}
+
+/*!
+ * @brief This API starts programming one block and returns without waiting for it.
+ */
+nt3h_status_t nt3h_write_block_start(nt3h_dev_t *dev, uint8_t addr, const uint8_t *data)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_WRITE_BLOCK_START, addr, NT3H_I2C_MEM_BLOCK_SIZE,
+                     write_block_start(dev, addr, data));
+}
+
+/*!
+ * @brief This internal API starts programming one block under the auto lock.
+ */
+static nt3h_status_t write_block_start(nt3h_dev_t *dev, uint8_t addr, const uint8_t *data)
+{
+    nt3h_status_t rslt;
+    bool locked;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    if ((rslt = auto_lock_begin(dev, &locked)) != NT3H_OK)
+        return rslt;
+
+    rslt = program_blocks(dev, addr, (const nt3h_block_t *)data, 1, false);
+
+    return auto_lock_end(dev, locked, rslt);
+}
+
+/*!
+ * @brief This API checks whether the device is still programming an EEPROM block.
+ */
+nt3h_status_t nt3h_write_busy(nt3h_dev_t *dev, bool *busy)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_WRITE_BUSY, NTAG_MEM_OFFSET_NS_REG, 1, write_busy(dev, busy));
+}
+
+/*!
+ * @brief This internal API checks whether the device is still programming an EEPROM block.
+ */
+static nt3h_status_t write_busy(nt3h_dev_t *dev, bool *busy)
+{
+    nt3h_status_t rslt;
+    uint8_t NS_REG;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    if (busy == NULL)
+        return NT3H_E_NULL_PTR;
+
+    rslt = read_register(dev, NTAG_MEM_OFFSET_NS_REG, &NS_REG);
+
+    /* The device may NAK while it is programming */
+    if (rslt == NT3H_E_NAK)
+    {
+        *busy = true;
+        return NT3H_OK;
+    }
+
+    if (rslt == NT3H_OK)
+        *busy = (NS_REG & NTAG_NS_REG_MASK_EEPROM_WR_BUSY) != 0;
+
+    return rslt;
+}
+
+/*!
+ * @brief This API reads the 1-byte value of a Session register within NT3H memory.
  */
 nt3h_status_t nt3h_read_register(nt3h_dev_t *dev, uint8_t reg, uint8_t *data)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_READ_REGISTER, reg, 1, read_register(dev, reg, data));
+}
+
+/*!
+ * @brief This internal API reads the 1-byte value of a Session register within NT3H memory.
+ */
+static nt3h_status_t read_register(nt3h_dev_t *dev, uint8_t reg, uint8_t *data)
 {
     nt3h_status_t rslt;
 
@@ -299,13 +1081,22 @@ nt3h_status_t nt3h_read_register(nt3h_dev_t *dev, uint8_t reg, uint8_t *data)
     if (data == NULL)
         return NT3H_E_INVALID_ARGS;
 
-    /* Create I2C payload to read from NFC register, according to NFC spec */
-    uint8_t buf[2] = { NT3H_MEM_BLOCK_SESSION_REGS_1K, reg };
+    uint8_t buf[2];
+    uint8_t attempt = 0;
 
-    if ((rslt = dev->write(dev->dev_id, buf, sizeof(buf))) != NT3H_OK)
-        return rslt;
+    do
+    {
+        /* Create I2C payload to read from NFC register, according to NFC spec */
+        buf[0] = NT3H_MEM_BLOCK_SESSION_REGS_1K;
+        buf[1] = reg;
+
+        if ((rslt = bus_write(dev, NT3H_MEM_BLOCK_SESSION_REGS_1K, buf, sizeof(buf))) == NT3H_OK)
+            rslt = bus_read(dev, NT3H_MEM_BLOCK_SESSION_REGS_1K, buf, 1);
+    } while (retry_wait(dev, rslt, &attempt));
 
-    if ((rslt = dev->read(dev->dev_id, buf, 1)) != NT3H_OK)
+    LOG_EVENT(dev, NT3H_EVT_REG_READ, reg, buf[0], rslt);
+
+    if (rslt != NT3H_OK)
         return rslt;
 
     *data = buf[0];
@@ -317,6 +1108,14 @@ nt3h_status_t nt3h_read_register(nt3h_dev_t *dev, uint8_t reg, uint8_t *data)
  * @brief This API writes the 1-byte value to a Session register within NT3H memory.
  */
 nt3h_status_t nt3h_write_register(nt3h_dev_t *dev, uint8_t reg, uint8_t mask, uint8_t data)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_WRITE_REGISTER, reg, 1, write_register(dev, reg, mask, data));
+}
+
+/*!
+ * @brief This internal API writes the 1-byte value to a Session register within NT3H memory.
+ */
+static nt3h_status_t write_register(nt3h_dev_t *dev, uint8_t reg, uint8_t mask, uint8_t data)
 {
     nt3h_status_t rslt;
 
@@ -328,8 +1127,16 @@ nt3h_status_t nt3h_write_register(nt3h_dev_t *dev, uint8_t reg, uint8_t mask, ui
 
     /* Create I2C payload to write to NFC register according to NFC spec */
     uint8_t buf[4] = {NT3H_MEM_BLOCK_SESSION_REGS_1K, reg, mask, data};
+    uint8_t attempt = 0;
 
-    if ((rslt = dev->write(dev->dev_id, buf, sizeof(buf))) != NT3H_OK)
+    do
+    {
+        rslt = bus_write(dev, NT3H_MEM_BLOCK_SESSION_REGS_1K, buf, sizeof(buf));
+    } while (retry_wait(dev, rslt, &attempt));
+
+    LOG_EVENT(dev, NT3H_EVT_REG_WRITE, reg, ((uint32_t)mask << 8) | data, rslt);
+
+    if (rslt != NT3H_OK)
         return rslt;
 
     return rslt;
@@ -339,6 +1146,14 @@ nt3h_status_t nt3h_write_register(nt3h_dev_t *dev, uint8_t reg, uint8_t mask, ui
  * @brief This API reads the 1-byte value of a Configuration register within NT3H memory.
  */
 nt3h_status_t nt3h_read_config(nt3h_dev_t *dev, uint8_t reg, uint8_t *data)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_READ_CONFIG, reg, 1, read_config(dev, reg, data));
+}
+
+/*!
+ * @brief This internal API reads the 1-byte value of a Configuration register within NT3H memory.
+ */
+static nt3h_status_t read_config(nt3h_dev_t *dev, uint8_t reg, uint8_t *data)
 {
     nt3h_status_t rslt;
     nt3h_block_t block;
@@ -361,6 +1176,14 @@ nt3h_status_t nt3h_read_config(nt3h_dev_t *dev, uint8_t reg, uint8_t *data)
  * @brief This API writes the 1-byte value to a Configuration register within NT3H memory.
  */
 nt3h_status_t nt3h_write_config(nt3h_dev_t *dev, uint8_t reg, uint8_t mask, uint8_t data)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_WRITE_CONFIG, reg, 1, write_config(dev, reg, mask, data));
+}
+
+/*!
+ * @brief This internal API writes the 1-byte value to a Configuration register within NT3H memory.
+ */
+static nt3h_status_t write_config(nt3h_dev_t *dev, uint8_t reg, uint8_t mask, uint8_t data)
 {
     nt3h_status_t rslt;
     nt3h_block_t block;
@@ -414,6 +1237,14 @@ nt3h_status_t nt3h_write_config(nt3h_dev_t *dev, uint8_t reg, uint8_t mask, uint
  * @brief This API checks if there is currently an NFC field present on the NFC antenna.
  */
 nt3h_status_t nt3h_is_field_present(nt3h_dev_t *dev, bool *is_field_present)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_FIELD_PRESENT, NTAG_MEM_OFFSET_NS_REG, 1, field_present(dev, is_field_present));
+}
+
+/*!
+ * @brief This internal API checks if there is currently an NFC field present on the NFC antenna.
+ */
+static nt3h_status_t field_present(nt3h_dev_t *dev, bool *is_field_present)
 {
     nt3h_status_t rslt;
     uint8_t NS_REG;
@@ -426,10 +1257,10 @@ nt3h_status_t nt3h_is_field_present(nt3h_dev_t *dev, bool *is_field_present)
         return NT3H_E_NULL_PTR;
 
 
-    if ((rslt = nt3h_read_register(dev, 6, &NS_REG)) != NT3H_OK)
+    if ((rslt = read_register(dev, NTAG_MEM_OFFSET_NS_REG, &NS_REG)) != NT3H_OK)
         return rslt;
 
-    *is_field_present = NS_REG & 0x01; /* Mask for RF_FIELD_PRESENT */
+    *is_field_present = NS_REG & NTAG_NS_REG_MASK_RF_FIELD_PRESENT;
 
     return rslt;
 }
@@ -482,6 +1313,14 @@ nt3h_status_t nt3h_is_field_present(nt3h_dev_t *dev, bool *is_field_present)
  * @brief This API checks the device is responding to I2C commands.
  */
 nt3h_status_t nt3h_check(nt3h_dev_t *dev)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_CHECK, 0, NT3H_I2C_MEM_BLOCK_SIZE, check(dev));
+}
+
+/*!
+ * @brief This internal API checks the device is responding to I2C commands.
+ */
+static nt3h_status_t check(nt3h_dev_t *dev)
 {
     nt3h_status_t rslt;
     nt3h_block_t block;
@@ -496,245 +1335,2195 @@ nt3h_status_t nt3h_check(nt3h_dev_t *dev)
     return rslt;
 }
 
-// /* =================================================================== */
-// /* =============== Helpful toString Log Print Functions ============== */
-// #if DEBUG_NFC == 1
-
-// void NFC_PrintDeviceProperties(NFC_HandleTypeDef *hnfc)
-// {
-//     NFC_Block block;
-
-//     Log_info("----- NFC Device Details ----");
-
-//     if (NFC_ReadBlocks(hnfc, 0x00, &block, 1, 1000) == NFC_OK)
-//     {
-//         Log_info("Addr: %02X", block.Data[0]);
-
-//         Log_info("Serial: %02X:%02X:%02X:%02X:%02X:%02X",
-//                  block.Data[1], block.Data[2],
-//                  block.Data[3], block.Data[4],
-//                  block.Data[5], block.Data[6]);
+/*!
+ * @brief This API acquires the I2C side of the memory arbitration lock.
+ */
+nt3h_status_t nt3h_lock_acquire(nt3h_dev_t *dev)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_LOCK_ACQUIRE, NTAG_MEM_OFFSET_NS_REG, 1, lock_acquire(dev));
+}
 
-//         Log_info("Static lock bytes: %02X:%02X", block.Data[10], block.Data[11]);
-//     }
+/*!
+ * @brief This internal API acquires the I2C side of the memory arbitration lock.
+ */
+static nt3h_status_t lock_acquire(nt3h_dev_t *dev)
+{
+    nt3h_status_t rslt;
+    uint8_t NS_REG;
+    uint32_t waited_ms = 0;
 
-//     if (NFC_ReadCC(hnfc) == NFC_OK)
-//     {
-//         Log_info("CC: %02X:%02X:%02X:%02X",
-//                  hnfc->CC.MagicNumber,
-//                  hnfc->CC.Version,
-//                  hnfc->CC.MLEN,
-//                  hnfc->CC.AccessControl);
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
 
-//         Log_info("Memory Size: %d bytes", hnfc->CC.MLEN * 8);
-//     }
+    uint32_t timeout_ms = dev->lock.timeout_ms ? dev->lock.timeout_ms : NT3H_LOCK_DEFAULT_TIMEOUT_MS;
+    uint32_t poll_ms    = dev->lock.poll_ms    ? dev->lock.poll_ms    : NT3H_LOCK_DEFAULT_POLL_MS;
 
-//     Log_info("-----------------------------");
-// }
+    while (1)
+    {
+        if ((rslt = read_register(dev, NTAG_MEM_OFFSET_NS_REG, &NS_REG)) != NT3H_OK)
+            return rslt;
 
-// void NFC_PrintMemory(NFC_HandleTypeDef *hnfc, uint16_t blockAddress, uint16_t noOfBlocks)
-// {
-//     Log_info("****** NFC Memory Dump *****");
-//     NFC_Block blocks[noOfBlocks];
-//     uint8_t buffer[128];
-
-//     if (NFC_ReadBlocks(hnfc, blockAddress, blocks, noOfBlocks, 1000) == NFC_OK)
-//     {
-//         for (size_t blockNo = 0; blockNo < noOfBlocks; blockNo++)
-//         {
-//             uint8_t *ptr = &buffer[0];
-//             ptr += sprintf((char *)ptr, "0x%02X", blockAddress);
-
-//             for (int i = 0; i < 16; i += 4)
-//             {
-//                 ptr += sprintf((char *)ptr, "\t");
-
-//                 for (int j = 0; j < 4; j++)
-//                 {
-//                     ptr += sprintf((char *)ptr, "%02X ", blocks[blockNo].Data[i + j]);
-//                 }
-
-//                 ptr += sprintf((char *)ptr, "| ");
-//                 for (int j = 0; j < 4; j++)
-//                 {
-//                     //if((block->Data[i+j] >= 65 && block->Data[i+j] <= 90) ||
-//                     //   (block->Data[i+j] >= 97 && block->Data[i+j] <= 122)) {
-//                     if (blocks[blockNo].Data[i + j] >= 33 && blocks[blockNo].Data[i + j] <= 126)
-//                     {
-//                         ptr += sprintf((char *)ptr, "%c", blocks[blockNo].Data[i + j]);
-//                     }
-//                     else
-//                     {
-//                         ptr += sprintf((char *)ptr, ".");
-//                     }
-//                 }
-//                 ptr += sprintf((char *)ptr, " |");
-
-//                 Log_info("%s", buffer);
-//                 ptr = &buffer[0];
-//             }
-
-//             blockAddress++;
-//         }
-
-//         Log_info("****************************");
-//     }
-// }
+        if ((NS_REG & NTAG_NS_REG_MASK_RF_LOCKED) == 0)
+        {
+            /* Take the memory explicitly, then confirm RF did not lock it in between */
+            if ((rslt = write_register(dev, NTAG_MEM_OFFSET_NS_REG, NTAG_NS_REG_MASK_I2C_LOCKED,
+                                       NTAG_NS_REG_MASK_I2C_LOCKED)) != NT3H_OK)
+                return rslt;
 
-// void NFC_PrintSessionRegisters(NFC_HandleTypeDef *hnfc)
-// {
-//     uint8_t SessionReg[8];
-//     HAL_StatusTypeDef resp = 0;
-
-//     resp |= NFC_ReadRegister(hnfc, 0xFE, 0, &SessionReg[0], 1000);
-//     resp |= NFC_ReadRegister(hnfc, 0xFE, 1, &SessionReg[1], 1000);
-//     resp |= NFC_ReadRegister(hnfc, 0xFE, 2, &SessionReg[2], 1000);
-//     resp |= NFC_ReadRegister(hnfc, 0xFE, 3, &SessionReg[3], 1000);
-//     resp |= NFC_ReadRegister(hnfc, 0xFE, 4, &SessionReg[4], 1000);
-//     resp |= NFC_ReadRegister(hnfc, 0xFE, 5, &SessionReg[5], 1000);
-//     resp |= NFC_ReadRegister(hnfc, 0xFE, 6, &SessionReg[6], 1000);
-//     //   resp |= NFC_ReadRegister(hnfc, 0xFE, 7, &SessionReg[7], 1000);
-
-//     if (resp == HAL_OK)
-//     {
-//         Log_info("--- NFC Session Registers ---");
-//         Log_info("           NC_REG: 0x%02X", SessionReg[0]);
-//         Log_info("  LAST_NDEF_BLOCK: 0x%02X", SessionReg[1]);
-//         Log_info("SRAM_MIRROR_BLOCK: 0x%02X", SessionReg[2]);
-//         Log_info("           WDT_LS: 0x%02X", SessionReg[3]);
-//         Log_info("           WDT_MS: 0x%02X", SessionReg[4]);
-//         Log_info("    I2C_CLOCK_STR: 0x%02X", SessionReg[5]);
-//         Log_info("           NS_REG: 0x%02X", SessionReg[6]);
-//         //    Log_info("              RFU: 0x%02X", SessionReg[7]);
-//         Log_info("-----------------------------");
-//     }
-// }
+            if ((rslt = read_register(dev, NTAG_MEM_OFFSET_NS_REG, &NS_REG)) != NT3H_OK)
+                return rslt;
 
-// void NFC_PrintConfigRegisters(NFC_HandleTypeDef *hnfc)
-// {
-//     NFC_Block configBlock;
-
-//     if (NFC_ReadBlocks(hnfc, 0x3A, &configBlock, 1, 1000) == NFC_OK)
-//     {
-//         Log_info("---- NFC Config Registers ----");
-//         Log_info("           NC_REG: 0x%02X", configBlock.Data[0]);
-//         Log_info("  LAST_NDEF_BLOCK: 0x%02X", configBlock.Data[1]);
-//         Log_info("SRAM_MIRROR_BLOCK: 0x%02X", configBlock.Data[2]);
-//         Log_info("           WDT_LS: 0x%02X", configBlock.Data[3]);
-//         Log_info("           WDT_MS: 0x%02X", configBlock.Data[4]);
-//         Log_info("    I2C_CLOCK_STR: 0x%02X", configBlock.Data[5]);
-//         Log_info("         REG_LOCK: 0x%02X", configBlock.Data[6]);
-//         Log_info("              RFU: 0x%02X", configBlock.Data[7]);
-//         Log_info("-----------------------------");
-//     }
-// }
-// #endif
+            if ((NS_REG & (NTAG_NS_REG_MASK_I2C_LOCKED | NTAG_NS_REG_MASK_RF_LOCKED)) == NTAG_NS_REG_MASK_I2C_LOCKED)
+                break;
+        }
+
+        if (waited_ms == 0)
+            dev->lock.contentions++;
+
+        if (waited_ms >= timeout_ms || !can_delay(dev))
+        {
+            /* RF side is still holding the memory */
+            dev->lock.timeouts++;
+            dev->lock.wait_ms += waited_ms;
+            LOG_EVENT(dev, NT3H_EVT_LOCK_ACQUIRE, NT3H_E_TIMEOUT, waited_ms, 0);
+            return NT3H_E_TIMEOUT;
+        }
+
+        delay_ms(dev, poll_ms);
+        waited_ms += poll_ms;
+    }
+
+    dev->lock.wait_ms += waited_ms;
+    if (waited_ms > dev->lock.max_wait_ms)
+        dev->lock.max_wait_ms = waited_ms;
+
+    dev->lock.acquisitions++;
+    dev->lock.held = true;
+
+    if (dev->time_us != NULL)
+        dev->lock.acquired_us = dev->time_us();
+
+    LOG_EVENT(dev, NT3H_EVT_LOCK_ACQUIRE, rslt, waited_ms, 0);
+
+    return rslt;
+}
 
 /*!
- * @brief Read block(s) of data from NFC memory.
+ * @brief This API releases the I2C side of the memory arbitration lock.
  */
-static nt3h_status_t read_blocks(nt3h_dev_t *dev, uint8_t addr, nt3h_block_t *block, uint8_t cnt)
+nt3h_status_t nt3h_lock_release(nt3h_dev_t *dev)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_LOCK_RELEASE, NTAG_MEM_OFFSET_NS_REG, 1, lock_release(dev));
+}
+
+/*!
+ * @brief This internal API releases the I2C side of the memory arbitration lock.
+ */
+static nt3h_status_t lock_release(nt3h_dev_t *dev)
 {
     nt3h_status_t rslt;
 
-    uint8_t tx_buffer[NT3H_I2C_MEM_BLOCK_SIZE + 1];
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Writing zero to I2C_LOCKED hands memory access back to RF side */
+    rslt = write_register(dev, NTAG_MEM_OFFSET_NS_REG, NTAG_NS_REG_MASK_I2C_LOCKED, 0x00);
+
+    LOG_EVENT(dev, NT3H_EVT_LOCK_RELEASE, rslt, 0, 0);
+
+    if (rslt != NT3H_OK)
+        return rslt;
+
+    if (dev->lock.held && dev->time_us != NULL)
+    {
+        uint32_t hold_us = dev->time_us() - dev->lock.acquired_us;
+
+        dev->lock.holds++;
+        if (hold_us > dev->lock.max_hold_us)
+            dev->lock.max_hold_us = hold_us;
+    }
+
+    dev->lock.held = false;
+
+    return rslt;
+}
+
+/*!
+ * @brief This API clears the memory arbitration lock statistics.
+ */
+nt3h_status_t nt3h_lock_reset_stats(nt3h_dev_t *dev)
+{
+    if (dev == NULL)
+        return NT3H_E_NULL_PTR;
+
+    dev->lock.acquisitions = 0;
+    dev->lock.contentions  = 0;
+    dev->lock.timeouts     = 0;
+    dev->lock.wait_ms      = 0;
+    dev->lock.max_wait_ms  = 0;
+    dev->lock.holds        = 0;
+    dev->lock.max_hold_us  = 0;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API clears the transport retry statistics.
+ */
+nt3h_status_t nt3h_retry_reset_stats(nt3h_dev_t *dev)
+{
+    if (dev == NULL)
+        return NT3H_E_NULL_PTR;
+
+    dev->retry.retries      = 0;
+    dev->retry.recovered    = 0;
+    dev->retry.exhausted    = 0;
+    dev->retry.naks         = 0;
+    dev->retry.bus_timeouts = 0;
+    dev->retry.arb_lost     = 0;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API sets the watchdog timer period (WDT_LS/WDT_MS).
+ */
+nt3h_status_t nt3h_set_watchdog_us(nt3h_dev_t *dev, nt3h_reg_space_t space, uint32_t period_us)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_SET_WATCHDOG, NTAG_MEM_OFFSET_WDT_LS, 2, set_watchdog_us(dev, space, period_us));
+}
+
+/*!
+ * @brief This internal API sets the watchdog timer period (WDT_LS/WDT_MS).
+ */
+static nt3h_status_t set_watchdog_us(nt3h_dev_t *dev, nt3h_reg_space_t space, uint32_t period_us)
+{
+    nt3h_status_t rslt;
+    nt3h_block_t block;
 
     /* Check for null pointer in device structure */
     if ((rslt = null_ptr_check(dev)) != NT3H_OK)
         return rslt;
 
     /* Check parameters are valid */
-    if (block == NULL || cnt == 0)
+    if (period_us == 0 || period_us > NT3H_WDT_MAX_US)
         return NT3H_E_INVALID_ARGS;
 
-    while (cnt > 0U)
-    {
-        tx_buffer[0] = addr;
+    /* Round up so the watchdog never fires before the requested period */
+    uint32_t ticks = (uint32_t)(((uint64_t)period_us * 1000U + NT3H_WDT_TICK_NS - 1) / NT3H_WDT_TICK_NS);
 
-        /* Send block address*/
-        if((rslt = dev->write(dev->dev_id, tx_buffer, 1)) != NT3H_OK)
+    if (ticks > NT3H_WDT_MAX_TICKS)
+        ticks = NT3H_WDT_MAX_TICKS;
+
+    if (space == NT3H_REG_SESSION)
+    {
+        /* WDT_LS must be written before WDT_MS for the new value to be taken */
+        if ((rslt = write_register(dev, NTAG_MEM_OFFSET_WDT_LS, 0xFF, ticks & 0xFF)) != NT3H_OK)
             return rslt;
 
-        if((rslt = dev->read(dev->dev_id, (uint8_t*) block, NT3H_I2C_MEM_BLOCK_SIZE)) != NT3H_OK)
+        if ((rslt = write_register(dev, NTAG_MEM_OFFSET_WDT_MS, 0xFF, ticks >> 8)) != NT3H_OK)
+            return rslt;
+    }
+    else
+    {
+        /* Update both bytes with a single EEPROM program */
+        if ((rslt = read_blocks(dev, NT3H_MEM_BLOCK_CONFIG_1K, &block, 1)) != NT3H_OK)
             return rslt;
 
-        //if ((rslt = dev->read(dev->dev_id, addr, block->data, NT3H_I2C_MEM_BLOCK_SIZE)) != NT3H_OK)
-        //    return rslt;
+        block.data[NTAG_MEM_OFFSET_WDT_LS] = ticks & 0xFF;
+        block.data[NTAG_MEM_OFFSET_WDT_MS] = ticks >> 8;
 
-        block++; /* Move to next block of data */
-        addr++;
-        cnt--;
+        if ((rslt = write_blocks(dev, NT3H_MEM_BLOCK_CONFIG_1K, &block, 1)) != NT3H_OK)
+            return rslt;
     }
 
     return rslt;
 }
 
 /*!
- * @brief Write block(s) of data to NT3H memory.
+ * @brief This API reads the watchdog timer period (WDT_LS/WDT_MS).
  */
-static nt3h_status_t write_blocks(nt3h_dev_t *dev, uint8_t addr, const nt3h_block_t *block, uint8_t cnt)
+nt3h_status_t nt3h_get_watchdog_us(nt3h_dev_t *dev, nt3h_reg_space_t space, uint32_t *period_us)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_GET_WATCHDOG, NTAG_MEM_OFFSET_WDT_LS, 2, get_watchdog_us(dev, space, period_us));
+}
+
+/*!
+ * @brief This internal API reads the watchdog timer period (WDT_LS/WDT_MS).
+ */
+static nt3h_status_t get_watchdog_us(nt3h_dev_t *dev, nt3h_reg_space_t space, uint32_t *period_us)
 {
     nt3h_status_t rslt;
-    
-    uint8_t tx_buffer[NT3H_I2C_MEM_BLOCK_SIZE + 1];
+    nt3h_block_t block;
+    uint8_t wdt_ls, wdt_ms;
 
     /* Check for null pointer in device structure */
     if ((rslt = null_ptr_check(dev)) != NT3H_OK)
         return rslt;
 
-    /* Check parameters are valid */
-    if (block == NULL || cnt == 0)
-        return NT3H_E_INVALID_ARGS;
+    if (period_us == NULL)
+        return NT3H_E_NULL_PTR;
 
-    while (cnt > 0U)
+    if (space == NT3H_REG_SESSION)
     {
-        tx_buffer[0] = addr;
-        memcpy(&tx_buffer[1], block->data, NT3H_I2C_MEM_BLOCK_SIZE);
-        
-        /* Send block address and data */
-        if((rslt = dev->write(dev->dev_id, tx_buffer, sizeof(tx_buffer))) != NT3H_OK)
+        if ((rslt = read_register(dev, NTAG_MEM_OFFSET_WDT_LS, &wdt_ls)) != NT3H_OK)
             return rslt;
 
-        // if ((rslt = dev->write(dev->dev_id, addr, block->data, NT3H_I2C_MEM_BLOCK_SIZE)) != NT3H_OK)
-        //     return rslt;
-
-        if ((addr > NT3H_SRAM_ADDRESS) && (addr < (NT3H_SRAM_ADDRESS + NT3H_SRAM_LENGTH)))
-        {
-            /* Address is within SRAM memory region. Time to write 1-block = 0.4ms. */
-        }
-        else
-        {
-            /* Address is within EEPROM memory region. Time to write 1-block = 4ms */
-            dev->delay_ms(5); /* ALlow time for NFC to complete write to its memory */
-        }
+        if ((rslt = read_register(dev, NTAG_MEM_OFFSET_WDT_MS, &wdt_ms)) != NT3H_OK)
+            return rslt;
+    }
+    else
+    {
+        if ((rslt = read_blocks(dev, NT3H_MEM_BLOCK_CONFIG_1K, &block, 1)) != NT3H_OK)
+            return rslt;
 
-        block++; /* Move to next block of data */
-        addr++;
-        cnt--;
+        wdt_ls = block.data[NTAG_MEM_OFFSET_WDT_LS];
+        wdt_ms = block.data[NTAG_MEM_OFFSET_WDT_MS];
     }
 
+    uint32_t ticks = ((uint32_t)wdt_ms << 8) | wdt_ls;
+    *period_us = (ticks * NT3H_WDT_TICK_NS) / 1000U;
+
     return rslt;
 }
 
 /*!
- * @bried This internal API is used to calculate the number of blocks needed
- * in a r/w operation to ensure all memory regions are covered.
+ * @brief This API sizes the session watchdog from the lock hold times measured so far.
  */
-static size_t calculate_blocks_needed(uint16_t offset, size_t len)
+nt3h_status_t nt3h_watchdog_autotune(nt3h_dev_t *dev, uint32_t margin_pct, uint32_t *period_us)
 {
-    /* Calculate how many whole blocks */
-    uint16_t blocks_needed = len / NT3H_I2C_MEM_BLOCK_SIZE;
-    
-    /* Calculate how many remainder bytes */
-    uint16_t partial_bytes = len % NT3H_I2C_MEM_BLOCK_SIZE; 
+    INSTR_API_RETURN(dev, NT3H_OP_WATCHDOG_AUTOTUNE, NTAG_MEM_OFFSET_WDT_LS, 2,
+                     watchdog_autotune(dev, margin_pct, period_us));
+}
 
-    /* Add extra block for remainder */
-    blocks_needed += (partial_bytes) ? 1 : 0;
-    
-    /* If operation reads into next block, add another block */
-    blocks_needed += ((offset + len) > NT3H_I2C_MEM_BLOCK_SIZE) ? 1 : 0;
+/*!
+ * @brief This internal API sizes the session watchdog from the lock hold times measured so far.
+ */
+static nt3h_status_t watchdog_autotune(nt3h_dev_t *dev, uint32_t margin_pct, uint32_t *period_us)
+{
+    nt3h_status_t rslt;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Nothing measured yet, so nothing to tune against */
+    if (dev->time_us == NULL || dev->lock.holds == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    uint64_t target_us = ((uint64_t)dev->lock.max_hold_us * (100U + margin_pct)) / 100U;
+
+    if (target_us == 0)
+        target_us = 1;
+
+    if (target_us > NT3H_WDT_MAX_US)
+        target_us = NT3H_WDT_MAX_US;
+
+    if ((rslt = set_watchdog_us(dev, NT3H_REG_SESSION, (uint32_t)target_us)) != NT3H_OK)
+        return rslt;
+
+    if (period_us != NULL)
+        *period_us = (uint32_t)target_us;
+
+    return rslt;
+}
+
+/*!
+ * @brief This API enables or disables I2C clock stretching (I2C_CLOCK_STR).
+ */
+nt3h_status_t nt3h_set_clock_stretch(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_SET_CLOCK_STRETCH, NTAG_MEM_OFFSET_I2C_CLOCK_STR, 1,
+                     set_clock_stretch(dev, space, enable));
+}
+
+/*!
+ * @brief This internal API enables or disables I2C clock stretching (I2C_CLOCK_STR).
+ */
+static nt3h_status_t set_clock_stretch(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable)
+{
+    nt3h_status_t rslt;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Session copy of I2C_CLOCK_STR is read-only */
+    if (space != NT3H_REG_CONFIG)
+        return NT3H_E_INVALID_ARGS;
+
+    return write_reg_space(dev, space, NTAG_MEM_OFFSET_I2C_CLOCK_STR, NTAG_I2C_CLOCK_STR_MASK_ON_OFF,
+                           enable ? NTAG_I2C_CLOCK_STR_MASK_ON_OFF : 0x00);
+}
+
+/*!
+ * @brief This API reads the I2C clock stretching setting (I2C_CLOCK_STR).
+ */
+nt3h_status_t nt3h_get_clock_stretch(nt3h_dev_t *dev, nt3h_reg_space_t space, bool *enable)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_GET_CLOCK_STRETCH, NTAG_MEM_OFFSET_I2C_CLOCK_STR, 1,
+                     get_clock_stretch(dev, space, enable));
+}
+
+/*!
+ * @brief This internal API reads the I2C clock stretching setting (I2C_CLOCK_STR).
+ */
+static nt3h_status_t get_clock_stretch(nt3h_dev_t *dev, nt3h_reg_space_t space, bool *enable)
+{
+    nt3h_status_t rslt;
+    uint8_t reg;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    if (enable == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if ((rslt = read_reg_space(dev, space, NTAG_MEM_OFFSET_I2C_CLOCK_STR, &reg)) != NT3H_OK)
+        return rslt;
+
+    *enable = (reg & NTAG_I2C_CLOCK_STR_MASK_ON_OFF) != 0;
+
+    return rslt;
+}
+
+/*!
+ * @brief This API switches pass-through mode on or off (NC_REG PTHRU_ON_OFF).
+ */
+nt3h_status_t nt3h_set_pass_through(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_SET_PASS_THROUGH, NTAG_MEM_OFFSET_NC_REG, 1, set_pass_through(dev, space, enable));
+}
+
+/*!
+ * @brief This internal API switches pass-through mode on or off (NC_REG PTHRU_ON_OFF).
+ */
+static nt3h_status_t set_pass_through(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable)
+{
+    nt3h_status_t rslt;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* PTHRU_ON_OFF is reserved in the configuration NC_REG */
+    if (space != NT3H_REG_SESSION)
+        return NT3H_E_INVALID_ARGS;
+
+    return write_reg_space(dev, space, NTAG_MEM_OFFSET_NC_REG, NTAG_NC_REG_MASK_PTHRU_ON_OFF,
+                           enable ? NTAG_NC_REG_MASK_PTHRU_ON_OFF : 0x00);
+}
+
+/*!
+ * @brief This API sets the pass-through transfer direction (NC_REG TRANSFER_DIR).
+ */
+nt3h_status_t nt3h_set_transfer_dir(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_transfer_dir_t dir)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_SET_TRANSFER_DIR, NTAG_MEM_OFFSET_NC_REG, 1, set_transfer_dir(dev, space, dir));
+}
+
+/*!
+ * @brief This internal API sets the pass-through transfer direction (NC_REG TRANSFER_DIR).
+ */
+static nt3h_status_t set_transfer_dir(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_transfer_dir_t dir)
+{
+    nt3h_status_t rslt;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    return write_reg_space(dev, space, NTAG_MEM_OFFSET_NC_REG, NTAG_NC_REG_MASK_TRANSFER_DIR,
+                           (dir == NT3H_DIR_RF_TO_I2C) ? NTAG_NC_REG_MASK_TRANSFER_DIR : 0x00);
+}
+
+/*!
+ * @brief This API sets the field detect pin behaviour (NC_REG FD_OFF/FD_ON).
+ */
+nt3h_status_t nt3h_set_fd_mode(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_fd_off_t fd_off, nt3h_fd_on_t fd_on)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_SET_FD_MODE, NTAG_MEM_OFFSET_NC_REG, 1, set_fd_mode(dev, space, fd_off, fd_on));
+}
+
+/*!
+ * @brief This internal API sets the field detect pin behaviour (NC_REG FD_OFF/FD_ON).
+ */
+static nt3h_status_t set_fd_mode(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_fd_off_t fd_off, nt3h_fd_on_t fd_on)
+{
+    nt3h_status_t rslt;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Check parameters are valid */
+    if ((uint32_t)fd_off > NT3H_FD_OFF_PTHRU_DONE || (uint32_t)fd_on > NT3H_FD_ON_PTHRU_READY)
+        return NT3H_E_INVALID_ARGS;
+
+    uint8_t value = (uint8_t)((fd_off << 4) | (fd_on << 2));
+
+    return write_reg_space(dev, space, NTAG_MEM_OFFSET_NC_REG,
+                           NTAG_NC_REG_MASK_FD_OFF | NTAG_NC_REG_MASK_FD_ON, value);
+}
+
+/*!
+ * @brief This API switches SRAM mirroring on or off (NC_REG SRAM_MIRROR_ON_OFF).
+ */
+nt3h_status_t nt3h_set_sram_mirror(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_SET_SRAM_MIRROR, NTAG_MEM_OFFSET_NC_REG, 1, set_sram_mirror(dev, space, enable));
+}
+
+/*!
+ * @brief This internal API switches SRAM mirroring on or off (NC_REG SRAM_MIRROR_ON_OFF).
+ */
+static nt3h_status_t set_sram_mirror(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable)
+{
+    nt3h_status_t rslt;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* SRAM_MIRROR_ON_OFF is reserved in the configuration NC_REG */
+    if (space != NT3H_REG_SESSION)
+        return NT3H_E_INVALID_ARGS;
+
+    return write_reg_space(dev, space, NTAG_MEM_OFFSET_NC_REG, NTAG_NC_REG_MASK_SRAM_MIRROR_ON_OFF,
+                           enable ? NTAG_NC_REG_MASK_SRAM_MIRROR_ON_OFF : 0x00);
+}
+
+/*!
+ * @brief This API applies several register field updates, combining fields
+ * of the same register into a single masked write.
+ */
+nt3h_status_t nt3h_write_fields(nt3h_dev_t *dev, nt3h_reg_space_t space, const nt3h_field_value_t *fields, size_t cnt)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_WRITE_FIELDS, 0, cnt, write_fields(dev, space, fields, cnt));
+}
+
+/*!
+ * @brief This internal API applies several register field updates, combining fields
+ * of the same register into a single masked write.
+ */
+static nt3h_status_t write_fields(nt3h_dev_t *dev, nt3h_reg_space_t space, const nt3h_field_value_t *fields, size_t cnt)
+{
+    nt3h_status_t rslt;
+    nt3h_block_t block;
+    uint8_t masks[NT3H_NUM_REGS] = { 0 };
+    uint8_t data[NT3H_NUM_REGS]  = { 0 };
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Check parameters are valid */
+    if (fields == NULL || cnt == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    /* Validate and merge every update before touching the device */
+    for (size_t i = 0; i < cnt; i++)
+    {
+        uint8_t reg   = NT3H_FIELD_REG(fields[i].field);
+        uint8_t mask  = NT3H_FIELD_MASK(fields[i].field);
+        uint8_t shift = field_shift(mask);
+
+        if (reg >= NT3H_NUM_REGS || mask == 0 || fields[i].value > (mask >> shift))
+            return NT3H_E_INVALID_ARGS;
+
+        /* The same offset may be another register in the other space */
+        if ((NT3H_FIELD_SPACES(fields[i].field) & NT3H_FIELD_ACCESS(space, true)) == 0)
+            return NT3H_E_INVALID_ARGS;
+
+        masks[reg] |= mask;
+        data[reg]   = (uint8_t)((data[reg] & ~mask) | (fields[i].value << shift));
+    }
+
+    if (space == NT3H_REG_SESSION)
+    {
+        /* One masked write per register touched */
+        for (uint8_t reg = 0; reg < NT3H_NUM_REGS; reg++)
+        {
+            if (masks[reg] == 0)
+                continue;
+
+            if ((rslt = write_register(dev, reg, masks[reg], data[reg])) != NT3H_OK)
+                return rslt;
+        }
+    }
+    else
+    {
+        /* All configuration registers share one block, so program it once */
+        if ((rslt = read_blocks(dev, NT3H_MEM_BLOCK_CONFIG_1K, &block, 1)) != NT3H_OK)
+            return rslt;
+
+        for (uint8_t reg = 0; reg < NT3H_NUM_REGS; reg++)
+            block.data[reg] = (uint8_t)((block.data[reg] & ~masks[reg]) | data[reg]);
+
+        if ((rslt = write_blocks(dev, NT3H_MEM_BLOCK_CONFIG_1K, &block, 1)) != NT3H_OK)
+            return rslt;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API reads a single register field.
+ */
+nt3h_status_t nt3h_read_field(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_field_t field, uint8_t *value)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_READ_FIELD, NT3H_FIELD_REG(field), 1, read_field(dev, space, field, value));
+}
+
+/*!
+ * @brief This internal API reads a single register field.
+ */
+static nt3h_status_t read_field(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_field_t field, uint8_t *value)
+{
+    nt3h_status_t rslt;
+    uint8_t reg;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Check parameters are valid */
+    if (value == NULL || NT3H_FIELD_REG(field) >= NT3H_NUM_REGS || NT3H_FIELD_MASK(field) == 0 ||
+        (NT3H_FIELD_SPACES(field) & NT3H_FIELD_ACCESS(space, false)) == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    if ((rslt = read_reg_space(dev, space, NT3H_FIELD_REG(field), &reg)) != NT3H_OK)
+        return rslt;
+
+    *value = (reg & NT3H_FIELD_MASK(field)) >> field_shift(NT3H_FIELD_MASK(field));
+
+    return rslt;
+}
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+/*!
+ * @brief This API clears the instrumentation counters.
+ */
+nt3h_status_t nt3h_instr_reset(nt3h_dev_t *dev)
+{
+    if (dev == NULL)
+        return NT3H_E_NULL_PTR;
+
+    memset(&dev->instr.counters, 0, sizeof(dev->instr.counters));
+
+    if (dev->instr.latency != NULL)
+        memset(dev->instr.latency, 0, sizeof(*dev->instr.latency));
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API records a latency sample into a histogram.
+ */
+void nt3h_hist_record(nt3h_hist_t *hist, uint32_t us)
+{
+    size_t bucket;
+
+    if (hist == NULL)
+        return;
+
+    if (us < (1U << NT3H_HIST_SUB_BITS))
+    {
+        bucket = us;
+    }
+    else
+    {
+        /* Octave from the most significant bit, sub-bucket from the bits below it */
+        uint32_t msb = 0;
+        while ((us >> msb) > 1U)
+            msb++;
+
+        uint32_t sub = (us >> (msb - NT3H_HIST_SUB_BITS)) & ((1U << NT3H_HIST_SUB_BITS) - 1U);
+
+        bucket = ((msb - NT3H_HIST_SUB_BITS + 1U) << NT3H_HIST_SUB_BITS) + sub;
+    }
+
+    if (bucket >= NT3H_HIST_BUCKETS)
+        bucket = NT3H_HIST_BUCKETS - 1;
+
+    if (hist->count == 0 || us < hist->min_us)
+        hist->min_us = us;
+    if (us > hist->max_us)
+        hist->max_us = us;
+
+    hist->count++;
+    hist->total_us += us;
+    hist->buckets[bucket]++;
+}
+
+/*!
+ * @brief This API returns the lowest latency, in us, that falls in a bucket.
+ */
+uint32_t nt3h_hist_bucket_us(size_t bucket)
+{
+    const uint32_t subs = 1U << NT3H_HIST_SUB_BITS;
+
+    if (bucket < subs)
+        return (uint32_t)bucket;
+
+    uint32_t msb = (uint32_t)(bucket / subs) + NT3H_HIST_SUB_BITS - 1U;
+    uint32_t sub = (uint32_t)(bucket % subs);
+
+    return (1U << msb) + (sub << (msb - NT3H_HIST_SUB_BITS));
+}
+
+/*!
+ * @brief This API estimates a percentile from a histogram.
+ */
+uint32_t nt3h_hist_percentile(const nt3h_hist_t *hist, uint32_t permille)
+{
+    if (hist == NULL || hist->count == 0)
+        return 0;
+
+    uint64_t target = ((uint64_t)hist->count * permille + 999U) / 1000U;
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < NT3H_HIST_BUCKETS; i++)
+    {
+        seen += hist->buckets[i];
+
+        if (seen >= target && seen > 0)
+        {
+            /* Report the bucket's upper bound, capped by the true maximum */
+            uint32_t upper = (i + 1 < NT3H_HIST_BUCKETS) ? nt3h_hist_bucket_us(i + 1) - 1U : hist->max_us;
+            return (upper < hist->max_us) ? upper : hist->max_us;
+        }
+    }
+
+    return hist->max_us;
+}
+
+/*!
+ * @brief This API formats latency histograms as text, one line per class.
+ */
+int nt3h_latency_format(const nt3h_latency_t *latency, char *buf, size_t len)
+{
+    static const char *const names[NT3H_LAT_CLASSES] = {
+        "block_read", "block_write", "reg_read", "reg_write", "api"
+    };
+    int total = 0;
+
+    if (latency == NULL || (buf == NULL && len != 0))
+        return -1;
+
+    if (len != 0)
+        buf[0] = '\0';
+
+    for (size_t i = 0; i < NT3H_LAT_CLASSES; i++)
+    {
+        const nt3h_hist_t *hist = &latency->hist[i];
+        size_t used = ((size_t)total < len) ? (size_t)total : len;
+        uint32_t mean = hist->count ? (uint32_t)(hist->total_us / hist->count) : 0;
+
+        int n = snprintf(buf ? buf + used : NULL, len - used,
+                         "%-11s n=%lu min=%lu mean=%lu p50=%lu p90=%lu p99=%lu max=%lu\n",
+                         names[i], (unsigned long)hist->count, (unsigned long)hist->min_us,
+                         (unsigned long)mean,
+                         (unsigned long)nt3h_hist_percentile(hist, 500),
+                         (unsigned long)nt3h_hist_percentile(hist, 900),
+                         (unsigned long)nt3h_hist_percentile(hist, 990),
+                         (unsigned long)hist->max_us);
+        if (n < 0)
+            return n;
+
+        total += n;
+    }
+
+    return total;
+}
+#endif
+
+#ifdef NT3H_ENABLE_TRACE
+/*!
+ * @brief This API initialises a trace ring buffer over user supplied memory.
+ */
+nt3h_status_t nt3h_trace_init(nt3h_trace_t *trace, uint8_t *buf, size_t size)
+{
+    if (trace == NULL || buf == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (size < NT3H_TRACE_HDR_LEN)
+        return NT3H_E_INVALID_ARGS;
+
+    memset(trace, 0, sizeof(*trace));
+    trace->buf  = buf;
+    trace->size = size;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API copies the trace, oldest record first, into a linear buffer.
+ */
+nt3h_status_t nt3h_trace_export(const nt3h_trace_t *trace, uint8_t *out, size_t len, size_t *n_out)
+{
+    if (trace == NULL || out == NULL || n_out == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (len < trace->used)
+        return NT3H_E_INVALID_ARGS;
+
+    /* Copy in at most two runs: tail to end of memory, then start of memory */
+    size_t first = trace->size - trace->tail;
+
+    if (first > trace->used)
+        first = trace->used;
+
+    memcpy(out, &trace->buf[trace->tail], first);
+    memcpy(out + first, trace->buf, trace->used - first);
+
+    *n_out = trace->used;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API decodes the next record of an exported trace.
+ */
+bool nt3h_trace_next(const uint8_t *buf, size_t len, size_t *pos, nt3h_trace_record_t *rec)
+{
+    if (buf == NULL || pos == NULL || rec == NULL)
+        return false;
+
+    if (len < NT3H_TRACE_HDR_LEN || *pos > len - NT3H_TRACE_HDR_LEN)
+        return false;
+
+    const uint8_t *hdr = &buf[*pos];
+    uint16_t data_len = (uint16_t)(hdr[2] | (hdr[3] << 8));
+
+    if (data_len > len - *pos - NT3H_TRACE_HDR_LEN)
+        return false;
+
+    rec->read    = (hdr[0] & NT3H_TRACE_DIR_READ) != 0;
+    rec->status  = (nt3h_status_t)(hdr[0] >> 1);
+    rec->dev_id  = hdr[1];
+    rec->len     = data_len;
+    rec->time_us = (uint32_t)hdr[4] | ((uint32_t)hdr[5] << 8) |
+                   ((uint32_t)hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+    rec->data    = hdr + NT3H_TRACE_HDR_LEN;
+
+    *pos += NT3H_TRACE_HDR_LEN + data_len;
+
+    return true;
+}
+
+/*!
+ * @brief This API summarises an exported trace.
+ */
+nt3h_status_t nt3h_trace_summarise(const uint8_t *buf, size_t len, nt3h_trace_summary_t *sum)
+{
+    nt3h_trace_record_t rec;
+    size_t pos = 0;
+    bool first = true;
+    uint32_t start_us = 0;
+
+    if (buf == NULL || sum == NULL)
+        return NT3H_E_NULL_PTR;
+
+    memset(sum, 0, sizeof(*sum));
+
+    while (nt3h_trace_next(buf, len, &pos, &rec))
+    {
+        if (first)
+        {
+            start_us = rec.time_us;
+            first = false;
+        }
+
+        sum->span_us = rec.time_us - start_us;
+
+        if (rec.status != NT3H_OK)
+            sum->errors++;
+
+        if (rec.read)
+        {
+            sum->reads++;
+            sum->bytes_read += rec.len;
+        }
+        else
+        {
+            sum->writes++;
+            sum->bytes_written += rec.len;
+
+            /* Address byte plus one full block is a block program */
+            if (rec.len == NT3H_I2C_MEM_BLOCK_SIZE + 1)
+                sum->block_writes++;
+        }
+    }
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API replays an exported trace against a device's transport callbacks.
+ */
+nt3h_status_t nt3h_trace_replay(const uint8_t *buf, size_t len, nt3h_dev_t *target, bool timed, uint32_t *mismatches)
+{
+    nt3h_status_t rslt;
+    nt3h_trace_record_t rec;
+    size_t pos = 0;
+    bool first = true;
+    uint32_t first_us = 0;
+    uint32_t last_us = 0;
+    uint32_t target_us = 0;
+    uint32_t diffs = 0;
+    uint8_t scratch[NT3H_I2C_MEM_BLOCK_SIZE + 1];
+
+    if (buf == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if ((rslt = null_ptr_check(target)) != NT3H_OK)
+        return rslt;
+
+    while (nt3h_trace_next(buf, len, &pos, &rec))
+    {
+        if (timed && !first)
+        {
+            uint32_t gap_us = rec.time_us - last_us;
+
+            /* Keep to the recorded offset from the first record, so bus time
+             * spent by the target is not added on top of the recorded gaps */
+            if (target->time_us != NULL)
+            {
+                uint32_t due_us     = rec.time_us - first_us;
+                uint32_t elapsed_us = target->time_us() - target_us;
+
+                gap_us = (elapsed_us < due_us) ? due_us - elapsed_us : 0;
+            }
+
+            delay_us(target, gap_us);
+        }
+
+        if (first && target->time_us != NULL)
+            target_us = target->time_us();
+
+        if (first)
+            first_us = rec.time_us;
+
+        first = false;
+        last_us = rec.time_us;
+
+        if (rec.read)
+        {
+            uint8_t rx[rec.len ? rec.len : 1];
+
+            rslt = target->read(rec.dev_id, rx, rec.len);
+
+            if (rslt != rec.status || (rslt == NT3H_OK && memcmp(rx, rec.data, rec.len) != 0))
+                diffs++;
+        }
+        else
+        {
+            /* Transport write callbacks take a mutable buffer */
+            uint8_t *tx = scratch;
+            uint8_t big[rec.len > sizeof(scratch) ? rec.len : 1];
+
+            if (rec.len > sizeof(scratch))
+                tx = big;
+
+            memcpy(tx, rec.data, rec.len);
+            rslt = target->write(rec.dev_id, tx, rec.len);
+
+            if (rslt != rec.status)
+                diffs++;
+        }
+    }
+
+    if (mismatches != NULL)
+        *mismatches = diffs;
+
+    return NT3H_OK;
+}
+#endif
+
+#ifdef NT3H_ENABLE_LOG
+/*!
+ * @brief This API initialises a binary debug log ring.
+ */
+nt3h_status_t nt3h_log_init(nt3h_log_t *log, nt3h_log_entry_t *entries, uint32_t count)
+{
+    if (log == NULL || entries == NULL)
+        return NT3H_E_NULL_PTR;
+
+    /* Power of two count lets free running indices wrap cleanly */
+    if (count == 0 || (count & (count - 1)) != 0)
+        return NT3H_E_INVALID_ARGS;
+
+    log->entries = entries;
+    log->count   = count;
+    log->head    = 0;
+    log->tail    = 0;
+    log->dropped = 0;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API removes the oldest entry from a binary debug log.
+ */
+bool nt3h_log_pop(nt3h_log_t *log, nt3h_log_entry_t *out)
+{
+    if (log == NULL || out == NULL)
+        return false;
+
+    uint32_t tail = log->tail;
+
+    if (tail == log->head)
+        return false;
+
+    /* Read the entry only after observing the head that published it */
+    NT3H_LOG_ACQUIRE();
+
+    *out = log->entries[tail & (log->count - 1)];
+
+    /* Release the slot only after it has been copied out */
+    NT3H_LOG_RELEASE();
+    log->tail = tail + 1;
+
+    return true;
+}
+
+/*!
+ * @brief This API formats a log entry as text, for offline decoding.
+ */
+int nt3h_log_format(const nt3h_log_entry_t *entry, char *buf, size_t len)
+{
+    static const char *const names[NT3H_EVT_COUNT] = {
+        "INIT", "BLOCK_READ", "BLOCK_WRITE", "REG_READ", "REG_WRITE",
+        "LOCK_ACQUIRE", "LOCK_RELEASE", "SESSION_REGS", "CONFIG_REGS",
+        "MEMORY_LO", "MEMORY_HI"
+    };
+
+    if (entry == NULL)
+        return -1;
+
+    const char *name = (entry->id < NT3H_EVT_COUNT) ? names[entry->id] : "UNKNOWN";
+
+    switch (entry->id)
+    {
+        case NT3H_EVT_SESSION_REGS:
+        case NT3H_EVT_CONFIG_REGS:
+        case NT3H_EVT_MEMORY_LO:
+        case NT3H_EVT_MEMORY_HI:
+            /* Packed byte dumps, least significant byte first */
+            return snprintf(buf, len, "%10lu %-12s 0x%02X: %02X %02X %02X %02X %02X %02X %02X %02X",
+                            (unsigned long)entry->time_us, name, entry->arg0,
+                            (unsigned)(entry->arg1 & 0xFF), (unsigned)((entry->arg1 >> 8) & 0xFF),
+                            (unsigned)((entry->arg1 >> 16) & 0xFF), (unsigned)(entry->arg1 >> 24),
+                            (unsigned)(entry->arg2 & 0xFF), (unsigned)((entry->arg2 >> 8) & 0xFF),
+                            (unsigned)((entry->arg2 >> 16) & 0xFF), (unsigned)(entry->arg2 >> 24));
+
+        default:
+            return snprintf(buf, len, "%10lu %-12s %u 0x%lX 0x%lX",
+                            (unsigned long)entry->time_us, name, entry->arg0,
+                            (unsigned long)entry->arg1, (unsigned long)entry->arg2);
+    }
+}
+
+/*!
+ * @brief This API logs the session registers (NT3H_EVT_SESSION_REGS).
+ */
+nt3h_status_t nt3h_log_session_registers(nt3h_dev_t *dev)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_LOG_SESSION_REGS, 0, 7, log_session_registers(dev));
+}
+
+/*!
+ * @brief This internal API logs the session registers (NT3H_EVT_SESSION_REGS).
+ */
+static nt3h_status_t log_session_registers(nt3h_dev_t *dev)
+{
+    nt3h_status_t rslt;
+    uint8_t regs[8] = { 0 };
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Register 7 is RFU */
+    for (uint8_t reg = 0; reg < 7; reg++)
+    {
+        if ((rslt = read_register(dev, reg, &regs[reg])) != NT3H_OK)
+            return rslt;
+    }
+
+    log_bytes(dev, NT3H_EVT_SESSION_REGS, 0, regs);
+
+    return rslt;
+}
+
+/*!
+ * @brief This API logs the configuration registers (NT3H_EVT_CONFIG_REGS).
+ */
+nt3h_status_t nt3h_log_config_registers(nt3h_dev_t *dev)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_LOG_CONFIG_REGS, 0, NT3H_I2C_MEM_BLOCK_SIZE, log_config_registers(dev));
+}
+
+/*!
+ * @brief This internal API logs the configuration registers (NT3H_EVT_CONFIG_REGS).
+ */
+static nt3h_status_t log_config_registers(nt3h_dev_t *dev)
+{
+    nt3h_status_t rslt;
+    nt3h_block_t block;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    if ((rslt = read_blocks(dev, NT3H_MEM_BLOCK_CONFIG_1K, &block, 1)) != NT3H_OK)
+        return rslt;
+
+    log_bytes(dev, NT3H_EVT_CONFIG_REGS, 0, block.data);
+
+    return rslt;
+}
+
+/*!
+ * @brief This API logs the contents of memory blocks (NT3H_EVT_MEMORY_LO/HI).
+ */
+nt3h_status_t nt3h_log_memory(nt3h_dev_t *dev, uint8_t addr, uint8_t cnt)
+{
+    INSTR_API_RETURN(dev, NT3H_OP_LOG_MEMORY, addr, (size_t)cnt * NT3H_I2C_MEM_BLOCK_SIZE, log_memory(dev, addr, cnt));
+}
+
+/*!
+ * @brief This internal API logs the contents of memory blocks (NT3H_EVT_MEMORY_LO/HI).
+ */
+static nt3h_status_t log_memory(nt3h_dev_t *dev, uint8_t addr, uint8_t cnt)
+{
+    nt3h_status_t rslt = NT3H_OK;
+    nt3h_block_t block;
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    while (cnt > 0U)
+    {
+        if ((rslt = read_blocks(dev, addr, &block, 1)) != NT3H_OK)
+            return rslt;
+
+        log_bytes(dev, NT3H_EVT_MEMORY_LO, addr, &block.data[0]);
+        log_bytes(dev, NT3H_EVT_MEMORY_HI, addr, &block.data[8]);
+
+        addr++;
+        cnt--;
+    }
+
+    return rslt;
+}
+#endif
+
+/*!
+ * @brief This API initialises EEPROM wear telemetry.
+ */
+nt3h_status_t nt3h_wear_init(nt3h_wear_t *wear, uint32_t *counts, bool clear)
+{
+    if (wear == NULL || counts == NULL)
+        return NT3H_E_NULL_PTR;
+
+    memset(wear, 0, sizeof(*wear));
+    wear->counts = counts;
+
+    if (clear)
+        memset(counts, 0, NT3H_WEAR_BLOCKS * sizeof(*counts));
+
+    for (size_t i = 0; i < NT3H_WEAR_BLOCKS; i++)
+        wear->total += counts[i];
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API initialises hot block remapping.
+ */
+nt3h_status_t nt3h_remap_init(nt3h_remap_t *remap, bool is_2k, nt3h_remap_entry_t *entries, size_t n_entries,
+                              const uint8_t *spares, size_t n_spares, bool clear)
+{
+    if (remap == NULL || entries == NULL || spares == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (n_entries == 0 || n_spares == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    uint8_t user_blocks = is_2k ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+
+    for (size_t i = 0; i < n_entries; i++)
+    {
+        /* Sorted for lookup, and limited to user memory */
+        if ((i > 0 && entries[i].logical <= entries[i - 1].logical) ||
+            entries[i].logical < NTAG_MEM_BLOCK_START_USER_MEMORY || entries[i].logical > user_blocks)
+            return NT3H_E_INVALID_ARGS;
+    }
+
+    for (size_t i = 0; i < n_spares; i++)
+    {
+        if (spares[i] < NTAG_MEM_BLOCK_START_USER_MEMORY || spares[i] > user_blocks)
+            return NT3H_E_INVALID_ARGS;
+
+        /* Every pool block must be distinct */
+        for (size_t j = 0; j < n_entries; j++)
+        {
+            if (spares[i] == entries[j].logical)
+                return NT3H_E_INVALID_ARGS;
+        }
+
+        for (size_t j = 0; j < i; j++)
+        {
+            if (spares[i] == spares[j])
+                return NT3H_E_INVALID_ARGS;
+        }
+    }
+
+    for (size_t i = 0; i < n_entries; i++)
+    {
+        if (clear)
+        {
+            entries[i].physical = entries[i].logical;
+            entries[i].writes   = 0;
+            continue;
+        }
+
+        /* A restored location must be a pool block held by no other entry */
+        bool in_pool = false;
+
+        for (size_t j = 0; j < n_entries && !in_pool; j++)
+            in_pool = (entries[i].physical == entries[j].logical);
+
+        for (size_t j = 0; j < n_spares && !in_pool; j++)
+            in_pool = (entries[i].physical == spares[j]);
+
+        if (!in_pool)
+            return NT3H_E_INVALID_ARGS;
+
+        for (size_t j = 0; j < i; j++)
+        {
+            if (entries[i].physical == entries[j].physical)
+                return NT3H_E_INVALID_ARGS;
+        }
+    }
+
+    memset(remap, 0, sizeof(*remap));
+    remap->entries   = entries;
+    remap->n_entries = n_entries;
+    remap->spares    = spares;
+    remap->n_spares  = n_spares;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API reports the most programmed blocks, hottest first.
+ */
+size_t nt3h_wear_hottest(const nt3h_wear_t *wear, uint8_t *block, uint32_t *count, size_t n)
+{
+    size_t found = 0;
+
+    if (wear == NULL || wear->counts == NULL || block == NULL || count == NULL)
+        return 0;
+
+    /* Insertion into a sorted top-n list, n is expected to be small */
+    for (size_t i = 0; i < NT3H_WEAR_BLOCKS; i++)
+    {
+        uint32_t c = wear->counts[i];
+        size_t pos = found;
+
+        if (c == 0)
+            continue;
+
+        while (pos > 0 && count[pos - 1] < c)
+            pos--;
+
+        if (pos >= n)
+            continue;
+
+        size_t last = (found < n) ? found : n - 1;
+
+        for (size_t j = last; j > pos; j--)
+        {
+            block[j] = block[j - 1];
+            count[j] = count[j - 1];
+        }
+
+        block[pos] = (uint8_t)i;
+        count[pos] = c;
+
+        if (found < n)
+            found++;
+    }
+
+    return found;
+}
+
+/*!
+ * @brief Read block(s) of data from NFC memory.
+ */
+static nt3h_status_t read_blocks(nt3h_dev_t *dev, uint8_t addr, nt3h_block_t *block, uint8_t cnt)
+{
+    nt3h_status_t rslt;
+
+    uint8_t tx_buffer[NT3H_I2C_MEM_BLOCK_SIZE + 1];
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Check parameters are valid, spares hold other blocks' data while remapping */
+    if (block == NULL || cnt == 0 || remap_run(dev, addr, cnt) < cnt)
+        return NT3H_E_INVALID_ARGS;
+
+    while (cnt > 0U)
+    {
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+        uint32_t start_us = INSTR_NOW(dev);
+#endif
+        uint8_t attempt = 0;
+        nt3h_remap_entry_t *entry = remap_find(dev, addr);
+        uint8_t physical = (entry != NULL) ? entry->physical : addr;
+
+        do
+        {
+            tx_buffer[0] = physical;
+
+            /* Send block address*/
+            if((rslt = bus_write(dev, physical, tx_buffer, 1)) == NT3H_OK)
+                rslt = bus_read(dev, physical, (uint8_t*) block, NT3H_I2C_MEM_BLOCK_SIZE);
+        } while (retry_wait(dev, rslt, &attempt));
+
+        LOG_EVENT(dev, NT3H_EVT_BLOCK_READ, physical, rslt, 0);
+
+        if (rslt != NT3H_OK)
+            return rslt;
+
+        //if ((rslt = dev->read(dev->dev_id, addr, block->data, NT3H_I2C_MEM_BLOCK_SIZE)) != NT3H_OK)
+        //    return rslt;
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+        instr_block_latency(dev, NT3H_LAT_BLOCK_READ, start_us);
+#endif
+
+        block++; /* Move to next block of data */
+        addr++;
+        cnt--;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief Write block(s) of data to NT3H memory.
+ */
+static nt3h_status_t write_blocks(nt3h_dev_t *dev, uint8_t addr, const nt3h_block_t *block, uint8_t cnt)
+{
+    return program_blocks(dev, addr, block, cnt, true);
+}
+
+/*!
+ * @brief This internal API writes block(s) of data, optionally without waiting for the last.
+ */
+static nt3h_status_t program_blocks(nt3h_dev_t *dev, uint8_t addr, const nt3h_block_t *block, uint8_t cnt,
+                                    bool wait)
+{
+    nt3h_status_t rslt;
+    
+    uint8_t tx_buffer[NT3H_I2C_MEM_BLOCK_SIZE + 1];
+
+    /* Check for null pointer in device structure */
+    if ((rslt = null_ptr_check(dev)) != NT3H_OK)
+        return rslt;
+
+    /* Check parameters are valid, ack polling needs retries to absorb the NAKs */
+    if (block == NULL || cnt == 0 || (wait && dev->retry.ack_polling && dev->retry.max_retries == 0))
+        return NT3H_E_INVALID_ARGS;
+
+    /* Spares hold other blocks' data while remapping */
+    if (remap_run(dev, addr, cnt) < cnt)
+        return NT3H_E_INVALID_ARGS;
+
+    /* A rejecting budget must pass the whole write before the first program */
+    bool reserved = dev->wear != NULL && dev->wear->reject;
+
+    if (reserved)
+    {
+        uint8_t n_eeprom = 0;
+
+        for (uint16_t a = addr; a < (uint16_t)addr + cnt; a++)
+            if (!((a >= NT3H_SRAM_ADDRESS) && (a < (NT3H_SRAM_ADDRESS + NT3H_SRAM_LENGTH / NT3H_I2C_MEM_BLOCK_SIZE))))
+                n_eeprom++;
+
+        if (n_eeprom > 0 && (rslt = wear_budget(dev, n_eeprom)) != NT3H_OK)
+            return rslt;
+    }
+
+    while (cnt > 0U)
+    {
+        bool eeprom = !((addr >= NT3H_SRAM_ADDRESS) &&
+                        (addr < (NT3H_SRAM_ADDRESS + NT3H_SRAM_LENGTH / NT3H_I2C_MEM_BLOCK_SIZE)));
+
+        if (eeprom && !reserved && (rslt = wear_budget(dev, 1)) != NT3H_OK)
+            return rslt;
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+        uint32_t start_us = INSTR_NOW(dev);
+#endif
+        uint8_t attempt = 0;
+        nt3h_remap_entry_t *entry;
+        uint8_t physical = remap_write_target(dev, addr, &entry);
+
+        tx_buffer[0] = physical;
+        memcpy(&tx_buffer[1], block->data, NT3H_I2C_MEM_BLOCK_SIZE);
+        
+        /* Send block address and data, the device NAKs while still programming */
+        do
+        {
+            rslt = bus_write(dev, physical, tx_buffer, sizeof(tx_buffer));
+        } while (retry_wait(dev, rslt, &attempt));
+
+        LOG_EVENT(dev, NT3H_EVT_BLOCK_WRITE, physical, rslt, 0);
+
+        if (rslt != NT3H_OK)
+            return rslt;
+
+        remap_written(dev, entry, physical);
+
+        // if ((rslt = dev->write(dev->dev_id, addr, block->data, NT3H_I2C_MEM_BLOCK_SIZE)) != NT3H_OK)
+        //     return rslt;
+
+        /* The caller waits out the last block itself */
+        bool skip_wait = !wait && cnt == 1U;
+
+        if (!eeprom)
+        {
+            /* Address is within SRAM memory region. Time to write 1-block = 0.4ms. */
+            if (!dev->retry.ack_polling && !skip_wait)
+                delay_us(dev, NT3H_SRAM_WRITE_US);
+        }
+        else
+        {
+            wear_account(dev, physical);
+
+            /* Address is within EEPROM memory region. Time to write 1-block = 4ms */
+            if (dev->prog.enable && !skip_wait)
+            {
+                if ((rslt = eeprom_wait(dev)) != NT3H_OK)
+                    return rslt;
+            }
+            else if (!dev->retry.ack_polling && !skip_wait)
+            {
+                delay_us(dev, NT3H_EEPROM_WRITE_US); /* ALlow time for NFC to complete write to its memory */
+            }
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+            dev->instr.counters.blocks_programmed++;
+#endif
+        }
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+        instr_block_latency(dev, NT3H_LAT_BLOCK_WRITE, start_us);
+#endif
+
+        block++; /* Move to next block of data */
+        addr++;
+        cnt--;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API programs the blocks of a region that differ from their target contents.
+ */
+static nt3h_status_t sync_blocks(nt3h_dev_t *dev, uint8_t addr, const nt3h_block_t *target, uint8_t cnt)
+{
+    nt3h_status_t rslt;
+    nt3h_block_t current[NT3H_SYNC_BLOCKS];
+
+    if (cnt > NT3H_SYNC_BLOCKS)
+        return NT3H_E_INVALID_ARGS;
+
+    if ((rslt = read_blocks(dev, addr, current, cnt)) != NT3H_OK)
+        return rslt;
+
+    for (uint8_t i = 0; i < cnt; )
+    {
+        uint8_t run = 0;
+
+        while (i + run < cnt && memcmp(current[i + run].data, target[i + run].data, NT3H_I2C_MEM_BLOCK_SIZE) != 0)
+            run++;
+
+        if (run == 0)
+        {
+            i++;
+            continue;
+        }
+
+        if ((rslt = write_blocks(dev, (uint8_t)(addr + i), &target[i], run)) != NT3H_OK)
+            return rslt;
+
+        i += run;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API programs the static lock bytes and capability container of block 0.
+ */
+static nt3h_status_t sync_block_0(nt3h_dev_t *dev, const uint8_t *target)
+{
+    nt3h_status_t rslt;
+    nt3h_block_t block;
+
+    if ((rslt = read_blocks(dev, 0, &block, 1)) != NT3H_OK)
+        return rslt;
+
+    if (memcmp(&block.data[10], &target[10], NT3H_I2C_MEM_BLOCK_SIZE - 10) == 0)
+        return rslt;
+
+    /* Byte 0 reads back as the manufacturer ID but sets the I2C address when written */
+    if (dev->i2c_addr == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    block.data[0] = dev->i2c_addr;
+    memcpy(&block.data[10], &target[10], NT3H_I2C_MEM_BLOCK_SIZE - 10);
+
+    return write_blocks(dev, 0, &block, 1);
+}
+
+/*!
+ * @bried This internal API is used to calculate the number of blocks needed
+ * in a r/w operation to ensure all memory regions are covered.
+ */
+static size_t calculate_blocks_needed(uint16_t offset, size_t len)
+{
+    /* Blocks from the one holding the first byte to the one holding the last */
+    return (offset + len + NT3H_I2C_MEM_BLOCK_SIZE - 1) / NT3H_I2C_MEM_BLOCK_SIZE;
+}
+
+/*!
+ * @brief This internal API acquires the memory lock on behalf of a
+ * multi-block operation.
+ */
+static nt3h_status_t auto_lock_begin(nt3h_dev_t *dev, bool *locked)
+{
+    nt3h_status_t rslt = NT3H_OK;
+
+    *locked = false;
+
+    if (dev->lock.auto_lock && !dev->lock.held)
+    {
+        if ((rslt = lock_acquire(dev)) != NT3H_OK)
+            return rslt;
+
+        *locked = true;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API releases a lock taken by auto_lock_begin().
+ */
+static nt3h_status_t auto_lock_end(nt3h_dev_t *dev, bool locked, nt3h_status_t rslt)
+{
+    nt3h_status_t release_rslt;
+
+    if (!locked)
+        return rslt;
+
+    /* Always release, but report the original failure first */
+    release_rslt = lock_release(dev);
+
+    return (rslt != NT3H_OK) ? rslt : release_rslt;
+}
+
+/*!
+ * @brief This internal API reads a register from either register space.
+ */
+static nt3h_status_t read_reg_space(nt3h_dev_t *dev, nt3h_reg_space_t space, uint8_t reg, uint8_t *data)
+{
+    if (space == NT3H_REG_SESSION)
+        return read_register(dev, reg, data);
+
+    return read_config(dev, reg, data);
+}
+
+/*!
+ * @brief This internal API updates the masked bits of a register in either
+ * register space.
+ */
+static nt3h_status_t write_reg_space(nt3h_dev_t *dev, nt3h_reg_space_t space, uint8_t reg, uint8_t mask, uint8_t data)
+{
+    /* Session registers take a hardware write mask, configuration a keep mask */
+    if (space == NT3H_REG_SESSION)
+        return write_register(dev, reg, mask, data & mask);
+
+    return write_config(dev, reg, (uint8_t)~mask, data & mask);
+}
+
+/*!
+ * @brief This internal API returns the bit position of the lowest set bit of a field mask.
+ */
+static uint8_t field_shift(uint8_t mask)
+{
+    uint8_t shift = 0;
+
+    while (mask != 0 && (mask & 0x01) == 0)
+    {
+        mask >>= 1;
+        shift++;
+    }
+
+    return shift;
+}
+
+/*!
+ * @brief This internal API performs a single bus write transaction.
+ */
+static nt3h_status_t bus_write(nt3h_dev_t *dev, uint16_t addr, uint8_t *data, size_t len)
+{
+    nt3h_status_t rslt;
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+    uint32_t start_us = instr_begin(dev, NT3H_OP_BUS_WRITE, addr, len);
+
+    rslt = dev->write(dev->dev_id, data, len);
+
+#ifdef NT3H_ENABLE_TRACE
+    trace_record(dev, false, data, len, rslt);
+#endif
+
+    dev->instr.counters.transactions++;
+    dev->instr.counters.bytes_written += len;
+    if (rslt != NT3H_OK)
+        dev->instr.counters.bus_errors++;
+
+    instr_end(dev, NT3H_OP_BUS_WRITE, addr, len, start_us, rslt);
+#else
+    (void)addr;
+    rslt = dev->write(dev->dev_id, data, len);
+
+#ifdef NT3H_ENABLE_TRACE
+    trace_record(dev, false, data, len, rslt);
+#endif
+#endif
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API performs a single bus read transaction.
+ */
+static nt3h_status_t bus_read(nt3h_dev_t *dev, uint16_t addr, uint8_t *data, size_t len)
+{
+    nt3h_status_t rslt;
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+    uint32_t start_us = instr_begin(dev, NT3H_OP_BUS_READ, addr, len);
+
+    rslt = dev->read(dev->dev_id, data, len);
+
+#ifdef NT3H_ENABLE_TRACE
+    trace_record(dev, true, data, len, rslt);
+#endif
+
+    dev->instr.counters.transactions++;
+    if (rslt == NT3H_OK)
+        dev->instr.counters.bytes_read += len;
+    else
+        dev->instr.counters.bus_errors++;
+
+    instr_end(dev, NT3H_OP_BUS_READ, addr, len, start_us, rslt);
+#else
+    (void)addr;
+    rslt = dev->read(dev->dev_id, data, len);
+
+#ifdef NT3H_ENABLE_TRACE
+    trace_record(dev, true, data, len, rslt);
+#endif
+#endif
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API waits for the given period using the user delay function.
+ */
+static void delay_ms(nt3h_dev_t *dev, uint32_t period_ms)
+{
+    /* Longest wait expressible in us, about 71 minutes */
+    if (period_ms > UINT32_MAX / 1000U)
+        period_ms = UINT32_MAX / 1000U;
+
+    delay_us(dev, period_ms * 1000U);
+}
+
+/*!
+ * @brief This internal API waits for the given period using the finest wait primitive available.
+ */
+static void delay_us(nt3h_dev_t *dev, uint32_t period_us)
+{
+    if (period_us == 0 || !can_delay(dev))
+        return;
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+    dev->instr.counters.delay_us += period_us;
+#endif
+
+    if (dev->delay_us != NULL)
+    {
+        dev->delay_us(period_us);
+    }
+    else if (dev->yield != NULL && dev->time_us != NULL)
+    {
+        uint32_t start_us = dev->time_us();
+
+        /* Let other tasks run until the period has elapsed */
+        while ((uint32_t)(dev->time_us() - start_us) < period_us)
+            dev->yield();
+    }
+    else
+    {
+        dev->delay_ms((period_us + 999U) / 1000U);
+    }
+}
+
+/*!
+ * @brief This internal API checks whether the driver is able to wait at all.
+ */
+static bool can_delay(const nt3h_dev_t *dev)
+{
+    return dev->delay_us != NULL || (dev->yield != NULL && dev->time_us != NULL) || dev->delay_ms != NULL;
+}
+
+/*!
+ * @brief This internal API waits for an EEPROM block program to complete.
+ */
+static nt3h_status_t eeprom_wait(nt3h_dev_t *dev)
+{
+    nt3h_status_t rslt;
+    nt3h_prog_time_t *prog = &dev->prog;
+    uint8_t calib_writes   = prog->calib_writes ? prog->calib_writes : NT3H_PROG_DEFAULT_CALIB_WRITES;
+    uint32_t poll_us       = prog->poll_us      ? prog->poll_us      : NT3H_PROG_DEFAULT_POLL_US;
+    uint32_t estimate_us   = prog->estimate_us  ? prog->estimate_us  : NT3H_EEPROM_WRITE_US;
+    uint32_t start_us      = (dev->time_us != NULL) ? dev->time_us() : 0;
+    uint32_t wait_us, poll_at_us, ready_us;
+    uint32_t busy_us = 0;
+    bool seen_busy = false;
+    uint8_t NS_REG;
+
+    /* Measure from early on while calibrating, then poll just after the estimate */
+    if (prog->samples < calib_writes)
+        wait_us = estimate_us / 2;
+    else
+        wait_us = estimate_us + poll_us / NT3H_PROG_GUARD_DIV;
+
+    delay_us(dev, wait_us);
+
+    while (1)
+    {
+        /* The device samples EEPROM_WR_BUSY as the poll starts, not once it has been read back */
+        poll_at_us = (dev->time_us != NULL) ? dev->time_us() - start_us : wait_us;
+
+        prog->polls++;
+        rslt = read_register(dev, NTAG_MEM_OFFSET_NS_REG, &NS_REG);
+
+        /* The device may NAK while it is programming */
+        if (rslt == NT3H_OK && (NS_REG & NTAG_NS_REG_MASK_EEPROM_WR_BUSY) == 0)
+            break;
+
+        if (rslt != NT3H_OK && rslt != NT3H_E_NAK)
+            return rslt;
+
+        busy_us   = poll_at_us;
+        seen_busy = true;
+
+        if (wait_us >= NTAG_MAX_WRITE_DELAY_MS * 1000U || !can_delay(dev))
+            return NT3H_E_TIMEOUT;
+
+        delay_us(dev, poll_us);
+        wait_us += poll_us;
+    }
+
+    ready_us = poll_at_us;
+
+    /*
+     * The program ended between the last busy poll and the first ready one.
+     * Take the middle of that interval, or half a poll interval before the
+     * ready poll if the first poll already found it done. Sampling the ready
+     * poll itself would bias the estimate upwards by the poll interval, and
+     * with the first poll after the estimate it could then only ever grow.
+     */
+    uint32_t measured_us;
+
+    if (seen_busy)
+        measured_us = busy_us + (ready_us - busy_us) / 2U;
+    else
+        measured_us = (ready_us > poll_us / 2U) ? ready_us - poll_us / 2U : ready_us;
+
+    if (prog->samples == 0 || prog->estimate_us == 0)
+        prog->estimate_us = measured_us;
+    else if (measured_us > prog->estimate_us)
+        prog->estimate_us += (measured_us - prog->estimate_us + 7U) / 8U;
+    else
+        prog->estimate_us -= (prog->estimate_us - measured_us) / 8U;
+
+    if (measured_us > prog->max_us)
+        prog->max_us = measured_us;
+
+    prog->samples++;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This internal API decides whether to retry a bus transaction.
+ */
+static bool retry_wait(nt3h_dev_t *dev, nt3h_status_t rslt, uint8_t *attempt)
+{
+    nt3h_retry_t *retry = &dev->retry;
+
+    switch (rslt)
+    {
+        case NT3H_OK:
+            if (*attempt > 0)
+                retry->recovered++;
+            return false;
+
+        case NT3H_E_NAK:
+            retry->naks++;
+            break;
+
+        case NT3H_E_BUS_TIMEOUT:
+            retry->bus_timeouts++;
+            break;
+
+        case NT3H_E_ARB_LOST:
+            retry->arb_lost++;
+            break;
+
+        default:
+            /* Not transient, retrying will not help */
+            return false;
+    }
+
+    if (*attempt >= retry->max_retries)
+    {
+        if (retry->max_retries > 0)
+            retry->exhausted++;
+        return false;
+    }
+
+    if (retry->mode == NT3H_RETRY_FIXED)
+    {
+        delay_ms(dev, retry->delay_ms);
+    }
+    else if (retry->mode == NT3H_RETRY_EXPONENTIAL)
+    {
+        uint32_t period_ms = (retry->delay_ms != 0) ? retry->delay_ms : 1;
+
+        /* Double for each retry already made, saturating at the cap */
+        for (uint8_t i = 0; i < *attempt && (retry->max_delay_ms == 0 || period_ms < retry->max_delay_ms); i++)
+            period_ms = (period_ms < 0x8000U) ? period_ms * 2 : period_ms;
+
+        if (retry->max_delay_ms != 0 && period_ms > retry->max_delay_ms)
+            period_ms = retry->max_delay_ms;
+
+        delay_ms(dev, period_ms);
+    }
+
+    (*attempt)++;
+    retry->retries++;
+
+    return true;
+}
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+/*!
+ * @brief This internal API reports the start of an operation.
+ */
+static uint32_t instr_begin(nt3h_dev_t *dev, nt3h_op_t op, uint16_t addr, size_t len)
+{
+    if (dev == NULL)
+        return 0;
+
+    if (dev->instr.hook != NULL)
+    {
+        nt3h_instr_event_t evt = { op, false, addr, len, NT3H_OK, 0 };
+        dev->instr.hook(dev->instr.hook_ctx, &evt);
+    }
+
+    return (dev->time_us != NULL) ? dev->time_us() : 0;
+}
+
+/*!
+ * @brief This internal API reports the end of an operation.
+ */
+static nt3h_status_t instr_end(nt3h_dev_t *dev, nt3h_op_t op, uint16_t addr, size_t len,
+                               uint32_t start_us, nt3h_status_t rslt)
+{
+    if (dev == NULL)
+        return rslt;
+
+    uint32_t duration_us = (dev->time_us != NULL) ? (dev->time_us() - start_us) : 0;
+
+    if (dev->instr.latency != NULL && dev->time_us != NULL && op >= NT3H_OP_READ_BYTES)
+    {
+        nt3h_hist_t *hist = dev->instr.latency->hist;
+
+        if (op == NT3H_OP_READ_REGISTER)
+            nt3h_hist_record(&hist[NT3H_LAT_REG_READ], duration_us);
+        else if (op == NT3H_OP_WRITE_REGISTER)
+            nt3h_hist_record(&hist[NT3H_LAT_REG_WRITE], duration_us);
+
+        nt3h_hist_record(&hist[NT3H_LAT_API], duration_us);
+    }
+
+    if (dev->instr.hook != NULL)
+    {
+        nt3h_instr_event_t evt = { op, true, addr, len, rslt, duration_us };
+        dev->instr.hook(dev->instr.hook_ctx, &evt);
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API records a block latency sample if histograms are enabled.
+ */
+static void instr_block_latency(nt3h_dev_t *dev, nt3h_lat_class_t cls, uint32_t start_us)
+{
+    if (dev->instr.latency != NULL && dev->time_us != NULL)
+        nt3h_hist_record(&dev->instr.latency->hist[cls], dev->time_us() - start_us);
+}
+#endif
+
+#ifdef NT3H_ENABLE_TRACE
+/*!
+ * @brief This internal API copies bytes into the trace ring, wrapping at the end.
+ */
+static void trace_put(nt3h_trace_t *trace, const uint8_t *data, size_t len)
+{
+    while (len-- > 0)
+    {
+        trace->buf[trace->head] = *data++;
+        trace->head = (trace->head + 1) % trace->size;
+    }
+}
+
+/*!
+ * @brief This internal API appends a transport call to the device trace, if attached.
+ */
+static void trace_record(nt3h_dev_t *dev, bool read, const uint8_t *data, size_t len, nt3h_status_t rslt)
+{
+    nt3h_trace_t *trace = dev->trace;
+    uint8_t hdr[NT3H_TRACE_HDR_LEN];
+
+    if (trace == NULL || trace->buf == NULL)
+        return;
+
+    /* Failed reads carry no meaningful data */
+    if (read && rslt != NT3H_OK)
+        len = 0;
+
+    size_t rec_len = NT3H_TRACE_HDR_LEN + len;
+
+    if (rec_len > trace->size || len > 0xFFFF)
+    {
+        trace->dropped++;
+        return;
+    }
+
+    /* Drop oldest records until the new one fits */
+    while (trace->size - trace->used < rec_len)
+    {
+        size_t lo = (trace->tail + 2) % trace->size;
+        size_t hi = (trace->tail + 3) % trace->size;
+        size_t old_len = NT3H_TRACE_HDR_LEN + (trace->buf[lo] | ((size_t)trace->buf[hi] << 8));
+
+        trace->tail = (trace->tail + old_len) % trace->size;
+        trace->used -= old_len;
+        trace->records--;
+        trace->dropped++;
+    }
+
+    uint32_t now = (dev->time_us != NULL) ? dev->time_us() : 0;
+
+    hdr[0] = (uint8_t)((read ? NT3H_TRACE_DIR_READ : 0) | ((uint8_t)rslt << 1));
+    hdr[1] = (uint8_t)dev->dev_id;
+    hdr[2] = (uint8_t)(len & 0xFF);
+    hdr[3] = (uint8_t)(len >> 8);
+    hdr[4] = (uint8_t)(now & 0xFF);
+    hdr[5] = (uint8_t)(now >> 8);
+    hdr[6] = (uint8_t)(now >> 16);
+    hdr[7] = (uint8_t)(now >> 24);
+
+    trace_put(trace, hdr, sizeof(hdr));
+    trace_put(trace, data, len);
+
+    trace->used += rec_len;
+    trace->records++;
+}
+#endif
+
+#ifdef NT3H_ENABLE_LOG
+/*!
+ * @brief This internal API appends an event to the device debug log, if attached.
+ */
+static void log_event(nt3h_dev_t *dev, nt3h_log_event_t id, uint16_t arg0, uint32_t arg1, uint32_t arg2)
+{
+    nt3h_log_t *log = dev->log;
+
+    if (log == NULL || log->entries == NULL)
+        return;
+
+    uint32_t head = log->head;
+
+    if (head - log->tail >= log->count)
+    {
+        log->dropped++;
+        return;
+    }
+
+    /* Overwrite the slot only after observing the tail that freed it */
+    NT3H_LOG_ACQUIRE();
+
+    nt3h_log_entry_t *entry = &log->entries[head & (log->count - 1)];
+
+    entry->time_us = (dev->time_us != NULL) ? dev->time_us() : 0;
+    entry->id      = (uint16_t)id;
+    entry->arg0    = arg0;
+    entry->arg1    = arg1;
+    entry->arg2    = arg2;
+
+    /* Publish the entry only after it has been filled in */
+    NT3H_LOG_RELEASE();
+    log->head = head + 1;
+}
+
+/*!
+ * @brief This internal API logs 8 bytes packed into arg1/arg2.
+ */
+static void log_bytes(nt3h_dev_t *dev, nt3h_log_event_t id, uint16_t arg0, const uint8_t *bytes)
+{
+    uint32_t lo = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    uint32_t hi = (uint32_t)bytes[4] | ((uint32_t)bytes[5] << 8) | ((uint32_t)bytes[6] << 16) | ((uint32_t)bytes[7] << 24);
+
+    log_event(dev, id, arg0, lo, hi);
+}
+#endif
+
+/*!
+ * @brief This internal API applies the wear budget before an EEPROM block program.
+ */
+static nt3h_status_t wear_budget(nt3h_dev_t *dev, uint8_t n)
+{
+    nt3h_wear_t *wear = dev->wear;
+
+    if (wear == NULL || wear->rate_per_s == 0 || dev->time_us == NULL)
+        return NT3H_OK;
+
+    /* Token bucket kept in microseconds of credit, one program costs 1/rate s */
+    uint32_t cost_us = 1000000U / wear->rate_per_s;
+    uint32_t burst   = wear->burst ? wear->burst : 1U;
+    uint64_t cap_us  = (uint64_t)cost_us * burst;
+    uint32_t now     = dev->time_us();
+
+    /* Credit is held in 32 bits */
+    if (cap_us > UINT32_MAX)
+        cap_us = UINT32_MAX;
+
+    if (!wear->primed)
+    {
+        wear->credit_us = (uint32_t)cap_us;
+        wear->primed = true;
+    }
+    else
+    {
+        uint64_t credit = (uint64_t)wear->credit_us + (uint32_t)(now - wear->last_us);
+        wear->credit_us = (uint32_t)((credit > cap_us) ? cap_us : credit);
+    }
+
+    wear->last_us = now;
+
+    if (wear->reject)
+    {
+        uint64_t need_us = (uint64_t)cost_us * n;
+
+        if (wear->credit_us < need_us)
+        {
+            wear->rejected++;
+            return NT3H_E_WRITE_BUDGET;
+        }
+
+        wear->credit_us -= (uint32_t)need_us;
+
+        return NT3H_OK;
+    }
+
+    if (wear->credit_us < cost_us)
+    {
+        /* Wait until enough credit has accrued for this program */
+        uint32_t wait_us = cost_us - wear->credit_us;
+
+        delay_us(dev, wait_us);
+
+        wear->throttled++;
+        wear->throttle_ms += (wait_us + 999U) / 1000U;
+        wear->last_us = dev->time_us();
+        wear->credit_us = cost_us;
+    }
+
+    wear->credit_us -= cost_us;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This internal API accounts for a completed EEPROM block program.
+ */
+static void wear_account(nt3h_dev_t *dev, uint8_t addr)
+{
+    nt3h_wear_t *wear = dev->wear;
+
+    if (wear == NULL || wear->counts == NULL)
+        return;
+
+    wear->counts[addr]++;
+    wear->total++;
+
+    if (wear->save != NULL && wear->save_interval != 0 && (wear->total % wear->save_interval) == 0)
+        wear->save(wear->save_ctx, wear->counts, NT3H_WEAR_BLOCKS);
+}
+
+/*!
+ * @brief This internal API finds the remap entry of a logical block.
+ */
+static nt3h_remap_entry_t *remap_find(nt3h_dev_t *dev, uint8_t addr)
+{
+    nt3h_remap_t *remap = dev->remap;
+
+    if (remap == NULL)
+        return NULL;
+
+    size_t lo = 0;
+    size_t hi = remap->n_entries;
+
+    remap->lookups++;
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (remap->entries[mid].logical == addr)
+        {
+            remap->hits++;
+            return &remap->entries[mid];
+        }
+
+        if (remap->entries[mid].logical < addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return NULL;
+}
+
+/*!
+ * @brief This internal API picks the physical block to program for a logical block.
+ */
+static uint8_t remap_write_target(nt3h_dev_t *dev, uint8_t addr, nt3h_remap_entry_t **entry)
+{
+    nt3h_remap_t *remap = dev->remap;
+    uint16_t interval;
+
+    if ((*entry = remap_find(dev, addr)) == NULL)
+        return addr;
+
+    interval = remap->interval ? remap->interval : NT3H_REMAP_DEFAULT_INTERVAL;
+
+    if ((*entry)->writes < interval)
+        return (*entry)->physical;
+
+    /* Pool is the logical blocks followed by the spares, take the next one not in use */
+    size_t pool = remap->n_entries + remap->n_spares;
+
+    for (size_t k = 0; k < pool; k++)
+    {
+        size_t index = (remap->cursor + k) % pool;
+        uint8_t candidate = (index < remap->n_entries) ? remap->entries[index].logical
+                                                       : remap->spares[index - remap->n_entries];
+        bool used = false;
+
+        for (size_t j = 0; j < remap->n_entries && !used; j++)
+            used = (remap->entries[j].physical == candidate);
+
+        if (!used)
+        {
+            remap->cursor = (index + 1) % pool;
+            return candidate;
+        }
+    }
+
+    return (*entry)->physical;
+}
+
+/*!
+ * @brief This internal API records a completed program of a remapped block.
+ */
+static void remap_written(nt3h_dev_t *dev, nt3h_remap_entry_t *entry, uint8_t physical)
+{
+    nt3h_remap_t *remap = dev->remap;
+
+    if (entry == NULL)
+        return;
+
+    if (entry->physical == physical)
+    {
+        entry->writes++;
+        return;
+    }
+
+    /* New copy is programmed, the old block becomes free */
+    entry->physical = physical;
+    entry->writes   = 1;
+    remap->moves++;
+
+    if (remap->save != NULL)
+        remap->save(remap->save_ctx, remap->entries, remap->n_entries);
+}
+
+/*!
+ * @brief This internal API counts the blocks from an address up to the first spare.
+ */
+static uint8_t remap_run(const nt3h_dev_t *dev, uint8_t addr, uint8_t max)
+{
+    const nt3h_remap_t *remap = dev->remap;
+    uint8_t run = max;
+
+    if (remap == NULL)
+        return max;
+
+    for (size_t k = 0; k < remap->n_spares; k++)
+    {
+        uint16_t spare = remap->spares[k];
+
+        if (spare >= addr && spare < (uint16_t)addr + run)
+            run = (uint8_t)(spare - addr);
+    }
 
-    return blocks_needed;
+    return run;
 }
 
 /*!
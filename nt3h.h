@@ -68,6 +68,75 @@ nt3h_status_t nt3h_init(nt3h_dev_t *dev);
  */
 nt3h_status_t nt3h_deinit(nt3h_dev_t *dev);
 
+/*!
+ * @brief This API restores the factory values of block 0 and the
+ * configuration blocks.
+ *
+ * @note The configuration blocks are 56 to 58 (0x38 to 0x3A) on the 1K
+ *       part and 120 to 122 (0x78 to 0x7A) on the 2K part, and the
+ *       capability container's memory size is 0x6D or 0xEA to match.
+ *       Blocks are read first and only those that differ are programmed.
+ *       In block 0 only the static lock bytes and capability container are
+ *       compared, as the serial number reads back in place of bytes 0 to 6.
+ *       If block 0 is written, byte 0 is dev->i2c_addr so the tag keeps
+ *       its I2C address.
+ * 
+ * @param[in]   dev : Pointer to nt3h device structure.
+ * @param[in] is_2k : Device is the 2K variant, else 1K.
+ * 
+ * @return API status code, NT3H_E_INVALID_ARGS if block 0 differs and
+ *         dev->i2c_addr is 0.
+ */
+nt3h_status_t nt3h_factory_reset(nt3h_dev_t *dev, bool is_2k);
+
+/*!
+ * @brief This API blanks user memory, leaving an empty NDEF message.
+ *
+ * @note Block 1 receives an empty NDEF TLV and a terminator TLV, all other
+ *       bytes are zeroed. The region is read in bulk and only blocks that
+ *       differ are programmed, so an already blank tag costs no programs.
+ *       Remapped blocks are blanked through dev->remap; its spares are skipped.
+ * 
+ * @param[in]   dev : Pointer to nt3h device structure.
+ * @param[in] is_2k : Device is the 2K variant, else 1K.
+ * 
+ * @return API status code.
+ */
+nt3h_status_t nt3h_format(nt3h_dev_t *dev, bool is_2k);
+
+/*!
+ * @brief This API captures all I2C readable memory of a tag.
+ *
+ * @note Reads block 0, user memory and the configuration block with one
+ *       block transaction each, then the session registers. With dev->remap
+ *       attached user memory is captured by logical address and spare
+ *       blocks are left zeroed.
+ * 
+ * @param[in]     dev : Pointer to nt3h device structure.
+ * @param[in]   is_2k : Tag is a 2K variant.
+ * @param[out]   snap : Snapshot to fill.
+ * 
+ * @return API status code.
+ */
+nt3h_status_t nt3h_snapshot(nt3h_dev_t *dev, bool is_2k, nt3h_snapshot_t *snap);
+
+/*!
+ * @brief This API writes a snapshot back to a tag, programming only blocks
+ * that differ.
+ *
+ * @note Block 0 is compared and written as in nt3h_factory_reset(), keeping
+ *       the snapshot's static lock bytes and capability container. Session
+ *       registers 0 to 4 are written where they differ; the rest are read only.
+ *       With dev->remap attached spare blocks are skipped.
+ * 
+ * @param[in]  dev : Pointer to nt3h device structure.
+ * @param[in] snap : Snapshot to restore.
+ * 
+ * @return API status code, NT3H_E_INVALID_ARGS if block 0 differs and
+ *         dev->i2c_addr is 0.
+ */
+nt3h_status_t nt3h_restore(nt3h_dev_t *dev, const nt3h_snapshot_t *snap);
+
 /*!
  * @brief This API reads a number of bytes from NT3H memory.
  *
@@ -98,6 +167,27 @@ nt3h_status_t nt3h_read_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, u
  */
 nt3h_status_t nt3h_write_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, uint8_t *data, size_t len);
 
+/*!
+ * @brief This API writes a number of bytes to NT3H memory, resuming from a
+ * progress cursor.
+ *
+ * @note Whole blocks are programmed without reading them first. A failed
+ *       block is retried according to dev->retry before giving up. On
+ *       return *progress holds the number of bytes now written, so calling
+ *       again with the same arguments continues at the block that failed.
+ * 
+ * @param[in]        dev : Pointer to device structure.
+ * @param[in]       addr : Memory address (I2C side).
+ * @param[in]     offset : Byte offset within memory address.
+ * @param[in]       data : Pointer to buffer containing data to write.
+ * @param[in]        len : Number of bytes to write.
+ * @param[in,out] progress : Bytes of data already written, 0 to start.
+ * 
+ * @return API status code.
+ */
+nt3h_status_t nt3h_write_bytes_resume(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, const uint8_t *data,
+                                      size_t len, size_t *progress);
+
 /*!
  * @brief This API erases a number of bytes in NT3H memory.
  *
@@ -112,6 +202,66 @@ nt3h_status_t nt3h_write_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset,
  */
 nt3h_status_t nt3h_erase_bytes(nt3h_dev_t *dev, uint16_t addr, uint16_t offset, size_t len);
 
+/*!
+ * @brief This API reads whole 16-byte blocks from NT3H memory.
+ *
+ * @note Unlike nt3h_read_bytes() no staging buffer is used.
+ *
+ * @param[in]   dev : Pointer to device structure.
+ * @param[in]  addr : First block address (I2C side).
+ * @param[out] data : Buffer of at least cnt * 16 bytes.
+ * @param[in]   cnt : Number of blocks to read.
+ *
+ * @return API status code, NT3H_E_INVALID_ARGS if the range includes a
+ *         spare block of dev->remap.
+ */
+nt3h_status_t nt3h_read_blocks(nt3h_dev_t *dev, uint8_t addr, uint8_t *data, uint8_t cnt);
+
+/*!
+ * @brief This API writes whole 16-byte blocks to NT3H memory.
+ *
+ * @note Unlike nt3h_write_bytes() the blocks are not read first, so each
+ *       block costs exactly one program.
+ *
+ * @param[in]  dev : Pointer to device structure.
+ * @param[in] addr : First block address (I2C side).
+ * @param[in] data : Buffer of cnt * 16 bytes to write.
+ * @param[in]  cnt : Number of blocks to write.
+ *
+ * @return API status code, NT3H_E_INVALID_ARGS if the range includes a
+ *         spare block of dev->remap.
+ */
+nt3h_status_t nt3h_write_blocks(nt3h_dev_t *dev, uint8_t addr, const uint8_t *data, uint8_t cnt);
+
+/*!
+ * @brief This API starts programming one 16-byte block and returns without
+ * waiting for the program to complete.
+ *
+ * @note The device NAKs or reports EEPROM_WR_BUSY until the program has
+ *       completed: poll nt3h_write_busy() before accessing it again. The
+ *       program time settings of dev->prog are not used for this block.
+ *
+ * @param[in]  dev : Pointer to device structure.
+ * @param[in] addr : Block address (I2C side).
+ * @param[in] data : Buffer of 16 bytes to write.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_write_block_start(nt3h_dev_t *dev, uint8_t addr, const uint8_t *data);
+
+/*!
+ * @brief This API checks whether the device is still programming a block.
+ *
+ * @note Reads EEPROM_WR_BUSY of NS_REG. A NAK means the device is busy and
+ *       is not reported as an error.
+ *
+ * @param[in]   dev : Pointer to device structure.
+ * @param[out] busy : True while a program is in progress.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_write_busy(nt3h_dev_t *dev, bool *busy);
+
 /*!
  * @brief This API reads the 1-byte value of a Session register within NT3H memory.
  *
@@ -202,17 +352,438 @@ nt3h_status_t nt3h_is_field_present(nt3h_dev_t *dev, bool *is_field_present);
  */
 nt3h_status_t nt3h_check(nt3h_dev_t *dev);
 
+/*!
+ * @brief This API acquires the I2C side of the memory arbitration lock.
+ *
+ * @note Polls NS_REG until RF_LOCKED is clear, then sets I2C_LOCKED and reads
+ *       NS_REG back to confirm the I2C side holds the memory, retrying if RF
+ *       locked it first. Waits at most dev->lock.timeout_ms. Contention and
+ *       wait time are accumulated in dev->lock.
+ *
+ * @param[in] dev : Pointer to device structure.
+ *
+ * @return API status code, NT3H_E_TIMEOUT if the RF side did not release memory.
+ */
+nt3h_status_t nt3h_lock_acquire(nt3h_dev_t *dev);
+
+/*!
+ * @brief This API releases the I2C side of the memory arbitration lock.
+ *
+ * @note Clears I2C_LOCKED in NS_REG so the RF side can access memory
+ *       without waiting for the watchdog timer to expire.
+ *
+ * @param[in] dev : Pointer to device structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_lock_release(nt3h_dev_t *dev);
+
+/*!
+ * @brief This API clears the memory arbitration lock statistics.
+ *
+ * @param[in] dev : Pointer to device structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_lock_reset_stats(nt3h_dev_t *dev);
+
+/*!
+ * @brief This API clears the transport retry statistics.
+ *
+ * @param[in] dev : Pointer to device structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_retry_reset_stats(nt3h_dev_t *dev);
+
+/*!
+ * @brief This API sets the watchdog timer period (WDT_LS/WDT_MS).
+ *
+ * @note The period is rounded up to the next 9.43us timer tick.
+ *
+ * @param[in]       dev : Pointer to device structure.
+ * @param[in]     space : Session (immediate) or configuration (persistent) registers.
+ * @param[in] period_us : Watchdog period in microseconds, 1 to NT3H_WDT_MAX_US.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_set_watchdog_us(nt3h_dev_t *dev, nt3h_reg_space_t space, uint32_t period_us);
+
+/*!
+ * @brief This API reads the watchdog timer period (WDT_LS/WDT_MS).
+ *
+ * @param[in]        dev : Pointer to device structure.
+ * @param[in]      space : Session or configuration registers.
+ * @param[out] period_us : Pointer to store watchdog period in microseconds.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_get_watchdog_us(nt3h_dev_t *dev, nt3h_reg_space_t space, uint32_t *period_us);
+
+/*!
+ * @brief This API sizes the session watchdog from the lock hold times measured so far.
+ *
+ * @note Requires dev->time_us and at least one acquire/release pair.
+ *       The chosen period is the longest observed hold plus margin_pct percent.
+ *
+ * @param[in]         dev : Pointer to device structure.
+ * @param[in]  margin_pct : Safety margin added to the longest hold, in percent.
+ * @param[out]  period_us : Optional pointer to store the period applied.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_watchdog_autotune(nt3h_dev_t *dev, uint32_t margin_pct, uint32_t *period_us);
+
+/*!
+ * @brief This API enables or disables I2C clock stretching (I2C_CLOCK_STR).
+ *
+ * @note I2C_CLOCK_STR is read-only in the session registers, so only
+ *       NT3H_REG_CONFIG is accepted. The setting applies from next power-on.
+ *
+ * @param[in]    dev : Pointer to device structure.
+ * @param[in]  space : Register space, must be NT3H_REG_CONFIG.
+ * @param[in] enable : True to let the device stretch SCL while busy.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_set_clock_stretch(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable);
+
+/*!
+ * @brief This API reads the I2C clock stretching setting (I2C_CLOCK_STR).
+ *
+ * @param[in]     dev : Pointer to device structure.
+ * @param[in]   space : Session (currently active) or configuration (power-on) value.
+ * @param[out] enable : Pointer to store setting.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_get_clock_stretch(nt3h_dev_t *dev, nt3h_reg_space_t space, bool *enable);
+
+/*!
+ * @brief This API switches pass-through mode on or off (NC_REG PTHRU_ON_OFF).
+ *
+ * @note PTHRU_ON_OFF only exists in the session registers, so only
+ *       NT3H_REG_SESSION is accepted: a single masked register write, no
+ *       EEPROM programming. Pass-through is always off after power-on.
+ *
+ * @param[in]    dev : Pointer to device structure.
+ * @param[in]  space : Register space, must be NT3H_REG_SESSION.
+ * @param[in] enable : True to enable pass-through mode.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_set_pass_through(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable);
+
+/*!
+ * @brief This API sets the pass-through transfer direction (NC_REG TRANSFER_DIR).
+ *
+ * @param[in]   dev : Pointer to device structure.
+ * @param[in] space : Session or configuration registers.
+ * @param[in]   dir : Transfer direction.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_set_transfer_dir(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_transfer_dir_t dir);
+
+/*!
+ * @brief This API sets the field detect pin behaviour (NC_REG FD_OFF/FD_ON).
+ *
+ * @note Both fields are updated with a single register write.
+ *
+ * @param[in]    dev : Pointer to device structure.
+ * @param[in]  space : Session or configuration registers.
+ * @param[in] fd_off : Event that releases the field detect pin.
+ * @param[in]  fd_on : Event that asserts the field detect pin.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_set_fd_mode(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_fd_off_t fd_off, nt3h_fd_on_t fd_on);
+
+/*!
+ * @brief This API switches SRAM mirroring on or off (NC_REG SRAM_MIRROR_ON_OFF).
+ *
+ * @note SRAM_MIRROR_ON_OFF only exists in the session registers, so only
+ *       NT3H_REG_SESSION is accepted.
+ *
+ * @param[in]    dev : Pointer to device structure.
+ * @param[in]  space : Register space, must be NT3H_REG_SESSION.
+ * @param[in] enable : True to mirror SRAM into user memory at SRAM_MIRROR_BLOCK.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_set_sram_mirror(nt3h_dev_t *dev, nt3h_reg_space_t space, bool enable);
+
+/*!
+ * @brief This API applies several register field updates, combining fields
+ * of the same register into a single masked write.
+ *
+ * @note All values and spaces are checked before anything is written: a
+ *       field not writable in the given space (session-only NC_REG and NS_REG
+ *       fields in configuration, REG_LOCK and I2C_CLOCK_STR in session) is
+ *       refused. Session registers cost one transaction per distinct register;
+ *       configuration registers cost one block read and one EEPROM program in
+ *       total. From C++, nt3h::field_value<SPACE, FIELD, VALUE>() checks the
+ *       space and range at compile time.
+ *
+ * @param[in]    dev : Pointer to device structure.
+ * @param[in]  space : Session or configuration registers.
+ * @param[in] fields : Array of field updates.
+ * @param[in]    cnt : Number of field updates.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_write_fields(nt3h_dev_t *dev, nt3h_reg_space_t space, const nt3h_field_value_t *fields, size_t cnt);
+
+/*!
+ * @brief This API reads a single register field.
+ *
+ * @note Fields which do not exist in the given space are refused.
+ *
+ * @param[in]    dev : Pointer to device structure.
+ * @param[in]  space : Session or configuration registers.
+ * @param[in]  field : Field to read.
+ * @param[out] value : Pointer to store right-aligned field value.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_read_field(nt3h_dev_t *dev, nt3h_reg_space_t space, nt3h_field_t field, uint8_t *value);
+
+/*!
+ * @brief This API initialises EEPROM wear telemetry.
+ *
+ * @note Attach to a device with dev->wear. Counts may be preloaded from a
+ *       previous save; set rate_per_s/burst/reject afterwards to enforce a budget.
+ *
+ * @param[out]  wear : Pointer to wear structure.
+ * @param[in] counts : Per block counters, NT3H_WEAR_BLOCKS entries.
+ * @param[in]  clear : Zero the counters rather than keeping restored values.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_wear_init(nt3h_wear_t *wear, uint32_t *counts, bool clear);
+
+/*!
+ * @brief This API reports the most programmed blocks, hottest first.
+ *
+ * @param[in]   wear : Pointer to wear structure.
+ * @param[out] block : Array to store block addresses.
+ * @param[out] count : Array to store program counts.
+ * @param[in]      n : Size of output arrays.
+ *
+ * @return Number of entries stored (blocks never programmed are skipped).
+ */
+size_t nt3h_wear_hottest(const nt3h_wear_t *wear, uint8_t *block, uint32_t *count, size_t n);
 
+/*!
+ * @brief This API initialises hot block remapping.
+ *
+ * @note Attach to a device with dev->remap. Set entries[].logical, sorted
+ *       ascending, before calling; physical locations may be restored from
+ *       a previous save, and must then be distinct pool blocks. Logical
+ *       and spare blocks must be distinct user memory blocks.
+ *
+ * @param[out]    remap : Pointer to remap structure.
+ * @param[in]     is_2k : Device is the 2K variant, else 1K.
+ * @param[in,out] entries : Remapped blocks.
+ * @param[in]   n_entries : Number of remapped blocks.
+ * @param[in]      spares : Spare physical blocks.
+ * @param[in]    n_spares : Number of spare blocks, at least 1.
+ * @param[in]       clear : Place every block at its logical address rather
+ *                          than keeping restored locations.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_remap_init(nt3h_remap_t *remap, bool is_2k, nt3h_remap_entry_t *entries, size_t n_entries,
+                              const uint8_t *spares, size_t n_spares, bool clear);
 
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+/*!
+ * @brief This API clears the instrumentation counters.
+ *
+ * @note Only available when built with NT3H_ENABLE_INSTRUMENTATION, which
+ *       must be defined identically for the driver and all its users.
+ *
+ * @param[in] dev : Pointer to device structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_instr_reset(nt3h_dev_t *dev);
 
-// /* Helpful toString log print functions */
-// #if DEBUG_NFC == 1
-// void NFC_PrintMemory(NFC_HandleTypeDef* nfc, uint16_t blockAddress, uint16_t noOfBlocks);
-// void NFC_PrintDeviceProperties(NFC_HandleTypeDef *nfc);
-// void NFC_PrintSessionRegisters(NFC_HandleTypeDef *hnfc);
-// void NFC_PrintConfigRegisters(NFC_HandleTypeDef *hnfc);
-// #endif
-// /* ========================================== */
+/*!
+ * @brief This API records a latency sample into a histogram.
+ *
+ * @param[in,out] hist : Pointer to histogram.
+ * @param[in]       us : Sample in microseconds.
+ */
+void nt3h_hist_record(nt3h_hist_t *hist, uint32_t us);
+
+/*!
+ * @brief This API returns the lowest latency, in us, that falls in a bucket.
+ *
+ * @param[in] bucket : Bucket index, 0 to NT3H_HIST_BUCKETS - 1.
+ *
+ * @return Bucket lower bound in us.
+ */
+uint32_t nt3h_hist_bucket_us(size_t bucket);
+
+/*!
+ * @brief This API estimates a percentile from a histogram.
+ *
+ * @param[in]    hist : Pointer to histogram.
+ * @param[in] permille : Percentile in tenths of a percent (e.g. 990 for p99).
+ *
+ * @return Upper bound of the bucket holding the percentile, in us (0 if empty).
+ */
+uint32_t nt3h_hist_percentile(const nt3h_hist_t *hist, uint32_t permille);
+
+/*!
+ * @brief This API formats latency histograms as text, one line per class.
+ *
+ * @note Each line reports count, min, mean, p50, p90, p99 and max in us.
+ *
+ * @param[in]  latency : Pointer to latency histograms.
+ * @param[out]     buf : Buffer to store null terminated text.
+ * @param[in]      len : Size of buffer.
+ *
+ * @return Number of characters that would have been written, as snprintf.
+ */
+int nt3h_latency_format(const nt3h_latency_t *latency, char *buf, size_t len);
+#endif
+
+#ifdef NT3H_ENABLE_TRACE
+/*!
+ * @brief This API initialises a trace ring buffer over user supplied memory.
+ *
+ * @note Attach to a device with dev->trace. When full, the oldest records are dropped.
+ *
+ * @param[out] trace : Pointer to trace structure.
+ * @param[in]    buf : Backing memory.
+ * @param[in]   size : Size of backing memory, in bytes.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_trace_init(nt3h_trace_t *trace, uint8_t *buf, size_t size);
+
+/*!
+ * @brief This API copies the trace, oldest record first, into a linear buffer.
+ *
+ * @param[in]  trace : Pointer to trace structure.
+ * @param[out]   out : Buffer to store the trace.
+ * @param[in]    len : Size of buffer, must be at least trace->used.
+ * @param[out] n_out : Number of bytes copied.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_trace_export(const nt3h_trace_t *trace, uint8_t *out, size_t len, size_t *n_out);
+
+/*!
+ * @brief This API decodes the next record of an exported trace.
+ *
+ * @param[in]      buf : Exported trace.
+ * @param[in]      len : Length of exported trace.
+ * @param[in,out]  pos : Read position, start at 0.
+ * @param[out]     rec : Decoded record, data points into buf.
+ *
+ * @return True if a record was decoded, false at end of trace or on truncation.
+ */
+bool nt3h_trace_next(const uint8_t *buf, size_t len, size_t *pos, nt3h_trace_record_t *rec);
+
+/*!
+ * @brief This API summarises an exported trace.
+ *
+ * @param[in]  buf : Exported trace.
+ * @param[in]  len : Length of exported trace.
+ * @param[out] sum : Pointer to store summary.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_trace_summarise(const uint8_t *buf, size_t len, nt3h_trace_summary_t *sum);
+
+/*!
+ * @brief This API replays an exported trace against a device's transport callbacks.
+ *
+ * @note Writes are replayed verbatim; reads are issued with the recorded length
+ *       and compared with the recorded data and status. With timed set, gaps
+ *       between records are reproduced through target->delay_us. If the
+ *       target has a time_us clock, each record is issued at its recorded
+ *       offset from the first, so bus time on the target is not added twice.
+ *
+ * @param[in]         buf : Exported trace.
+ * @param[in]         len : Length of exported trace.
+ * @param[in]      target : Device whose read/write/delay_ms callbacks are driven.
+ * @param[in]       timed : Reproduce inter-record gaps.
+ * @param[out] mismatches : Optional count of reads or statuses that differed.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_trace_replay(const uint8_t *buf, size_t len, nt3h_dev_t *target, bool timed, uint32_t *mismatches);
+#endif
+
+#ifdef NT3H_ENABLE_LOG
+/*!
+ * @brief This API initialises a binary debug log ring.
+ *
+ * @note Attach to a device with dev->log. The driver is the only producer;
+ *       a single reader drains entries with nt3h_log_pop().
+ *
+ * @param[out]    log : Pointer to log structure.
+ * @param[in] entries : Entry storage.
+ * @param[in]   count : Number of entries, must be a power of two.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_log_init(nt3h_log_t *log, nt3h_log_entry_t *entries, uint32_t count);
+
+/*!
+ * @brief This API removes the oldest entry from a binary debug log.
+ *
+ * @param[in]  log : Pointer to log structure.
+ * @param[out] out : Pointer to store entry.
+ *
+ * @return True if an entry was returned.
+ */
+bool nt3h_log_pop(nt3h_log_t *log, nt3h_log_entry_t *out);
+
+/*!
+ * @brief This API formats a log entry as text, for offline decoding.
+ *
+ * @param[in]  entry : Pointer to log entry.
+ * @param[out]   buf : Buffer to store null terminated text.
+ * @param[in]    len : Size of buffer.
+ *
+ * @return Number of characters that would have been written, as snprintf.
+ */
+int nt3h_log_format(const nt3h_log_entry_t *entry, char *buf, size_t len);
+
+/*!
+ * @brief This API logs the session registers (NT3H_EVT_SESSION_REGS).
+ *
+ * @param[in] dev : Pointer to device structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_log_session_registers(nt3h_dev_t *dev);
+
+/*!
+ * @brief This API logs the configuration registers (NT3H_EVT_CONFIG_REGS).
+ *
+ * @param[in] dev : Pointer to device structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_log_config_registers(nt3h_dev_t *dev);
+
+/*!
+ * @brief This API logs the contents of memory blocks (NT3H_EVT_MEMORY_LO/HI).
+ *
+ * @param[in]  dev : Pointer to device structure.
+ * @param[in] addr : First block to log.
+ * @param[in]  cnt : Number of blocks to log.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_log_memory(nt3h_dev_t *dev, uint8_t addr, uint8_t cnt);
+#endif
 
 
 #ifdef __cplusplus
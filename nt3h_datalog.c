@@ -0,0 +1,351 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_datalog.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_datalog.c
+ * @brief Wear-levelled append-only data logger in NT3H user memory.
+ */
+#include <string.h>
+#include "nt3h_datalog.h"
+
+#define DATALOG_SEQ_SHIFT   4
+#define DATALOG_USED_MASK   0x0FU
+#define DATALOG_SEQ_MAX     (0xFFFFFFFFU >> DATALOG_SEQ_SHIFT)
+
+/* NDEF TLV and record header bytes */
+#define NDEF_TLV_MESSAGE    0x03
+#define NDEF_TLV_LONG_LEN   0xFF
+#define NDEF_TLV_TERMINATOR 0xFE
+#define NDEF_REC_MB_ME_MIME 0xC2    /* MB | ME | TNF media type, SR clear */
+
+/*!
+ * @brief This internal API returns the number of payload bytes used when a block is full.
+ */
+static uint8_t block_capacity(const nt3h_datalog_t *log);
+
+/*!
+ * @brief This internal API reads the header of a ring block.
+ *
+ * @param[in]      log : Pointer to logger structure.
+ * @param[in]    index : Ring index of block.
+ * @param[out]     seq : Sequence number, 0 if never written.
+ * @param[out]    used : Payload bytes used.
+ * @param[out] payload : Optional buffer to store payload bytes.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t read_header(const nt3h_datalog_t *log, uint8_t index, uint32_t *seq,
+                                 uint8_t *used, uint8_t *payload);
+
+/*!
+ * @brief This internal API programs the block currently being filled.
+ */
+static nt3h_status_t program_head(nt3h_datalog_t *log);
+
+/*!
+ * @brief This internal API validates the logger structure.
+ */
+static nt3h_status_t null_ptr_check(const nt3h_datalog_t *log);
+
+/*!
+ * @brief This API initialises a data logger over a range of user memory blocks.
+ */
+nt3h_status_t nt3h_datalog_init(nt3h_datalog_t *log, nt3h_dev_t *dev, bool is_2k, uint8_t first_block,
+                                uint8_t n_blocks, uint8_t record_size)
+{
+    if (log == NULL || dev == NULL)
+        return NT3H_E_NULL_PTR;
+
+    uint8_t user_blocks = is_2k ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+
+    /* Check parameters are valid, the ring must lie within user memory */
+    if (first_block == 0 || n_blocks < 2 || record_size == 0 || record_size > NT3H_DATALOG_PAYLOAD_LEN ||
+        (uint16_t)first_block + n_blocks - 1 > user_blocks)
+        return NT3H_E_INVALID_ARGS;
+
+    memset(log, 0, sizeof(*log));
+    log->dev         = dev;
+    log->is_2k       = is_2k;
+    log->first_block = first_block;
+    log->n_blocks    = n_blocks;
+    log->record_size = record_size;
+    log->seq         = 1;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API clears the ring, programming every block header once.
+ */
+nt3h_status_t nt3h_datalog_format(nt3h_datalog_t *log)
+{
+    nt3h_status_t rslt;
+    uint8_t block[NTAG_I2C_BLOCK_SIZE] = { 0 };
+
+    if ((rslt = null_ptr_check(log)) != NT3H_OK)
+        return rslt;
+
+    for (uint8_t i = 0; i < log->n_blocks; i++)
+    {
+        if ((rslt = nt3h_write_blocks(log->dev, log->first_block + i, block, 1)) != NT3H_OK)
+            return rslt;
+    }
+
+    log->head = 0;
+    log->seq  = 1;
+    log->used = 0;
+    memset(log->pending, 0, sizeof(log->pending));
+
+    return rslt;
+}
+
+/*!
+ * @brief This API locates the newest block of an existing log.
+ */
+nt3h_status_t nt3h_datalog_recover(nt3h_datalog_t *log)
+{
+    nt3h_status_t rslt;
+    uint32_t seq0, seq;
+    uint8_t used;
+
+    if ((rslt = null_ptr_check(log)) != NT3H_OK)
+        return rslt;
+
+    if ((rslt = read_header(log, 0, &seq0, &used, NULL)) != NT3H_OK)
+        return rslt;
+
+    log->used = 0;
+    memset(log->pending, 0, sizeof(log->pending));
+
+    if (seq0 == 0)
+    {
+        /* Empty log */
+        log->head = 0;
+        log->seq  = 1;
+        return rslt;
+    }
+
+    /* Sequence numbers rise by one along the ring from block 0 up to the
+     * newest block; every block after it is older than block 0 (or empty).
+     * Binary search for the first such block. */
+    uint16_t lo = 1, hi = log->n_blocks;
+
+    while (lo < hi)
+    {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+
+        if ((rslt = read_header(log, (uint8_t)mid, &seq, &used, NULL)) != NT3H_OK)
+            return rslt;
+
+        if (seq < seq0)
+            hi = mid;
+        else
+            lo = (uint16_t)(mid + 1);
+    }
+
+    uint8_t newest = (uint8_t)(lo - 1);
+
+    if ((rslt = read_header(log, newest, &seq, &used, log->pending)) != NT3H_OK)
+        return rslt;
+
+    if (used < block_capacity(log))
+    {
+        /* Newest block was flushed part-full, keep filling it */
+        log->head = newest;
+        log->seq  = seq;
+        log->used = used;
+    }
+    else
+    {
+        log->head = (uint8_t)((newest + 1) % log->n_blocks);
+        log->seq  = seq + 1;
+        memset(log->pending, 0, sizeof(log->pending));
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API appends one record.
+ */
+nt3h_status_t nt3h_datalog_append(nt3h_datalog_t *log, const void *record)
+{
+    nt3h_status_t rslt;
+
+    if ((rslt = null_ptr_check(log)) != NT3H_OK)
+        return rslt;
+
+    if (record == NULL)
+        return NT3H_E_INVALID_ARGS;
+
+    /* Sequence space exhausted, numbers would no longer be ordered */
+    if (log->seq > DATALOG_SEQ_MAX)
+        return NT3H_E_INVALID_ARGS;
+
+    memcpy(&log->pending[log->used], record, log->record_size);
+    log->used += log->record_size;
+
+    if (log->used < block_capacity(log))
+        return rslt;
+
+    if ((rslt = program_head(log)) != NT3H_OK)
+    {
+        /* Leave the record unappended so the caller can retry */
+        log->used -= log->record_size;
+        return rslt;
+    }
+
+    log->head = (uint8_t)((log->head + 1) % log->n_blocks);
+    log->seq++;
+    log->used = 0;
+    memset(log->pending, 0, sizeof(log->pending));
+
+    return rslt;
+}
+
+/*!
+ * @brief This API programs the partially filled block, if any.
+ */
+nt3h_status_t nt3h_datalog_flush(nt3h_datalog_t *log)
+{
+    nt3h_status_t rslt;
+
+    if ((rslt = null_ptr_check(log)) != NT3H_OK)
+        return rslt;
+
+    if (log->used == 0)
+        return rslt;
+
+    return program_head(log);
+}
+
+/*!
+ * @brief This API writes the NDEF message header and terminator around the ring.
+ */
+nt3h_status_t nt3h_datalog_write_ndef(nt3h_datalog_t *log)
+{
+    nt3h_status_t rslt;
+    uint8_t hdr[NT3H_DATALOG_NDEF_BLOCKS * NTAG_I2C_BLOCK_SIZE];
+    static const char mime_type[] = NT3H_DATALOG_MIME_TYPE;
+    uint8_t terminator = NDEF_TLV_TERMINATOR;
+
+    if ((rslt = null_ptr_check(log)) != NT3H_OK)
+        return rslt;
+
+    uint8_t user_blocks = log->is_2k ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+
+    /* Header must fit after block 0 and the terminator before the end of user memory */
+    if (log->first_block < 1 + NT3H_DATALOG_NDEF_BLOCKS || (uint16_t)log->first_block + log->n_blocks > user_blocks)
+        return NT3H_E_INVALID_ARGS;
+
+    uint32_t payload_len = (uint32_t)log->n_blocks * NTAG_I2C_BLOCK_SIZE;
+    uint32_t record_len  = 1 + 1 + 4 + (sizeof(mime_type) - 1) + payload_len;
+
+    /* Header is sized so the record payload starts exactly at the ring */
+    hdr[0]  = NDEF_TLV_MESSAGE;
+    hdr[1]  = NDEF_TLV_LONG_LEN;
+    hdr[2]  = (uint8_t)(record_len >> 8);
+    hdr[3]  = (uint8_t)record_len;
+    hdr[4]  = NDEF_REC_MB_ME_MIME;
+    hdr[5]  = (uint8_t)(sizeof(mime_type) - 1);
+    hdr[6]  = (uint8_t)(payload_len >> 24);
+    hdr[7]  = (uint8_t)(payload_len >> 16);
+    hdr[8]  = (uint8_t)(payload_len >> 8);
+    hdr[9]  = (uint8_t)payload_len;
+    memcpy(&hdr[10], mime_type, sizeof(mime_type) - 1);
+
+    if ((rslt = nt3h_write_blocks(log->dev, log->first_block - NT3H_DATALOG_NDEF_BLOCKS, hdr,
+                                  NT3H_DATALOG_NDEF_BLOCKS)) != NT3H_OK)
+        return rslt;
+
+    return nt3h_write_bytes(log->dev, log->first_block + log->n_blocks, 0, &terminator, 1);
+}
+
+/*!
+ * @brief This internal API returns the number of payload bytes used when a block is full.
+ */
+static uint8_t block_capacity(const nt3h_datalog_t *log)
+{
+    /* Records never straddle blocks */
+    return (uint8_t)((NT3H_DATALOG_PAYLOAD_LEN / log->record_size) * log->record_size);
+}
+
+/*!
+ * @brief This internal API reads the header of a ring block.
+ */
+static nt3h_status_t read_header(const nt3h_datalog_t *log, uint8_t index, uint32_t *seq,
+                                 uint8_t *used, uint8_t *payload)
+{
+    nt3h_status_t rslt;
+    uint8_t block[NTAG_I2C_BLOCK_SIZE];
+
+    if ((rslt = nt3h_read_blocks(log->dev, log->first_block + index, block, 1)) != NT3H_OK)
+        return rslt;
+
+    uint32_t hdr = (uint32_t)block[0] | ((uint32_t)block[1] << 8) |
+                   ((uint32_t)block[2] << 16) | ((uint32_t)block[3] << 24);
+
+    *seq  = hdr >> DATALOG_SEQ_SHIFT;
+    *used = (uint8_t)(hdr & DATALOG_USED_MASK);
+
+    if (*used > NT3H_DATALOG_PAYLOAD_LEN)
+        *used = NT3H_DATALOG_PAYLOAD_LEN;
+
+    if (payload != NULL)
+        memcpy(payload, &block[NT3H_DATALOG_HDR_LEN], NT3H_DATALOG_PAYLOAD_LEN);
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API programs the block currently being filled.
+ */
+static nt3h_status_t program_head(nt3h_datalog_t *log)
+{
+    uint8_t block[NTAG_I2C_BLOCK_SIZE];
+    uint32_t hdr = (log->seq << DATALOG_SEQ_SHIFT) | (log->used & DATALOG_USED_MASK);
+
+    block[0] = (uint8_t)hdr;
+    block[1] = (uint8_t)(hdr >> 8);
+    block[2] = (uint8_t)(hdr >> 16);
+    block[3] = (uint8_t)(hdr >> 24);
+    memcpy(&block[NT3H_DATALOG_HDR_LEN], log->pending, NT3H_DATALOG_PAYLOAD_LEN);
+
+    return nt3h_write_blocks(log->dev, log->first_block + log->head, block, 1);
+}
+
+/*!
+ * @brief This internal API validates the logger structure.
+ */
+static nt3h_status_t null_ptr_check(const nt3h_datalog_t *log)
+{
+    if (log == NULL || log->dev == NULL || log->n_blocks == 0 || log->record_size == 0)
+        return NT3H_E_NULL_PTR;
+
+    return NT3H_OK;
+}
@@ -0,0 +1,172 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_datalog.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_datalog.h
+ * @brief Wear-levelled append-only data logger in NT3H user memory.
+ *
+ * Records are packed into a ring of consecutive user memory blocks. Each
+ * block starts with a 4-byte little endian header (sequence number in the
+ * upper 28 bits, payload bytes used in the lower 4 bits)
+ * followed by 12 payload bytes, so appends program each block once when it
+ * fills and every block of the ring is programmed equally often. The block
+ * holding the newest data is found at start-up by a binary search over the
+ * sequence numbers.
+ *
+ * Optionally the ring is wrapped in an NDEF message so phones can read the
+ * whole log as a single "application/x-nt3h-log" MIME record. The NDEF
+ * header occupies the two blocks before the ring and the terminator TLV the
+ * first byte of the block after it. Any blocks between block 1 and the
+ * NDEF header must be zero, which phones skip as NULL TLVs.
+ */
+
+#ifndef _NT3H_DATALOG_H_
+#define _NT3H_DATALOG_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "nt3h.h"
+
+#define NT3H_DATALOG_HDR_LEN        4
+#define NT3H_DATALOG_PAYLOAD_LEN    (NTAG_I2C_BLOCK_SIZE - NT3H_DATALOG_HDR_LEN)
+#define NT3H_DATALOG_NDEF_BLOCKS    2
+#define NT3H_DATALOG_MIME_TYPE      "application/x-nt3h-log"
+
+/*
+ * @brief Data logger state.
+ */
+typedef struct {
+
+    /* Device the log lives on */
+    nt3h_dev_t *dev;
+
+    /* 2K part, bounding the ring to its user memory */
+    bool is_2k;
+
+    /* First block and number of blocks of the ring */
+    uint8_t first_block;
+    uint8_t n_blocks;
+
+    /* Size of each record, 1 to NT3H_DATALOG_PAYLOAD_LEN */
+    uint8_t record_size;
+
+    /* Ring index of the block currently being filled */
+    uint8_t head;
+
+    /* Sequence number of the block currently being filled (starts at 1) */
+    uint32_t seq;
+
+    /* Payload of the block currently being filled */
+    uint8_t pending[NT3H_DATALOG_PAYLOAD_LEN];
+    uint8_t used;
+
+} nt3h_datalog_t;
+
+/*!
+ * @brief This API initialises a data logger over a range of user memory blocks.
+ *
+ * @note No device access is made; call nt3h_datalog_recover() on an existing
+ *       log or nt3h_datalog_format() on a new one.
+ *
+ * @param[out]         log : Pointer to logger structure.
+ * @param[in]          dev : Pointer to device structure.
+ * @param[in]        is_2k : Device is a 2K part.
+ * @param[in]  first_block : First block of the ring.
+ * @param[in]     n_blocks : Number of blocks in the ring, at least 2, all within user memory.
+ * @param[in]  record_size : Size of each record, 1 to NT3H_DATALOG_PAYLOAD_LEN.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_datalog_init(nt3h_datalog_t *log, nt3h_dev_t *dev, bool is_2k, uint8_t first_block,
+                                uint8_t n_blocks, uint8_t record_size);
+
+/*!
+ * @brief This API clears the ring, programming every block header once.
+ *
+ * @param[in] log : Pointer to logger structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_datalog_format(nt3h_datalog_t *log);
+
+/*!
+ * @brief This API locates the newest block of an existing log.
+ *
+ * @note Reads O(log n) block headers, plus the newest block if partially filled.
+ *
+ * @param[in] log : Pointer to logger structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_datalog_recover(nt3h_datalog_t *log);
+
+/*!
+ * @brief This API appends one record.
+ *
+ * @note The record is buffered in RAM; a block is programmed only when it
+ *       fills. Call nt3h_datalog_flush() to make a partial block visible.
+ *
+ * @param[in]    log : Pointer to logger structure.
+ * @param[in] record : Record of log->record_size bytes.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_datalog_append(nt3h_datalog_t *log, const void *record);
+
+/*!
+ * @brief This API programs the partially filled block, if any.
+ *
+ * @note Further appends continue filling the same block, which is then
+ *       programmed again when full.
+ *
+ * @param[in] log : Pointer to logger structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_datalog_flush(nt3h_datalog_t *log);
+
+/*!
+ * @brief This API writes the NDEF message header and terminator around the ring.
+ *
+ * @note Requires first_block >= 1 + NT3H_DATALOG_NDEF_BLOCKS and a user
+ *       memory block after the ring for the terminator. Only needs to
+ *       be written once, the ring contents are updated in place.
+ *
+ * @param[in] log : Pointer to logger structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_datalog_write_ndef(nt3h_datalog_t *log);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* NT3H_DATALOG_H_ */
@@ -44,6 +44,9 @@ extern "C" {
  */
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+
+#include "ntag_defs.h"
 
 
 #define NTAG_1K
@@ -54,12 +57,30 @@ extern "C" {
 #define NT3H_MEM_BLOCK_CONFIG_1K        0x3A
 #define NT3H_MEM_BLOCK_SESSION_REGS_1K  0xFE
 
+/* Whole user memory blocks, starting at block 1 */
+#define NT3H_USER_BLOCKS_1K             0x37
+#define NT3H_USER_BLOCKS_2K             0x77
+
+/* Empty NDEF message TLV followed by a terminator TLV */
+#define NT3H_EMPTY_NDEF_TLV             { 0x03, 0x00, 0xFE }
+
+/* Leading bytes of block 0 that do not read back as written: byte 0 reads
+ * as the manufacturer ID but sets the I2C address, bytes 1 to 9 are read only */
+#define NT3H_BLOCK_0_FIXED_LEN          10
+
 /* Factory default value of memory block 0 */
 #define NT3H_FACTORY_VALUE_BLOCK_0  { 0x04, 0x00, 0x00, 0x00, \
                                       0x00, 0x00, 0x00, 0x00, \
                                       0x00, 0x00, 0x00, 0x00, \
                                       0xE1, 0x10, 0x6D, 0x00 }
 
+/* Capability container memory size byte of block 0, per variant */
+#define NT3H_CC_MLEN_OFFSET             14
+#define NT3H_CC_MLEN_1K                 0x6D
+#define NT3H_CC_MLEN_2K                 0xEA
+
+/* Factory default values of the three blocks ending at the configuration
+ * block, blocks 56 to 58 on the 1K part and 120 to 122 on the 2K part */
 #define NT3H_FACTORY_VALUE_BLOCK_56 { 0x00, 0x00, 0x00, 0x00, \
                                       0x00, 0x00, 0x00, 0x00, \
                                       0x00, 0x00, 0x00, 0x00, \
@@ -75,6 +96,32 @@ extern "C" {
                                       0x00, 0x00, 0x00, 0x00, \
                                       0x00, 0x00, 0x00, 0x00 }
 
+/* Default I2C memory lock timings, used when left as zero in nt3h_lock_t */
+#define NT3H_LOCK_DEFAULT_TIMEOUT_MS    20
+#define NT3H_LOCK_DEFAULT_POLL_MS       1
+
+/* Number of blocks tracked by EEPROM wear telemetry (full I2C address space) */
+#define NT3H_WEAR_BLOCKS                256
+
+/* Default programs of a remapped block before it moves, used when left as zero in nt3h_remap_t */
+#define NT3H_REMAP_DEFAULT_INTERVAL     16
+
+/* Watchdog timer resolution and range (WDT_MS:WDT_LS) */
+#define NT3H_WDT_TICK_NS                9430U
+#define NT3H_WDT_MAX_TICKS              0xFFFFU
+#define NT3H_WDT_MAX_US                 ((NT3H_WDT_MAX_TICKS * NT3H_WDT_TICK_NS) / 1000U)
+
+/* Block program times */
+#define NT3H_EEPROM_WRITE_US            4000U
+#define NT3H_SRAM_WRITE_US              400U
+
+/* Default EEPROM program time calibration, used when left as zero in nt3h_prog_time_t */
+#define NT3H_PROG_DEFAULT_CALIB_WRITES  8
+#define NT3H_PROG_DEFAULT_POLL_US       100U
+
+/* The first steady-state poll follows the estimate by poll_us / NT3H_PROG_GUARD_DIV */
+#define NT3H_PROG_GUARD_DIV             4U
+
 
 /*!
  * @brief NT3H API status codes
@@ -84,13 +131,144 @@ typedef enum {
     NT3H_E_NULL_PTR,
     NT3H_E_DEV_NOT_FOUND,
     NT3H_E_INVALID_ARGS,
+    NT3H_E_TIMEOUT,
+    NT3H_E_WRITE_BUDGET,
+    NT3H_E_NOT_FOUND,
+    NT3H_E_NO_SPACE,
+    NT3H_E_NAK,
+    NT3H_E_BUS_TIMEOUT,
+    NT3H_E_ARB_LOST,
+    NT3H_E_VERIFY,
+    NT3H_E_CRC,
 } nt3h_status_t;
 
+/*!
+ * @brief Register space targeted by a register access.
+ */
+typedef enum {
+    NT3H_REG_SESSION,   /* Volatile session registers, take effect immediately */
+    NT3H_REG_CONFIG,    /* EEPROM configuration registers, loaded at power-on */
+} nt3h_reg_space_t;
+
+/*!
+ * @brief Event that switches the field detect pin off (NC_REG FD_OFF).
+ */
+typedef enum {
+    NT3H_FD_OFF_FIELD_OFF       = 0x00, /* RF field switched off */
+    NT3H_FD_OFF_HALT            = 0x01, /* RF field off or tag set to HALT */
+    NT3H_FD_OFF_LAST_NDEF_READ  = 0x02, /* RF field off or last NDEF block read */
+    NT3H_FD_OFF_PTHRU_DONE      = 0x03, /* Pass-through data read/written (with NT3H_FD_ON_PTHRU_READY) */
+} nt3h_fd_off_t;
+
+/*!
+ * @brief Event that switches the field detect pin on (NC_REG FD_ON).
+ */
+typedef enum {
+    NT3H_FD_ON_FIELD_ON         = 0x00, /* RF field switched on */
+    NT3H_FD_ON_FIRST_START      = 0x01, /* First valid start of communication */
+    NT3H_FD_ON_SELECTED         = 0x02, /* Tag selected */
+    NT3H_FD_ON_PTHRU_READY      = 0x03, /* Data ready in pass-through mode */
+} nt3h_fd_on_t;
+
+/*!
+ * @brief Pass-through transfer direction (NC_REG TRANSFER_DIR).
+ */
+typedef enum {
+    NT3H_DIR_I2C_TO_RF          = 0x00,
+    NT3H_DIR_RF_TO_I2C          = 0x01,
+} nt3h_transfer_dir_t;
+
+/* Register spaces in which a field may be read or written */
+#define NT3H_FIELD_SESSION_RD   0x01
+#define NT3H_FIELD_SESSION_WR   0x02
+#define NT3H_FIELD_CONFIG_RD    0x04
+#define NT3H_FIELD_CONFIG_WR    0x08
+#define NT3H_FIELD_SESSION      (NT3H_FIELD_SESSION_RD | NT3H_FIELD_SESSION_WR)
+#define NT3H_FIELD_CONFIG       (NT3H_FIELD_CONFIG_RD | NT3H_FIELD_CONFIG_WR)
+
+/*!
+ * @brief Register field descriptor: access spaces in bits 16 to 19, register
+ * offset in bits 8 to 15, bit mask in the low byte.
+ *
+ * Offsets do not mean the same register in both spaces (offset 6 is REG_LOCK
+ * in configuration but NS_REG in session), so every access is checked against
+ * the spaces of the field.
+ */
+typedef uint32_t nt3h_field_t;
+
+#define NT3H_FIELD(reg, mask, spaces)   ((nt3h_field_t)(((uint32_t)(spaces) << 16) | ((reg) << 8) | (mask)))
+#define NT3H_FIELD_REG(field)           ((uint8_t)((field) >> 8))
+#define NT3H_FIELD_MASK(field)          ((uint8_t)((field) & 0xFF))
+#define NT3H_FIELD_SPACES(field)        ((uint8_t)(((field) >> 16) & 0x0F))
+
+/* Access flag of a register space for reads (write = false) or writes */
+#define NT3H_FIELD_ACCESS(space, write) \
+    ((uint8_t)(((space) == NT3H_REG_SESSION ? NT3H_FIELD_SESSION_RD : NT3H_FIELD_CONFIG_RD) << ((write) ? 1 : 0)))
+
+/* NC_REG fields (PTHRU_ON_OFF and SRAM_MIRROR_ON_OFF in session registers only) */
+#define NT3H_FIELD_NC_I2C_RST_ON_OFF        NT3H_FIELD(NTAG_MEM_OFFSET_NC_REG, NTAG_NC_REG_MASK_I2C_RST_ON_OFF, \
+                                                       NT3H_FIELD_SESSION | NT3H_FIELD_CONFIG)
+#define NT3H_FIELD_NC_PTHRU_ON_OFF          NT3H_FIELD(NTAG_MEM_OFFSET_NC_REG, NTAG_NC_REG_MASK_PTHRU_ON_OFF, \
+                                                       NT3H_FIELD_SESSION)
+#define NT3H_FIELD_NC_FD_OFF                NT3H_FIELD(NTAG_MEM_OFFSET_NC_REG, NTAG_NC_REG_MASK_FD_OFF, \
+                                                       NT3H_FIELD_SESSION | NT3H_FIELD_CONFIG)
+#define NT3H_FIELD_NC_FD_ON                 NT3H_FIELD(NTAG_MEM_OFFSET_NC_REG, NTAG_NC_REG_MASK_FD_ON, \
+                                                       NT3H_FIELD_SESSION | NT3H_FIELD_CONFIG)
+#define NT3H_FIELD_NC_SRAM_MIRROR_ON_OFF    NT3H_FIELD(NTAG_MEM_OFFSET_NC_REG, NTAG_NC_REG_MASK_SRAM_MIRROR_ON_OFF, \
+                                                       NT3H_FIELD_SESSION)
+#define NT3H_FIELD_NC_TRANSFER_DIR          NT3H_FIELD(NTAG_MEM_OFFSET_NC_REG, NTAG_NC_REG_MASK_TRANSFER_DIR, \
+                                                       NT3H_FIELD_SESSION | NT3H_FIELD_CONFIG)
+
+/* Whole byte fields */
+#define NT3H_FIELD_LAST_NDEF_BLOCK          NT3H_FIELD(NTAG_MEM_OFFSET_LAST_NDEF_BLOCK, 0xFF, \
+                                                       NT3H_FIELD_SESSION | NT3H_FIELD_CONFIG)
+#define NT3H_FIELD_SRAM_MIRROR_BLOCK        NT3H_FIELD(NTAG_MEM_OFFSET_SRAM_MIRROR_BLOCK, 0xFF, \
+                                                       NT3H_FIELD_SESSION | NT3H_FIELD_CONFIG)
+#define NT3H_FIELD_WDT_LS                   NT3H_FIELD(NTAG_MEM_OFFSET_WDT_LS, 0xFF, \
+                                                       NT3H_FIELD_SESSION | NT3H_FIELD_CONFIG)
+#define NT3H_FIELD_WDT_MS                   NT3H_FIELD(NTAG_MEM_OFFSET_WDT_MS, 0xFF, \
+                                                       NT3H_FIELD_SESSION | NT3H_FIELD_CONFIG)
+
+/* I2C_CLOCK_STR field (writable in configuration registers only) */
+#define NT3H_FIELD_I2C_CLOCK_STR            NT3H_FIELD(NTAG_MEM_OFFSET_I2C_CLOCK_STR, NTAG_I2C_CLOCK_STR_MASK_ON_OFF, \
+                                                       NT3H_FIELD_SESSION_RD | NT3H_FIELD_CONFIG)
+
+/* REG_LOCK fields (configuration registers only) */
+#define NT3H_FIELD_REG_LOCK_I2C             NT3H_FIELD(NTAG_MEM_OFFSET_REG_LOCK, NTAG_REG_LOCK_MASK_CONF_BYTES_ACCESS_I2C, \
+                                                       NT3H_FIELD_CONFIG)
+#define NT3H_FIELD_REG_LOCK_RF              NT3H_FIELD(NTAG_MEM_OFFSET_REG_LOCK, NTAG_REG_LOCK_MASK_CONF_BYTES_ACCESS_RF, \
+                                                       NT3H_FIELD_CONFIG)
+
+/* NS_REG fields (session registers only) */
+#define NT3H_FIELD_NS_I2C_LOCKED            NT3H_FIELD(NTAG_MEM_OFFSET_NS_REG, NTAG_NS_REG_MASK_I2C_LOCKED, \
+                                                       NT3H_FIELD_SESSION)
+
+/*!
+ * @brief Register field update, value is right-aligned (unshifted).
+ */
+typedef struct {
+
+    /* Field to update */
+    nt3h_field_t field;
+
+    /* New field value, 0 to (mask >> shift) */
+    uint8_t value;
+
+} nt3h_field_value_t;
+
 /*!
  * @brief Type declarations
+ *
+ * Bus functions should report a NAK, bus timeout or lost arbitration as
+ * NT3H_E_NAK, NT3H_E_BUS_TIMEOUT or NT3H_E_ARB_LOST so they can be retried
+ * (see nt3h_retry_t), and a missing device as NT3H_E_DEV_NOT_FOUND.
  */
 typedef nt3h_status_t (*nt3h_com_func_ptr_t)(uint8_t dev_id, uint8_t *data, size_t len);
 typedef void          (*nt3h_delay_ms_func_ptr_t)(uint32_t period_ms);
+typedef void          (*nt3h_delay_us_func_ptr_t)(uint32_t period_us);
+typedef void          (*nt3h_yield_func_ptr_t)(void);
+typedef uint32_t      (*nt3h_time_us_func_ptr_t)(void);
+typedef void          (*nt3h_wear_save_func_ptr_t)(void *ctx, const uint32_t *counts, size_t n);
 
 // /*
 //  * @brief Structure representation of Capability Container values.
@@ -112,6 +290,536 @@ typedef void          (*nt3h_delay_ms_func_ptr_t)(uint32_t period_ms);
 // } capability_cont_t;
 
 
+/*
+ * @brief I2C memory arbitration lock settings and statistics.
+ */
+typedef struct {
+
+    /* Maximum time to wait for RF side to release memory (0 = default) */
+    uint32_t timeout_ms;
+
+    /* Interval between NS_REG polls while waiting (0 = default) */
+    uint32_t poll_ms;
+
+    /* Acquire and release lock around multi-block operations */
+    bool auto_lock;
+
+    /* Lock is currently held by this driver */
+    bool held;
+
+    /* Number of successful lock acquisitions */
+    uint32_t acquisitions;
+
+    /* Number of acquisitions which found memory locked to RF */
+    uint32_t contentions;
+
+    /* Number of acquisitions which timed out */
+    uint32_t timeouts;
+
+    /* Cumulative time spent waiting on RF side, in ms */
+    uint32_t wait_ms;
+
+    /* Longest single wait on RF side, in ms */
+    uint32_t max_wait_ms;
+
+    /* Timestamp of the current acquisition, in us (requires time_us) */
+    uint32_t acquired_us;
+
+    /* Number of timed lock holds */
+    uint32_t holds;
+
+    /* Longest time the lock was held, in us */
+    uint32_t max_hold_us;
+
+} nt3h_lock_t;
+
+/*!
+ * @brief Backoff between retries of a failed bus transaction.
+ */
+typedef enum {
+    NT3H_RETRY_IMMEDIATE,
+    NT3H_RETRY_FIXED,
+    NT3H_RETRY_EXPONENTIAL,
+} nt3h_retry_mode_t;
+
+/*
+ * @brief Transport retry policy and statistics.
+ *
+ * Block and register transactions failing with NT3H_E_NAK, NT3H_E_BUS_TIMEOUT
+ * or NT3H_E_ARB_LOST are retried; any other error is returned at once.
+ */
+typedef struct {
+
+    /* Backoff between attempts */
+    nt3h_retry_mode_t mode;
+
+    /* Extra attempts after a transient failure, 0 disables retries */
+    uint8_t max_retries;
+
+    /* Fixed delay, or first delay of exponential backoff, in ms */
+    uint16_t delay_ms;
+
+    /* Upper bound of exponential backoff, in ms (0 = no bound) */
+    uint16_t max_delay_ms;
+
+    /* Skip the fixed delay after each EEPROM program and rely on the
+     * device NAKing, and the next transaction retrying, until it is done.
+     * Writes are rejected with NT3H_E_INVALID_ARGS if max_retries is 0 */
+    bool ack_polling;
+
+    /* Number of retries issued */
+    uint32_t retries;
+
+    /* Number of transactions which succeeded after retrying */
+    uint32_t recovered;
+
+    /* Number of transactions which failed with every retry used */
+    uint32_t exhausted;
+
+    /* Transient failures seen, by cause */
+    uint32_t naks;
+    uint32_t bus_timeouts;
+    uint32_t arb_lost;
+
+} nt3h_retry_t;
+
+/*
+ * @brief EEPROM program time calibration settings and statistics.
+ *
+ * When enabled, completion of each EEPROM block program is detected by
+ * polling EEPROM_WR_BUSY in NS_REG (a NAK while polling counts as busy)
+ * instead of waiting a fixed NT3H_EEPROM_WRITE_US. The first calib_writes
+ * programs are polled from half the current estimate to measure the actual
+ * program time; afterwards the first poll is scheduled a small guard
+ * (poll_us / NT3H_PROG_GUARD_DIV) after the running estimate, so a
+ * steady-state program usually costs a single poll. Each sample is the
+ * middle of the interval in which the program ended, so the estimate tracks
+ * the program time rather than the poll grid, in both directions.
+ */
+typedef struct {
+
+    /* Poll for program completion instead of waiting a fixed time */
+    bool enable;
+
+    /* Programs measured before the estimate is trusted (0 = default) */
+    uint8_t calib_writes;
+
+    /* Interval between NS_REG polls, in us (0 = default) */
+    uint16_t poll_us;
+
+    /* Running estimate of the program time, in us (0 = not yet measured) */
+    uint32_t estimate_us;
+
+    /* Number of programs measured */
+    uint32_t samples;
+
+    /* Number of NS_REG polls issued */
+    uint32_t polls;
+
+    /* Longest program time measured, in us */
+    uint32_t max_us;
+
+} nt3h_prog_time_t;
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+/*!
+ * @brief Operations reported to the instrumentation hook.
+ */
+typedef enum {
+    NT3H_OP_BUS_WRITE,
+    NT3H_OP_BUS_READ,
+    NT3H_OP_READ_BYTES,
+    NT3H_OP_WRITE_BYTES,
+    NT3H_OP_ERASE_BYTES,
+    NT3H_OP_READ_REGISTER,
+    NT3H_OP_WRITE_REGISTER,
+    NT3H_OP_READ_CONFIG,
+    NT3H_OP_WRITE_CONFIG,
+    NT3H_OP_READ_BLOCKS,
+    NT3H_OP_WRITE_BLOCKS,
+    NT3H_OP_INIT,
+    NT3H_OP_DEINIT,
+    NT3H_OP_FACTORY_RESET,
+    NT3H_OP_FORMAT,
+    NT3H_OP_SNAPSHOT,
+    NT3H_OP_RESTORE,
+    NT3H_OP_CHECK,
+    NT3H_OP_FIELD_PRESENT,
+    NT3H_OP_LOCK_ACQUIRE,
+    NT3H_OP_LOCK_RELEASE,
+    NT3H_OP_SET_WATCHDOG,
+    NT3H_OP_GET_WATCHDOG,
+    NT3H_OP_WATCHDOG_AUTOTUNE,
+    NT3H_OP_SET_CLOCK_STRETCH,
+    NT3H_OP_GET_CLOCK_STRETCH,
+    NT3H_OP_SET_PASS_THROUGH,
+    NT3H_OP_SET_TRANSFER_DIR,
+    NT3H_OP_SET_FD_MODE,
+    NT3H_OP_SET_SRAM_MIRROR,
+    NT3H_OP_WRITE_FIELDS,
+    NT3H_OP_READ_FIELD,
+    NT3H_OP_LOG_SESSION_REGS,
+    NT3H_OP_LOG_CONFIG_REGS,
+    NT3H_OP_LOG_MEMORY,
+    NT3H_OP_WRITE_BLOCK_START,
+    NT3H_OP_WRITE_BUSY,
+} nt3h_op_t;
+
+/*!
+ * @brief Instrumentation event, reported at the start and end of each operation.
+ */
+typedef struct {
+
+    /* Operation type */
+    nt3h_op_t op;
+
+    /* False at start of operation, true at end */
+    bool end;
+
+    /* Memory block address, or register offset for register operations */
+    uint16_t addr;
+
+    /* Number of bytes requested or transferred */
+    size_t len;
+
+    /* Operation result (end only) */
+    nt3h_status_t status;
+
+    /* Operation duration in us (end only, requires time_us) */
+    uint32_t duration_us;
+
+} nt3h_instr_event_t;
+
+typedef void (*nt3h_instr_hook_t)(void *ctx, const nt3h_instr_event_t *evt);
+
+/* Latency histogram layout: values below 2^NT3H_HIST_SUB_BITS us are exact,
+ * above that each power of two is split into 2^NT3H_HIST_SUB_BITS buckets.
+ * 72 buckets resolve samples up to 2^19 - 1 us (about 524 ms); longer samples
+ * land in the last bucket. */
+#define NT3H_HIST_SUB_BITS      2
+#define NT3H_HIST_BUCKETS       72
+
+/*!
+ * @brief Latency classes recorded in nt3h_latency_t.
+ */
+typedef enum {
+    NT3H_LAT_BLOCK_READ,    /* Single block read transaction pair */
+    NT3H_LAT_BLOCK_WRITE,   /* Single block write including program wait */
+    NT3H_LAT_REG_READ,      /* nt3h_read_register() */
+    NT3H_LAT_REG_WRITE,     /* nt3h_write_register() */
+    NT3H_LAT_API,           /* Any instrumented public API call */
+    NT3H_LAT_CLASSES,
+} nt3h_lat_class_t;
+
+/*!
+ * @brief Log-bucketed latency histogram.
+ */
+typedef struct {
+
+    /* Number of samples */
+    uint32_t count;
+
+    /* Smallest and largest sample, in us */
+    uint32_t min_us;
+    uint32_t max_us;
+
+    /* Sum of all samples, in us */
+    uint64_t total_us;
+
+    /* Sample count per bucket */
+    uint32_t buckets[NT3H_HIST_BUCKETS];
+
+} nt3h_hist_t;
+
+/*!
+ * @brief Latency histograms for each latency class.
+ */
+typedef struct {
+    nt3h_hist_t hist[NT3H_LAT_CLASSES];
+} nt3h_latency_t;
+
+/*!
+ * @brief Cumulative driver counters.
+ */
+typedef struct {
+
+    /* Public API calls, each counted once however many it makes internally */
+    uint32_t api_calls;
+
+    /* Public API calls which returned an error */
+    uint32_t api_errors;
+
+    /* Bus transactions issued */
+    uint32_t transactions;
+
+    /* Bus transactions which returned an error */
+    uint32_t bus_errors;
+
+    /* Bytes sent to the device, including addressing */
+    uint32_t bytes_written;
+
+    /* Bytes received from the device */
+    uint32_t bytes_read;
+
+    /* EEPROM blocks programmed */
+    uint32_t blocks_programmed;
+
+    /* Time requested from the delay functions, in us */
+    uint32_t delay_us;
+
+} nt3h_counters_t;
+
+/*!
+ * @brief Instrumentation settings and counters.
+ */
+typedef struct {
+
+    /* Optional hook called at start/end of each API call and bus transaction */
+    nt3h_instr_hook_t hook;
+
+    /* User context passed to hook */
+    void *hook_ctx;
+
+    /* Cumulative counters */
+    nt3h_counters_t counters;
+
+    /* Optional user allocated latency histograms (requires time_us) */
+    nt3h_latency_t *latency;
+
+} nt3h_instr_t;
+#endif /* NT3H_ENABLE_INSTRUMENTATION */
+
+#ifdef NT3H_ENABLE_TRACE
+/* Trace record layout (little endian), NT3H_TRACE_HDR_LEN bytes then payload:
+ *   [0]    flags  : bit 0 = direction (0 write, 1 read), bits 1-7 = status
+ *   [1]    dev_id : Transport device ID
+ *   [2..3] len    : Payload length
+ *   [4..7] time   : Timestamp in us from time_us (0 if unavailable)
+ *   [8..]  data   : Bytes written, or bytes read */
+#define NT3H_TRACE_HDR_LEN      8
+#define NT3H_TRACE_DIR_READ     0x01
+
+/*!
+ * @brief Trace ring buffer over user supplied memory.
+ */
+typedef struct {
+
+    /* Backing memory and its size */
+    uint8_t *buf;
+    size_t size;
+
+    /* Write position, oldest record position and bytes in use */
+    size_t head;
+    size_t tail;
+    size_t used;
+
+    /* Records currently held */
+    uint32_t records;
+
+    /* Oldest records overwritten to make room */
+    uint32_t dropped;
+
+} nt3h_trace_t;
+
+/*!
+ * @brief Decoded trace record.
+ */
+typedef struct {
+    bool read;
+    nt3h_status_t status;
+    uint8_t dev_id;
+    uint16_t len;
+    uint32_t time_us;
+    const uint8_t *data;
+} nt3h_trace_record_t;
+
+/*!
+ * @brief Summary of a trace.
+ */
+typedef struct {
+    uint32_t writes;
+    uint32_t reads;
+    uint32_t errors;
+    uint32_t block_writes;
+    uint32_t bytes_written;
+    uint32_t bytes_read;
+    uint32_t span_us;
+} nt3h_trace_summary_t;
+#endif /* NT3H_ENABLE_TRACE */
+
+#ifdef NT3H_ENABLE_LOG
+/*!
+ * @brief Binary debug log event IDs. Arguments are listed per event.
+ */
+typedef enum {
+    NT3H_EVT_INIT,              /* arg0 = status */
+    NT3H_EVT_BLOCK_READ,        /* arg0 = block, arg1 = status */
+    NT3H_EVT_BLOCK_WRITE,       /* arg0 = block, arg1 = status */
+    NT3H_EVT_REG_READ,          /* arg0 = reg, arg1 = value, arg2 = status */
+    NT3H_EVT_REG_WRITE,         /* arg0 = reg, arg1 = mask << 8 | value, arg2 = status */
+    NT3H_EVT_LOCK_ACQUIRE,      /* arg0 = status, arg1 = wait in ms */
+    NT3H_EVT_LOCK_RELEASE,      /* arg0 = status */
+    NT3H_EVT_SESSION_REGS,      /* arg1 = regs 0-3, arg2 = regs 4-6 (LSB first) */
+    NT3H_EVT_CONFIG_REGS,       /* arg1 = regs 0-3, arg2 = regs 4-7 (LSB first) */
+    NT3H_EVT_MEMORY_LO,         /* arg0 = block, arg1 = bytes 0-3, arg2 = bytes 4-7 */
+    NT3H_EVT_MEMORY_HI,         /* arg0 = block, arg1 = bytes 8-11, arg2 = bytes 12-15 */
+    NT3H_EVT_COUNT,
+} nt3h_log_event_t;
+
+/*!
+ * @brief Binary debug log entry, formatted offline by nt3h_log_format().
+ */
+typedef struct {
+    uint32_t time_us;
+    uint16_t id;
+    uint16_t arg0;
+    uint32_t arg1;
+    uint32_t arg2;
+} nt3h_log_entry_t;
+
+/*!
+ * @brief Single producer, single consumer log ring over user supplied entries.
+ *
+ * Lock-free: entry accesses are ordered against the index updates with
+ * acquire/release fences (C11 atomics or GCC builtins, or the
+ * NT3H_LOG_ACQUIRE()/NT3H_LOG_RELEASE() hooks), so the producer and
+ * consumer may run on different cores.
+ */
+typedef struct {
+
+    /* Entry storage, count must be a power of two */
+    nt3h_log_entry_t *entries;
+    uint32_t count;
+
+    /* Free running indices, head written by driver and tail by reader only,
+     * each published with a release fence after the entry access */
+    volatile uint32_t head;
+    volatile uint32_t tail;
+
+    /* Entries discarded because the ring was full */
+    volatile uint32_t dropped;
+
+} nt3h_log_t;
+#endif /* NT3H_ENABLE_LOG */
+
+/*
+ * @brief EEPROM wear telemetry and write budget.
+ */
+typedef struct {
+
+    /* Per block program counts, NT3H_WEAR_BLOCKS entries (user allocated) */
+    uint32_t *counts;
+
+    /* Total EEPROM blocks programmed */
+    uint32_t total;
+
+    /* Optional persistence callback, called every save_interval programs */
+    nt3h_wear_save_func_ptr_t save;
+    void *save_ctx;
+    uint32_t save_interval;
+
+    /* Write budget in block programs per second (0 = unlimited, requires time_us) */
+    uint32_t rate_per_s;
+
+    /* Programs allowed back to back before the rate applies */
+    uint32_t burst;
+
+    /* Reject over-budget writes with NT3H_E_WRITE_BUDGET instead of delaying.
+     * A multi-block write is checked whole before any block is programmed,
+     * so one needing more than burst programs is always rejected */
+    bool reject;
+
+    /* Budget state */
+    uint32_t credit_us;
+    uint32_t last_us;
+    bool primed;
+
+    /* Writes delayed or rejected by the budget, and time spent delayed */
+    uint32_t throttled;
+    uint32_t rejected;
+    uint32_t throttle_ms;
+
+} nt3h_wear_t;
+
+/*
+ * @brief Copy of all I2C readable memory of a tag.
+ */
+typedef struct {
+
+    /* Tag is a 2K variant */
+    bool is_2k;
+
+    /* Block 0: serial number, static lock bytes and capability container */
+    uint8_t block0[NTAG_I2C_BLOCK_SIZE];
+
+    /* User memory from block 1, NT3H_USER_BLOCKS_1K or NT3H_USER_BLOCKS_2K blocks used */
+    uint8_t user[NT3H_USER_BLOCKS_2K][NTAG_I2C_BLOCK_SIZE];
+
+    /* Configuration block */
+    uint8_t config[NTAG_I2C_BLOCK_SIZE];
+
+    /* Session registers */
+    uint8_t session[8];
+
+} nt3h_snapshot_t;
+
+/*
+ * @brief Location of one remapped logical block.
+ */
+typedef struct {
+
+    /* Logical block address, as used by the read and write APIs */
+    uint8_t logical;
+
+    /* Physical block currently holding its data */
+    uint8_t physical;
+
+    /* Programs since it last moved */
+    uint16_t writes;
+
+} nt3h_remap_entry_t;
+
+typedef void (*nt3h_remap_save_func_ptr_t)(void *ctx, const nt3h_remap_entry_t *entries, size_t n);
+
+/*
+ * @brief Hot block remapping table and statistics.
+ *
+ * Each logical block listed in entries rotates among a pool made of the
+ * listed logical blocks and the spare blocks. Every interval programs a
+ * block's next write goes to the next free pool block instead of in place,
+ * so moving costs no extra program. Spare blocks cannot be accessed
+ * directly while remapping is attached: block reads and writes that
+ * include one fail with NT3H_E_INVALID_ARGS, and format, snapshot and
+ * restore skip them.
+ */
+typedef struct {
+
+    /* Remapped blocks, sorted by logical address (user allocated) */
+    nt3h_remap_entry_t *entries;
+    size_t n_entries;
+
+    /* Spare physical blocks, not used by anything else (user allocated) */
+    const uint8_t *spares;
+    size_t n_spares;
+
+    /* Programs of a block before its next write moves it (0 = default) */
+    uint16_t interval;
+
+    /* Persistence callback, called after every move. The table must be
+     * restored at start-up or data of moved blocks cannot be found */
+    nt3h_remap_save_func_ptr_t save;
+    void *save_ctx;
+
+    /* Pool position to search for the next free block from */
+    size_t cursor;
+
+    /* Block accesses translated, accesses to remapped blocks, and moves */
+    uint32_t lookups;
+    uint32_t hits;
+    uint32_t moves;
+
+} nt3h_remap_t;
+
 /*
  * @brief NT3H Device structure.
  */
@@ -120,6 +828,11 @@ typedef struct {
     /* Device ID */
     uint16_t dev_id;
 
+    /* I2C address as held in block 0 byte 0, i.e. the 7-bit address shifted
+     * left by 1. Block 0 reads back 0x04 there, so writes of block 0 put
+     * this value in its place; 0 refuses them */
+    uint8_t i2c_addr;
+
     /* User defined I2C write function pointer */
     nt3h_com_func_ptr_t write;
 
@@ -129,10 +842,77 @@ typedef struct {
     /* User defined delay ms function pointer */
     nt3h_delay_ms_func_ptr_t delay_ms;
 
+    /* Optional user defined delay us function pointer, preferred over delay_ms */
+    nt3h_delay_us_func_ptr_t delay_us;
+
+    /* Optional user defined yield function. With time_us and no delay_us,
+     * waits yield until the period has elapsed instead of using delay_ms */
+    nt3h_yield_func_ptr_t yield;
+
+    /* Optional user defined monotonic microsecond clock */
+    nt3h_time_us_func_ptr_t time_us;
+
+    /* I2C memory arbitration lock */
+    nt3h_lock_t lock;
+
+    /* Optional EEPROM wear telemetry, NULL to disable */
+    nt3h_wear_t *wear;
+
+    /* Optional hot block remapping, NULL to disable */
+    nt3h_remap_t *remap;
+
+    /* Transport retry policy, all zero for no retries */
+    nt3h_retry_t retry;
+
+    /* EEPROM program time calibration, disabled when zero */
+    nt3h_prog_time_t prog;
+
+#ifdef NT3H_ENABLE_INSTRUMENTATION
+    /* Instrumentation hook and counters */
+    nt3h_instr_t instr;
+#endif
+
+#ifdef NT3H_ENABLE_TRACE
+    /* Optional bus trace capture, NULL to disable */
+    nt3h_trace_t *trace;
+#endif
+
+#ifdef NT3H_ENABLE_LOG
+    /* Optional binary debug log, NULL to disable */
+    nt3h_log_t *log;
+#endif
+
 } nt3h_dev_t;
 
 #ifdef __cplusplus
 }
 #endif /* End of CPP guard */
+
+#ifdef __cplusplus
+/* May be included from inside an extern "C" block (see nt3h.h) */
+extern "C++" {
+namespace nt3h {
+
+/*! @brief Position of the lowest set bit of a field mask. */
+constexpr uint8_t field_shift(uint8_t mask)
+{
+    return (mask == 0 || (mask & 0x01)) ? 0 : (uint8_t)(1 + field_shift((uint8_t)(mask >> 1)));
+}
+
+/*! @brief Builds a field update for a register space, rejecting out of
+ * range values and fields not writable in that space at compile time. */
+template <nt3h_reg_space_t Space, nt3h_field_t Field, uint8_t Value>
+constexpr nt3h_field_value_t field_value()
+{
+    static_assert((NT3H_FIELD_SPACES(Field) & NT3H_FIELD_ACCESS(Space, true)) != 0,
+                  "Field is not writable in this register space");
+    static_assert(Value <= (NT3H_FIELD_MASK(Field) >> field_shift(NT3H_FIELD_MASK(Field))),
+                  "Value does not fit in register field");
+    return nt3h_field_value_t{ Field, Value };
+}
+
+} /* namespace nt3h */
+} /* extern "C++" */
+#endif /* __cplusplus */
 #endif /* NT3H_DEFS_H_ */
 /** @}*/
\ No newline at end of file
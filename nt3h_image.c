@@ -0,0 +1,399 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_image.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_image.c
+ * @brief Compact binary tag image format.
+ */
+#include <string.h>
+#include "nt3h_image.h"
+#include "nt3h_provision.h"
+#include "nt3h_util.h"
+
+#define HDR_OFFSET_VERSION  4
+#define HDR_OFFSET_VARIANT  5
+#define HDR_OFFSET_N_RUNS   6
+#define HDR_OFFSET_LENGTH   8
+#define HDR_OFFSET_CRC      14
+
+#define DUMP_CHUNK_BLOCKS   16      /* Blocks read per nt3h_read_bytes() call while dumping */
+#define PROGRAM_BATCH_RUNS  8       /* Runs handed to each nt3h_provision() call while programming */
+
+/*!
+ * @brief This internal API computes a CRC-16/CCITT-FALSE, continuing from crc.
+ */
+static uint16_t crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+/*!
+ * @brief This internal API returns the encoded length of a run.
+ */
+static size_t run_length(uint8_t cnt, bool masked);
+
+/*!
+ * @brief This internal API checks a run only covers blocks an image may program.
+ *
+ * @note Block 0 and user memory, or the configuration block alone, as
+ *       accepted by nt3h_provision().
+ */
+static bool run_allowed(const nt3h_image_run_t *run, uint8_t variant);
+
+/*!
+ * @brief This API starts writing an image into a caller buffer.
+ */
+nt3h_status_t nt3h_image_begin(nt3h_image_writer_t *writer, uint8_t *buf, size_t size, uint8_t variant)
+{
+    if (writer == NULL || buf == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (size < NT3H_IMAGE_HDR_LEN)
+        return NT3H_E_NO_SPACE;
+
+    memset(buf, 0, NT3H_IMAGE_HDR_LEN);
+    memcpy(buf, NT3H_IMAGE_MAGIC, 4);
+    buf[HDR_OFFSET_VERSION] = NT3H_IMAGE_VERSION;
+    buf[HDR_OFFSET_VARIANT] = variant;
+
+    writer->buf    = buf;
+    writer->size   = size;
+    writer->pos    = NT3H_IMAGE_HDR_LEN;
+    writer->n_runs = 0;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API appends a run of blocks.
+ */
+nt3h_status_t nt3h_image_add_run(nt3h_image_writer_t *writer, uint8_t block, uint8_t cnt,
+                                 const uint8_t *data, const uint8_t *mask)
+{
+    if (writer == NULL || writer->buf == NULL || data == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (cnt == 0 || (uint16_t)block + cnt > 0x100 || writer->n_runs == UINT16_MAX)
+        return NT3H_E_INVALID_ARGS;
+
+    size_t bytes = (size_t)cnt * NTAG_I2C_BLOCK_SIZE;
+    size_t len   = run_length(cnt, mask != NULL);
+
+    if (writer->size - writer->pos < len)
+        return NT3H_E_NO_SPACE;
+
+    uint8_t *run = &writer->buf[writer->pos];
+
+    run[0] = block;
+    run[1] = cnt;
+    run[2] = (mask != NULL) ? NT3H_IMAGE_RUN_MASK : 0;
+    run[3] = 0;
+    memcpy(&run[NT3H_IMAGE_RUN_HDR_LEN], data, bytes);
+
+    if (mask != NULL)
+        memcpy(&run[NT3H_IMAGE_RUN_HDR_LEN + bytes], mask, bytes);
+
+    nt3h_put_le16(&run[len - NT3H_IMAGE_RUN_CRC_LEN], crc16(0xFFFF, run, len - NT3H_IMAGE_RUN_CRC_LEN));
+
+    writer->pos += len;
+    writer->n_runs++;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API completes the image header.
+ */
+nt3h_status_t nt3h_image_end(nt3h_image_writer_t *writer, size_t *len)
+{
+    if (writer == NULL || writer->buf == NULL)
+        return NT3H_E_NULL_PTR;
+
+    nt3h_put_le16(&writer->buf[HDR_OFFSET_N_RUNS], writer->n_runs);
+    nt3h_put_le32(&writer->buf[HDR_OFFSET_LENGTH], (uint32_t)writer->pos);
+    nt3h_put_le16(&writer->buf[HDR_OFFSET_CRC], crc16(0xFFFF, writer->buf, HDR_OFFSET_CRC));
+
+    if (len != NULL)
+        *len = writer->pos;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API validates and decodes an image header.
+ */
+nt3h_status_t nt3h_image_header(const uint8_t *buf, size_t len, nt3h_image_header_t *hdr)
+{
+    if (buf == NULL || hdr == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (len < NT3H_IMAGE_HDR_LEN || memcmp(buf, NT3H_IMAGE_MAGIC, 4) != 0)
+        return NT3H_E_INVALID_ARGS;
+
+    if (crc16(0xFFFF, buf, HDR_OFFSET_CRC) != nt3h_get_le16(&buf[HDR_OFFSET_CRC]))
+        return NT3H_E_CRC;
+
+    hdr->version = buf[HDR_OFFSET_VERSION];
+    hdr->variant = buf[HDR_OFFSET_VARIANT];
+    hdr->n_runs  = nt3h_get_le16(&buf[HDR_OFFSET_N_RUNS]);
+    hdr->length  = nt3h_get_le32(&buf[HDR_OFFSET_LENGTH]);
+
+    if (hdr->version != NT3H_IMAGE_VERSION)
+        return NT3H_E_INVALID_ARGS;
+
+    /* Image was cut short */
+    if (hdr->length > len || hdr->length < NT3H_IMAGE_HDR_LEN)
+        return NT3H_E_CRC;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API decodes the next run of an image.
+ */
+nt3h_status_t nt3h_image_next(const uint8_t *buf, size_t len, size_t *pos, nt3h_image_run_t *run)
+{
+    if (buf == NULL || pos == NULL || run == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (*pos < NT3H_IMAGE_HDR_LEN)
+        *pos = NT3H_IMAGE_HDR_LEN;
+
+    /* Stop at the recorded image length, trailing bytes are not part of it */
+    if (len >= NT3H_IMAGE_HDR_LEN && nt3h_get_le32(&buf[HDR_OFFSET_LENGTH]) < len)
+        len = nt3h_get_le32(&buf[HDR_OFFSET_LENGTH]);
+
+    if (*pos >= len)
+        return NT3H_E_NOT_FOUND;
+
+    if (len - *pos < NT3H_IMAGE_RUN_HDR_LEN)
+        return NT3H_E_CRC;
+
+    const uint8_t *p = &buf[*pos];
+    bool masked = (p[2] & NT3H_IMAGE_RUN_MASK) != 0;
+    size_t run_len = run_length(p[1], masked);
+
+    if (p[1] == 0 || len - *pos < run_len)
+        return NT3H_E_CRC;
+
+    if (crc16(0xFFFF, p, run_len - NT3H_IMAGE_RUN_CRC_LEN) != nt3h_get_le16(&p[run_len - NT3H_IMAGE_RUN_CRC_LEN]))
+        return NT3H_E_CRC;
+
+    run->block = p[0];
+    run->cnt   = p[1];
+    run->data  = &p[NT3H_IMAGE_RUN_HDR_LEN];
+    run->mask  = masked ? &p[NT3H_IMAGE_RUN_HDR_LEN + (size_t)run->cnt * NTAG_I2C_BLOCK_SIZE] : NULL;
+
+    *pos += run_len;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API dumps blocks of a live tag into an image.
+ */
+nt3h_status_t nt3h_image_dump(nt3h_dev_t *dev, uint8_t first_block, uint16_t cnt, uint8_t variant,
+                              uint8_t *buf, size_t size, size_t *len)
+{
+    nt3h_status_t rslt;
+    nt3h_image_writer_t writer;
+    uint8_t chunk[DUMP_CHUNK_BLOCKS * NTAG_I2C_BLOCK_SIZE];
+
+    if (dev == NULL || len == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (variant != NT3H_IMAGE_VARIANT_1K && variant != NT3H_IMAGE_VARIANT_2K)
+        return NT3H_E_INVALID_ARGS;
+
+    uint8_t user_blocks = (variant == NT3H_IMAGE_VARIANT_2K) ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+    uint8_t config = (variant == NT3H_IMAGE_VARIANT_2K) ? NTAG_MEM_BLOCK_CONFIGURATION_2k
+                                                        : NTAG_MEM_BLOCK_CONFIGURATION_1k;
+
+    if (cnt == 0 || first_block + cnt - 1 > config)
+        return NT3H_E_INVALID_ARGS;
+
+    if ((rslt = nt3h_image_begin(&writer, buf, size, variant)) != NT3H_OK)
+        return rslt;
+
+    for (uint16_t base = 0; base < cnt; base += DUMP_CHUNK_BLOCKS)
+    {
+        uint8_t n = (uint8_t)((cnt - base < DUMP_CHUNK_BLOCKS) ? cnt - base : DUMP_CHUNK_BLOCKS);
+
+        if ((rslt = nt3h_read_bytes(dev, first_block + base, 0, chunk, (size_t)n * NTAG_I2C_BLOCK_SIZE)) != NT3H_OK)
+            return rslt;
+
+        /* Every programmable block is emitted, blank or not, so programming reproduces the tag */
+        for (uint8_t i = 0; i < n; )
+        {
+            uint8_t block = (uint8_t)(first_block + base + i);
+            uint8_t *data = &chunk[i * NTAG_I2C_BLOCK_SIZE];
+            uint8_t run = 1;
+
+            /* Lock and reserved blocks are not tag contents */
+            if (block > user_blocks && block != config)
+            {
+                i++;
+                continue;
+            }
+
+            if (block == 0)
+            {
+                uint8_t mask[NTAG_I2C_BLOCK_SIZE];
+
+                /* Only the static lock bytes and capability container are tag contents */
+                memset(data, 0, NT3H_BLOCK_0_FIXED_LEN);
+                memset(mask, 0, NT3H_BLOCK_0_FIXED_LEN);
+                memset(&mask[NT3H_BLOCK_0_FIXED_LEN], 0xFF, NTAG_I2C_BLOCK_SIZE - NT3H_BLOCK_0_FIXED_LEN);
+
+                rslt = nt3h_image_add_run(&writer, 0, 1, data, mask);
+            }
+            else
+            {
+                while (i + run < n && block + run <= user_blocks)
+                    run++;
+
+                rslt = nt3h_image_add_run(&writer, block, run, data, NULL);
+            }
+
+            if (rslt != NT3H_OK)
+                return rslt;
+
+            i += run;
+        }
+    }
+
+    return nt3h_image_end(&writer, len);
+}
+
+/*!
+ * @brief This API programs a tag from an image.
+ */
+nt3h_status_t nt3h_image_program(nt3h_dev_t *dev, uint8_t variant, const uint8_t *buf, size_t len, bool verify)
+{
+    nt3h_status_t rslt;
+    nt3h_image_header_t hdr;
+    nt3h_image_run_t run;
+    nt3h_prov_segment_t segs[PROGRAM_BATCH_RUNS];
+    size_t pos = 0;
+    uint16_t n_runs = 0;
+
+    if (dev == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (variant != NT3H_IMAGE_VARIANT_1K && variant != NT3H_IMAGE_VARIANT_2K)
+        return NT3H_E_INVALID_ARGS;
+
+    if ((rslt = nt3h_image_header(buf, len, &hdr)) != NT3H_OK)
+        return rslt;
+
+    /* An image for the other part would land on the wrong blocks */
+    if (hdr.variant != variant)
+        return NT3H_E_INVALID_ARGS;
+
+    /* Check every run first so a corrupt or out of range image programs nothing */
+    while ((rslt = nt3h_image_next(buf, len, &pos, &run)) == NT3H_OK)
+    {
+        if (!run_allowed(&run, variant))
+            return NT3H_E_INVALID_ARGS;
+
+        n_runs++;
+    }
+
+    if (rslt != NT3H_E_NOT_FOUND)
+        return rslt;
+
+    /* A run lost or appended with valid CRCs still leaves the header count wrong */
+    if (n_runs != hdr.n_runs)
+        return NT3H_E_CRC;
+
+    pos = 0;
+
+    for (uint16_t done = 0; done < n_runs; )
+    {
+        nt3h_prov_image_t image = { segs, 0, variant == NT3H_IMAGE_VARIANT_2K };
+        nt3h_prov_fixture_t fixture = { 0 };
+
+        while (image.n_segments < PROGRAM_BATCH_RUNS && done < n_runs &&
+               nt3h_image_next(buf, len, &pos, &run) == NT3H_OK)
+        {
+            nt3h_prov_segment_t *seg = &segs[image.n_segments++];
+
+            seg->block = run.block;
+            seg->cnt   = run.cnt;
+            seg->data  = run.data;
+            seg->mask  = run.mask;
+            done++;
+        }
+
+        if (image.n_segments == 0)
+            return NT3H_E_CRC;
+
+        fixture.dev = dev;
+
+        if ((rslt = nt3h_provision(&image, &fixture, 1, verify)) != NT3H_OK)
+            return rslt;
+    }
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This internal API computes a CRC-16/CCITT-FALSE, continuing from crc.
+ */
+static uint16_t crc16(uint16_t crc, const uint8_t *data, size_t len)
+{
+    while (len--)
+    {
+        crc ^= (uint16_t)(*data++ << 8);
+
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (uint16_t)((crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1));
+    }
+
+    return crc;
+}
+
+/*!
+ * @brief This internal API returns the encoded length of a run.
+ */
+static size_t run_length(uint8_t cnt, bool masked)
+{
+    size_t bytes = (size_t)cnt * NTAG_I2C_BLOCK_SIZE;
+
+    return NT3H_IMAGE_RUN_HDR_LEN + (masked ? 2 * bytes : bytes) + NT3H_IMAGE_RUN_CRC_LEN;
+}
+
+/*!
+ * @brief This internal API checks a run only covers blocks an image may program.
+ */
+static bool run_allowed(const nt3h_image_run_t *run, uint8_t variant)
+{
+    uint8_t user_blocks = (variant == NT3H_IMAGE_VARIANT_2K) ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+    uint8_t config = (variant == NT3H_IMAGE_VARIANT_2K) ? NTAG_MEM_BLOCK_CONFIGURATION_2k
+                                                        : NTAG_MEM_BLOCK_CONFIGURATION_1k;
+    uint16_t last = (uint16_t)run->block + run->cnt - 1;
+
+    return last <= user_blocks || (run->block == config && last == config);
+}
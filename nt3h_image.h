@@ -0,0 +1,214 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_image.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_image.h
+ * @brief Compact binary tag image format.
+ *
+ * An image describes tag contents as a sparse list of runs of consecutive
+ * blocks. All fields are little endian and byte aligned, so an image can
+ * be read in place from a memory-mapped file or flash with no parsing
+ * into heap structures:
+ *
+ *   Header (16 bytes)
+ *     [0..3]   magic "NT3I"
+ *     [4]      format version (NT3H_IMAGE_VERSION)
+ *     [5]      tag variant (NT3H_IMAGE_VARIANT_*)
+ *     [6..7]   number of runs
+ *     [8..11]  total image length in bytes, header included
+ *     [12..13] reserved, zero
+ *     [14..15] CRC-16 of bytes 0 to 13
+ *
+ *   Run (repeated)
+ *     [0]      first block
+ *     [1]      number of blocks, n (1 to 255)
+ *     [2]      flags, NT3H_IMAGE_RUN_MASK if a mask follows the data
+ *     [3]      reserved, zero
+ *     [4..]    n * 16 data bytes, then n * 16 mask bytes if flagged
+ *     [..+2]   CRC-16 of the run, header included
+ *
+ * Mask bits set mark significant data bits; clear bits are don't-care and
+ * keep their current value when programming. CRCs are CRC-16/CCITT-FALSE.
+ */
+
+#ifndef _NT3H_IMAGE_H_
+#define _NT3H_IMAGE_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "nt3h.h"
+
+#define NT3H_IMAGE_MAGIC            "NT3I"
+#define NT3H_IMAGE_VERSION          1
+#define NT3H_IMAGE_HDR_LEN          16
+#define NT3H_IMAGE_RUN_HDR_LEN      4
+#define NT3H_IMAGE_RUN_CRC_LEN      2
+#define NT3H_IMAGE_RUN_MASK         0x01
+
+#define NT3H_IMAGE_VARIANT_1K       0x01
+#define NT3H_IMAGE_VARIANT_2K       0x02
+
+/*
+ * @brief Decoded image header.
+ */
+typedef struct {
+    uint8_t version;
+    uint8_t variant;
+    uint16_t n_runs;
+    uint32_t length;
+} nt3h_image_header_t;
+
+/*
+ * @brief Decoded run, pointing into the image.
+ */
+typedef struct {
+    uint8_t block;
+    uint8_t cnt;
+    const uint8_t *data;
+    const uint8_t *mask;    /* NULL if every bit is significant */
+} nt3h_image_run_t;
+
+/*
+ * @brief Image writer state.
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t pos;
+    uint16_t n_runs;
+} nt3h_image_writer_t;
+
+/*!
+ * @brief This API starts writing an image into a caller buffer.
+ *
+ * @param[out] writer : Pointer to writer structure.
+ * @param[out]    buf : Buffer to write the image into.
+ * @param[in]    size : Size of buffer.
+ * @param[in] variant : Tag variant, NT3H_IMAGE_VARIANT_*.
+ *
+ * @return API status code, NT3H_E_NO_SPACE if the buffer cannot hold the header.
+ */
+nt3h_status_t nt3h_image_begin(nt3h_image_writer_t *writer, uint8_t *buf, size_t size, uint8_t variant);
+
+/*!
+ * @brief This API appends a run of blocks.
+ *
+ * @param[in] writer : Pointer to writer structure.
+ * @param[in]  block : First block.
+ * @param[in]    cnt : Number of blocks, 1 to 255.
+ * @param[in]   data : cnt * 16 data bytes.
+ * @param[in]   mask : cnt * 16 mask bytes, or NULL if every bit is significant.
+ *
+ * @return API status code, NT3H_E_NO_SPACE if the buffer is full.
+ */
+nt3h_status_t nt3h_image_add_run(nt3h_image_writer_t *writer, uint8_t block, uint8_t cnt,
+                                 const uint8_t *data, const uint8_t *mask);
+
+/*!
+ * @brief This API completes the image header.
+ *
+ * @param[in]  writer : Pointer to writer structure.
+ * @param[out]    len : Total image length. Optional.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_image_end(nt3h_image_writer_t *writer, size_t *len);
+
+/*!
+ * @brief This API validates and decodes an image header.
+ *
+ * @param[in]  buf : Image.
+ * @param[in]  len : Length of image buffer.
+ * @param[out] hdr : Decoded header.
+ *
+ * @return API status code, NT3H_E_CRC if the header is corrupt.
+ */
+nt3h_status_t nt3h_image_header(const uint8_t *buf, size_t len, nt3h_image_header_t *hdr);
+
+/*!
+ * @brief This API decodes the next run of an image.
+ *
+ * @param[in]      buf : Image, header already validated.
+ * @param[in]      len : Length of image.
+ * @param[in,out]  pos : Read position, start at 0.
+ * @param[out]     run : Decoded run, data and mask point into buf.
+ *
+ * @return API status code, NT3H_E_NOT_FOUND after the last run, NT3H_E_CRC
+ *         if the run is corrupt or truncated.
+ */
+nt3h_status_t nt3h_image_next(const uint8_t *buf, size_t len, size_t *pos, nt3h_image_run_t *run);
+
+/*!
+ * @brief This API dumps blocks of a live tag into an image.
+ *
+ * @note Every block 0, user memory and configuration block in the range is
+ *       emitted, blank ones included, so programming the image reproduces
+ *       the tag. Lock and reserved blocks are left out. Block 0 is emitted
+ *       with bytes 0 to 9 zeroed and masked out, as they are the I2C
+ *       address and serial number rather than tag contents.
+ *
+ * @param[in]         dev : Pointer to device structure.
+ * @param[in] first_block : First block to dump.
+ * @param[in]         cnt : Number of blocks to dump, ending at most at the
+ *                          configuration block.
+ * @param[in]     variant : Tag variant, NT3H_IMAGE_VARIANT_*.
+ * @param[out]        buf : Buffer to write the image into.
+ * @param[in]        size : Size of buffer.
+ * @param[out]        len : Total image length.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_image_dump(nt3h_dev_t *dev, uint8_t first_block, uint16_t cnt, uint8_t variant,
+                              uint8_t *buf, size_t size, size_t *len);
+
+/*!
+ * @brief This API programs a tag from an image.
+ *
+ * @note Blocks whose significant bits already match are not programmed.
+ *       Every run's CRC and block range, and the header's run count, are
+ *       checked before anything is programmed.
+ *
+ * @param[in]     dev : Pointer to device structure.
+ * @param[in] variant : Variant of the tag, NT3H_IMAGE_VARIANT_*.
+ * @param[in]     buf : Image.
+ * @param[in]     len : Length of image.
+ * @param[in]  verify : Read back and compare every programmed block.
+ *
+ * @return API status code, NT3H_E_INVALID_ARGS if the image is for the
+ *         other variant or a run covers blocks outside block 0, user
+ *         memory and the configuration block, NT3H_E_CRC if it is corrupt.
+ */
+nt3h_status_t nt3h_image_program(nt3h_dev_t *dev, uint8_t variant, const uint8_t *buf, size_t len, bool verify);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* NT3H_IMAGE_H_ */
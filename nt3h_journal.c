@@ -0,0 +1,502 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_journal.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_journal.c
+ * @brief Write-coalescing journal for NT3H memory.
+ */
+#include <string.h>
+#include "nt3h_journal.h"
+#include "nt3h_util.h"
+
+#define MARKER_MAGIC        0xA5
+#define MARKER_OFFSET_MAGIC 0
+#define MARKER_OFFSET_COUNT 1
+#define MARKER_OFFSET_CRC   2
+
+/*!
+ * @brief This internal API finds the image of a block.
+ *
+ * @param[in]    jnl : Pointer to journal structure.
+ * @param[in]  block : Block address.
+ * @param[out] index : Index of the image, or where it would be inserted.
+ *
+ * @return True if the block is staged.
+ */
+static bool find_entry(const nt3h_journal_t *jnl, uint8_t block, size_t *index);
+
+/*!
+ * @brief This internal API returns the image of a block, staging it from the device if needed.
+ *
+ * @param[in]    jnl : Pointer to journal structure.
+ * @param[in]  block : Block address.
+ * @param[out] entry : Image of the block.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t stage_entry(nt3h_journal_t *jnl, uint8_t block, nt3h_journal_entry_t **entry);
+
+/*!
+ * @brief This internal API programs dirty images to their home blocks, merging consecutive blocks.
+ */
+static nt3h_status_t write_home(nt3h_journal_t *jnl);
+
+/*!
+ * @brief This internal API returns the number of staging blocks after the marker.
+ */
+static uint8_t staging_blocks(const nt3h_journal_t *jnl);
+
+/*!
+ * @brief This internal API checks a byte range lies in user memory outside
+ * the marker and staging blocks.
+ *
+ * @param[in] jnl : Pointer to journal structure.
+ * @param[in] pos : Byte position of the first byte (block * 16 + offset).
+ * @param[in] len : Number of bytes.
+ *
+ * @return True if the journal may stage every block of the range.
+ */
+static bool range_valid(const nt3h_journal_t *jnl, uint32_t pos, size_t len);
+
+/*!
+ * @brief This internal API validates the journal structure.
+ */
+static nt3h_status_t null_ptr_check(const nt3h_journal_t *jnl);
+
+/*!
+ * @brief This API initialises a journal.
+ */
+nt3h_status_t nt3h_journal_init(nt3h_journal_t *jnl, nt3h_dev_t *dev, bool is_2k, nt3h_journal_entry_t *entries,
+                                size_t max_entries, uint8_t marker_block)
+{
+    if (jnl == NULL || dev == NULL || entries == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (max_entries == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    memset(jnl, 0, sizeof(*jnl));
+    jnl->dev          = dev;
+    jnl->is_2k        = is_2k;
+    jnl->entries      = entries;
+    jnl->max_entries  = max_entries;
+    jnl->marker_block = marker_block;
+
+    uint8_t user_blocks = is_2k ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+
+    /* Marker and staging blocks must lie within user memory */
+    if (marker_block != NT3H_JOURNAL_NO_MARKER && (uint16_t)marker_block + staging_blocks(jnl) > user_blocks)
+        return NT3H_E_INVALID_ARGS;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API stages a byte update.
+ */
+nt3h_status_t nt3h_journal_write(nt3h_journal_t *jnl, uint16_t addr, uint16_t offset, const uint8_t *data,
+                                 size_t len)
+{
+    nt3h_status_t rslt;
+
+    if ((rslt = null_ptr_check(jnl)) != NT3H_OK)
+        return rslt;
+
+    if (data == NULL || len == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    uint32_t pos = (uint32_t)addr * NTAG_I2C_BLOCK_SIZE + offset;
+
+    if (!range_valid(jnl, pos, len))
+        return NT3H_E_INVALID_ARGS;
+
+    while (len > 0)
+    {
+        nt3h_journal_entry_t *entry;
+        uint8_t at  = (uint8_t)(pos % NTAG_I2C_BLOCK_SIZE);
+        size_t room = (size_t)(NTAG_I2C_BLOCK_SIZE - at);
+        uint8_t cnt = (uint8_t)((len < room) ? len : room);
+
+        if ((rslt = stage_entry(jnl, (uint8_t)(pos / NTAG_I2C_BLOCK_SIZE), &entry)) != NT3H_OK)
+            return rslt;
+
+        /* Only a real change makes the block worth programming */
+        if (memcmp(&entry->data[at], data, cnt) != 0)
+        {
+            memcpy(&entry->data[at], data, cnt);
+            entry->dirty = true;
+        }
+
+        pos  += cnt;
+        data += cnt;
+        len  -= cnt;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API reads bytes as they will be after the next commit.
+ */
+nt3h_status_t nt3h_journal_read(nt3h_journal_t *jnl, uint16_t addr, uint16_t offset, uint8_t *data, size_t len)
+{
+    nt3h_status_t rslt;
+
+    if ((rslt = null_ptr_check(jnl)) != NT3H_OK)
+        return rslt;
+
+    if (data == NULL || len == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    uint32_t pos = (uint32_t)addr * NTAG_I2C_BLOCK_SIZE + offset;
+
+    if (!range_valid(jnl, pos, len))
+        return NT3H_E_INVALID_ARGS;
+
+    while (len > 0)
+    {
+        uint8_t block[NTAG_I2C_BLOCK_SIZE];
+        const uint8_t *src = block;
+        size_t index;
+        uint8_t at  = (uint8_t)(pos % NTAG_I2C_BLOCK_SIZE);
+        size_t room = (size_t)(NTAG_I2C_BLOCK_SIZE - at);
+        uint8_t cnt = (uint8_t)((len < room) ? len : room);
+
+        if (find_entry(jnl, (uint8_t)(pos / NTAG_I2C_BLOCK_SIZE), &index))
+            src = jnl->entries[index].data;
+        else if ((rslt = nt3h_read_blocks(jnl->dev, (uint8_t)(pos / NTAG_I2C_BLOCK_SIZE), block, 1)) != NT3H_OK)
+            return rslt;
+
+        memcpy(data, &src[at], cnt);
+
+        pos  += cnt;
+        data += cnt;
+        len  -= cnt;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API programs all dirty blocks and empties the journal.
+ */
+nt3h_status_t nt3h_journal_commit(nt3h_journal_t *jnl)
+{
+    nt3h_status_t rslt;
+    uint8_t marker[NTAG_I2C_BLOCK_SIZE] = { 0 };
+    uint8_t staged[NT3H_JOURNAL_ATOMIC_MAX * NTAG_I2C_BLOCK_SIZE];
+    uint8_t n_dirty = 0;
+
+    if ((rslt = null_ptr_check(jnl)) != NT3H_OK)
+        return rslt;
+
+    if (jnl->marker_block == NT3H_JOURNAL_NO_MARKER)
+    {
+        if ((rslt = write_home(jnl)) == NT3H_OK)
+            jnl->n_entries = 0;
+
+        return rslt;
+    }
+
+    for (size_t i = 0; i < jnl->n_entries; i++)
+    {
+        if (!jnl->entries[i].dirty)
+            continue;
+
+        if (n_dirty == staging_blocks(jnl))
+            return NT3H_E_NO_SPACE;
+
+        marker[NT3H_JOURNAL_MARKER_HDR_LEN + n_dirty] = jnl->entries[i].block;
+        memcpy(&staged[n_dirty * NTAG_I2C_BLOCK_SIZE], jnl->entries[i].data, NTAG_I2C_BLOCK_SIZE);
+        n_dirty++;
+    }
+
+    /* Nothing changed, only a marker left armed by a failed clear needs programming */
+    if (n_dirty == 0)
+    {
+        if (jnl->marker_armed)
+        {
+            if ((rslt = nt3h_write_blocks(jnl->dev, jnl->marker_block, marker, 1)) != NT3H_OK)
+                return rslt;
+
+            jnl->marker_armed = false;
+        }
+
+        jnl->n_entries = 0;
+        return rslt;
+    }
+
+    marker[MARKER_OFFSET_MAGIC] = MARKER_MAGIC;
+    marker[MARKER_OFFSET_COUNT] = n_dirty;
+    marker[MARKER_OFFSET_CRC]   = nt3h_block_crc8(marker, MARKER_OFFSET_CRC);
+
+    /* Images first, then the marker as the commit point */
+    if ((rslt = nt3h_write_blocks(jnl->dev, jnl->marker_block + 1, staged, n_dirty)) != NT3H_OK)
+        return rslt;
+
+    if ((rslt = nt3h_write_blocks(jnl->dev, jnl->marker_block, marker, 1)) != NT3H_OK)
+        return rslt;
+
+    /* From here on nt3h_journal_recover() can finish the commit */
+    jnl->marker_armed = true;
+
+    if ((rslt = write_home(jnl)) != NT3H_OK)
+        return rslt;
+
+    memset(marker, 0, sizeof(marker));
+
+    if ((rslt = nt3h_write_blocks(jnl->dev, jnl->marker_block, marker, 1)) == NT3H_OK)
+    {
+        jnl->marker_armed = false;
+        jnl->n_entries = 0;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API drops all staged updates.
+ */
+nt3h_status_t nt3h_journal_discard(nt3h_journal_t *jnl)
+{
+    nt3h_status_t rslt;
+
+    if ((rslt = null_ptr_check(jnl)) != NT3H_OK)
+        return rslt;
+
+    jnl->n_entries = 0;
+
+    return rslt;
+}
+
+/*!
+ * @brief This API completes a commit interrupted by a reset.
+ */
+nt3h_status_t nt3h_journal_recover(nt3h_journal_t *jnl, bool *recovered)
+{
+    nt3h_status_t rslt;
+    uint8_t marker[NTAG_I2C_BLOCK_SIZE];
+    uint8_t staged[NT3H_JOURNAL_ATOMIC_MAX * NTAG_I2C_BLOCK_SIZE];
+
+    if ((rslt = null_ptr_check(jnl)) != NT3H_OK)
+        return rslt;
+
+    if (recovered != NULL)
+        *recovered = false;
+
+    if (jnl->marker_block == NT3H_JOURNAL_NO_MARKER)
+        return rslt;
+
+    if ((rslt = nt3h_read_blocks(jnl->dev, jnl->marker_block, marker, 1)) != NT3H_OK)
+        return rslt;
+
+    uint8_t n_dirty = marker[MARKER_OFFSET_COUNT];
+
+    /* Marker clear or torn: the commit either finished or never started */
+    if (marker[MARKER_OFFSET_MAGIC] != MARKER_MAGIC || n_dirty == 0 || n_dirty > staging_blocks(jnl) ||
+        nt3h_block_crc8(marker, MARKER_OFFSET_CRC) != marker[MARKER_OFFSET_CRC])
+    {
+        jnl->marker_armed = false;
+        return rslt;
+    }
+
+    /* Home blocks are never ones a commit could not have staged */
+    for (uint8_t i = 0; i < n_dirty; i++)
+    {
+        if (!range_valid(jnl, (uint32_t)marker[NT3H_JOURNAL_MARKER_HDR_LEN + i] * NTAG_I2C_BLOCK_SIZE,
+                         NTAG_I2C_BLOCK_SIZE))
+            return NT3H_E_CRC;
+    }
+
+    if ((rslt = nt3h_read_blocks(jnl->dev, jnl->marker_block + 1, staged, n_dirty)) != NT3H_OK)
+        return rslt;
+
+    /* Staged images are in ascending address order, merge consecutive blocks */
+    for (uint8_t i = 0; i < n_dirty; )
+    {
+        uint8_t run = 1;
+
+        while (i + run < n_dirty &&
+               marker[NT3H_JOURNAL_MARKER_HDR_LEN + i + run] == marker[NT3H_JOURNAL_MARKER_HDR_LEN + i] + run)
+            run++;
+
+        if ((rslt = nt3h_write_blocks(jnl->dev, marker[NT3H_JOURNAL_MARKER_HDR_LEN + i],
+                                      &staged[i * NTAG_I2C_BLOCK_SIZE], run)) != NT3H_OK)
+            return rslt;
+
+        i += run;
+    }
+
+    memset(marker, 0, sizeof(marker));
+
+    if ((rslt = nt3h_write_blocks(jnl->dev, jnl->marker_block, marker, 1)) != NT3H_OK)
+        return rslt;
+
+    jnl->marker_armed = false;
+
+    if (recovered != NULL)
+        *recovered = true;
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API finds the image of a block.
+ */
+static bool find_entry(const nt3h_journal_t *jnl, uint8_t block, size_t *index)
+{
+    size_t lo = 0;
+    size_t hi = jnl->n_entries;
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (jnl->entries[mid].block < block)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *index = lo;
+
+    return lo < jnl->n_entries && jnl->entries[lo].block == block;
+}
+
+/*!
+ * @brief This internal API returns the image of a block, staging it from the device if needed.
+ */
+static nt3h_status_t stage_entry(nt3h_journal_t *jnl, uint8_t block, nt3h_journal_entry_t **entry)
+{
+    nt3h_status_t rslt;
+    uint8_t data[NTAG_I2C_BLOCK_SIZE];
+    size_t index;
+
+    if (find_entry(jnl, block, &index))
+    {
+        *entry = &jnl->entries[index];
+        return NT3H_OK;
+    }
+
+    if (jnl->n_entries == jnl->max_entries)
+        return NT3H_E_NO_SPACE;
+
+    if ((rslt = nt3h_read_blocks(jnl->dev, block, data, 1)) != NT3H_OK)
+        return rslt;
+
+    /* Keep images sorted so commit programs in address order */
+    memmove(&jnl->entries[index + 1], &jnl->entries[index], (jnl->n_entries - index) * sizeof(jnl->entries[0]));
+    jnl->n_entries++;
+
+    *entry = &jnl->entries[index];
+    (*entry)->block = block;
+    (*entry)->dirty = false;
+    memcpy((*entry)->data, data, NTAG_I2C_BLOCK_SIZE);
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API programs dirty images to their home blocks, merging consecutive blocks.
+ */
+static nt3h_status_t write_home(nt3h_journal_t *jnl)
+{
+    nt3h_status_t rslt = NT3H_OK;
+    uint8_t run[NT3H_JOURNAL_ATOMIC_MAX * NTAG_I2C_BLOCK_SIZE];
+    size_t i = 0;
+
+    while (i < jnl->n_entries)
+    {
+        if (!jnl->entries[i].dirty)
+        {
+            i++;
+            continue;
+        }
+
+        uint8_t first = jnl->entries[i].block;
+        uint8_t cnt = 0;
+
+        do
+        {
+            memcpy(&run[cnt * NTAG_I2C_BLOCK_SIZE], jnl->entries[i + cnt].data, NTAG_I2C_BLOCK_SIZE);
+            cnt++;
+        } while (i + cnt < jnl->n_entries && cnt < NT3H_JOURNAL_ATOMIC_MAX && jnl->entries[i + cnt].dirty &&
+                 jnl->entries[i + cnt].block == first + cnt);
+
+        if ((rslt = nt3h_write_blocks(jnl->dev, first, run, cnt)) != NT3H_OK)
+            return rslt;
+
+        for (uint8_t j = 0; j < cnt; j++)
+            jnl->entries[i + j].dirty = false;
+
+        i += cnt;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API returns the number of staging blocks after the marker.
+ */
+static uint8_t staging_blocks(const nt3h_journal_t *jnl)
+{
+    return (uint8_t)((jnl->max_entries < NT3H_JOURNAL_ATOMIC_MAX) ? jnl->max_entries : NT3H_JOURNAL_ATOMIC_MAX);
+}
+
+/*!
+ * @brief This internal API checks a byte range lies in user memory outside
+ * the marker and staging blocks.
+ */
+static bool range_valid(const nt3h_journal_t *jnl, uint32_t pos, size_t len)
+{
+    uint8_t user_blocks = jnl->is_2k ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+    uint32_t first = pos / NTAG_I2C_BLOCK_SIZE;
+
+    /* Block 0 byte 0 sets the I2C address, so block 0 is never staged */
+    if (first < NTAG_MEM_BLOCK_START_USER_MEMORY || first > user_blocks ||
+        len > ((uint32_t)user_blocks + 1U) * NTAG_I2C_BLOCK_SIZE - pos)
+        return false;
+
+    if (jnl->marker_block == NT3H_JOURNAL_NO_MARKER)
+        return true;
+
+    uint32_t last = (pos + len - 1) / NTAG_I2C_BLOCK_SIZE;
+
+    return last < jnl->marker_block || first > (uint32_t)jnl->marker_block + staging_blocks(jnl);
+}
+
+/*!
+ * @brief This internal API validates the journal structure.
+ */
+static nt3h_status_t null_ptr_check(const nt3h_journal_t *jnl)
+{
+    if (jnl == NULL || jnl->dev == NULL || jnl->entries == NULL)
+        return NT3H_E_NULL_PTR;
+
+    return NT3H_OK;
+}
@@ -0,0 +1,187 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_journal.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_journal.h
+ * @brief Write-coalescing journal for NT3H memory.
+ *
+ * Byte updates are staged in RAM against images of the blocks they touch;
+ * each block is read from the device at most once, however many updates
+ * land in it. nt3h_journal_commit() then programs every block whose image
+ * changed exactly once, in ascending address order, merging consecutive
+ * blocks into a single bus transfer. Updates that leave a block unchanged
+ * cost no program at all.
+ *
+ * Optionally a commit marker block makes multi-block commits atomic. The
+ * dirty images are first copied to the staging blocks following the
+ * marker, then the marker (holding the home address of each staged image)
+ * is programmed as the commit point, the images are written home and the
+ * marker is cleared. After a reset nt3h_journal_recover() finishes any
+ * commit whose marker is still set, so either all or none of a commit
+ * reaches its home blocks.
+ */
+
+#ifndef _NT3H_JOURNAL_H_
+#define _NT3H_JOURNAL_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "nt3h.h"
+
+#define NT3H_JOURNAL_NO_MARKER      0x00
+#define NT3H_JOURNAL_MARKER_HDR_LEN 3
+#define NT3H_JOURNAL_ATOMIC_MAX     (NTAG_I2C_BLOCK_SIZE - NT3H_JOURNAL_MARKER_HDR_LEN)
+
+/*
+ * @brief Staged image of one block.
+ */
+typedef struct {
+    uint8_t block;
+    bool dirty;         /* Image differs from the device */
+    uint8_t data[NTAG_I2C_BLOCK_SIZE];
+} nt3h_journal_entry_t;
+
+/*
+ * @brief Journal state.
+ */
+typedef struct {
+
+    /* Device the journal writes to */
+    nt3h_dev_t *dev;
+
+    /* Device is a 2K part */
+    bool is_2k;
+
+    /* User allocated block images, kept sorted by block address */
+    nt3h_journal_entry_t *entries;
+    size_t max_entries;
+    size_t n_entries;
+
+    /* Commit marker block, or NT3H_JOURNAL_NO_MARKER. The
+     * min(max_entries, NT3H_JOURNAL_ATOMIC_MAX) blocks after it stage images. */
+    uint8_t marker_block;
+
+    /* Marker was programmed but not yet cleared, the next commit clears it */
+    bool marker_armed;
+
+} nt3h_journal_t;
+
+/*!
+ * @brief This API initialises a journal.
+ *
+ * @param[out]           jnl : Pointer to journal structure.
+ * @param[in]            dev : Pointer to device structure.
+ * @param[in]          is_2k : Device is a 2K part.
+ * @param[in]        entries : User allocated block images.
+ * @param[in]    max_entries : Number of block images, i.e. blocks per commit.
+ * @param[in]   marker_block : Commit marker block, or NT3H_JOURNAL_NO_MARKER
+ *                             for non-atomic commits. The marker and its
+ *                             staging blocks must lie within user memory.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_journal_init(nt3h_journal_t *jnl, nt3h_dev_t *dev, bool is_2k, nt3h_journal_entry_t *entries,
+                                size_t max_entries, uint8_t marker_block);
+
+/*!
+ * @brief This API stages a byte update.
+ *
+ * @note Addressing matches nt3h_write_bytes(). Blocks not yet staged are
+ *       read once from the device. Only user memory outside the marker and
+ *       its staging blocks may be written.
+ *
+ * @param[in]    jnl : Pointer to journal structure.
+ * @param[in]   addr : Memory address (I2C side).
+ * @param[in] offset : Byte offset within memory address.
+ * @param[in]   data : Bytes to write.
+ * @param[in]    len : Number of bytes to write.
+ *
+ * @return API status code, NT3H_E_NO_SPACE if more blocks are touched than
+ *         there are block images, NT3H_E_INVALID_ARGS if the range leaves
+ *         the blocks the journal may stage.
+ */
+nt3h_status_t nt3h_journal_write(nt3h_journal_t *jnl, uint16_t addr, uint16_t offset, const uint8_t *data,
+                                 size_t len);
+
+/*!
+ * @brief This API reads bytes as they will be after the next commit.
+ *
+ * @param[in]    jnl : Pointer to journal structure.
+ * @param[in]   addr : Memory address (I2C side).
+ * @param[in] offset : Byte offset within memory address.
+ * @param[out]  data : Buffer in which to store bytes.
+ * @param[in]    len : Number of bytes to read.
+ *
+ * @return API status code, NT3H_E_INVALID_ARGS if the range leaves the
+ *         blocks the journal may stage.
+ */
+nt3h_status_t nt3h_journal_read(nt3h_journal_t *jnl, uint16_t addr, uint16_t offset, uint8_t *data, size_t len);
+
+/*!
+ * @brief This API programs all dirty blocks and empties the journal.
+ *
+ * @note On error the journal is left intact so the commit can be retried,
+ *       the retry also clears a marker whose clear failed.
+ *
+ * @param[in] jnl : Pointer to journal structure.
+ *
+ * @return API status code, NT3H_E_NO_SPACE if an atomic commit has more than
+ *         NT3H_JOURNAL_ATOMIC_MAX dirty blocks.
+ */
+nt3h_status_t nt3h_journal_commit(nt3h_journal_t *jnl);
+
+/*!
+ * @brief This API drops all staged updates.
+ *
+ * @param[in] jnl : Pointer to journal structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_journal_discard(nt3h_journal_t *jnl);
+
+/*!
+ * @brief This API completes a commit interrupted by a reset.
+ *
+ * @note Call once at start-up before using the blocks covered by the
+ *       journal. Does nothing unless a commit marker is configured and set.
+ *
+ * @param[in]         jnl : Pointer to journal structure.
+ * @param[out] recovered : Set true if an interrupted commit was completed. Optional.
+ *
+ * @return API status code, NT3H_E_CRC if the marker names a home block the
+ *         journal may not stage.
+ */
+nt3h_status_t nt3h_journal_recover(nt3h_journal_t *jnl, bool *recovered);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* NT3H_JOURNAL_H_ */
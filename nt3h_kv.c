@@ -0,0 +1,474 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_kv.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_kv.c
+ * @brief Log-structured key-value store in NT3H user memory.
+ */
+#include <string.h>
+#include "nt3h_kv.h"
+#include "nt3h_util.h"
+
+#define KV_OFFSET_KEY       0
+#define KV_OFFSET_LEN       1
+#define KV_OFFSET_SEQ       2
+#define KV_OFFSET_CRC       5
+#define KV_OFFSET_VALUE     6
+#define KV_LEN_DELETED      0x80
+#define KV_LEN_MASK         0x7F
+#define KV_SEQ_MAX          0xFFFFFFU
+#define KV_SCAN_BLOCKS      8       /* Blocks read per bus transfer while mounting */
+
+/*!
+ * @brief This internal API finds the index slot of a key.
+ *
+ * @return Pointer to slot, or NULL if the key is not indexed.
+ */
+static nt3h_kv_slot_t *find_slot(nt3h_kv_t *kv, uint8_t key);
+
+/*!
+ * @brief This internal API checks an entry and reads its sequence number.
+ *
+ * @param[in]  entry : Ring block.
+ * @param[out]   seq : Sequence number of the entry.
+ *
+ * @return True if the block holds a whole entry, false if it is empty, torn or corrupt.
+ */
+static bool decode_entry(const uint8_t *entry, uint32_t *seq);
+
+/*!
+ * @brief This internal API writes an entry into the next reusable block.
+ *
+ * @param[in]      kv : Pointer to store structure.
+ * @param[in]     key : Key.
+ * @param[in]   value : Value bytes.
+ * @param[in]     len : Value length.
+ * @param[in] deleted : Entry is a deletion marker.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t write_entry(nt3h_kv_t *kv, uint8_t key, const uint8_t *value, uint8_t len, bool deleted);
+
+/*!
+ * @brief This internal API removes a key from the index.
+ */
+static void drop_slot(nt3h_kv_t *kv, nt3h_kv_slot_t *slot);
+
+/*!
+ * @brief This internal API tracks which ring blocks hold live entries.
+ */
+static void set_live(nt3h_kv_t *kv, uint8_t block, bool live);
+static bool is_live(const nt3h_kv_t *kv, uint8_t block);
+
+/*!
+ * @brief This internal API validates the store structure.
+ */
+static nt3h_status_t null_ptr_check(const nt3h_kv_t *kv);
+
+/*!
+ * @brief This API initialises a key-value store over a range of user memory blocks.
+ */
+nt3h_status_t nt3h_kv_init(nt3h_kv_t *kv, nt3h_dev_t *dev, bool is_2k, uint8_t first_block, uint8_t n_blocks,
+                           nt3h_kv_slot_t *slots, size_t max_slots)
+{
+    if (kv == NULL || dev == NULL || slots == NULL)
+        return NT3H_E_NULL_PTR;
+
+    uint8_t user_blocks = is_2k ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+
+    /* Check parameters are valid, the ring must lie within user memory */
+    if (first_block == 0 || n_blocks < 2 || max_slots == 0 || (uint16_t)first_block + n_blocks - 1 > user_blocks)
+        return NT3H_E_INVALID_ARGS;
+
+    memset(kv, 0, sizeof(*kv));
+    kv->dev         = dev;
+    kv->first_block = first_block;
+    kv->n_blocks    = n_blocks;
+    kv->slots       = slots;
+    kv->max_slots   = max_slots;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API erases the ring, programming every block once.
+ */
+nt3h_status_t nt3h_kv_format(nt3h_kv_t *kv)
+{
+    nt3h_status_t rslt;
+    uint8_t block[NTAG_I2C_BLOCK_SIZE] = { 0 };
+
+    if ((rslt = null_ptr_check(kv)) != NT3H_OK)
+        return rslt;
+
+    for (uint8_t i = 0; i < kv->n_blocks; i++)
+    {
+        if ((rslt = nt3h_write_blocks(kv->dev, kv->first_block + i, block, 1)) != NT3H_OK)
+            return rslt;
+    }
+
+    kv->n_slots = 0;
+    kv->head    = 0;
+    kv->seq     = 0;
+    memset(kv->live, 0, sizeof(kv->live));
+
+    return rslt;
+}
+
+/*!
+ * @brief This API rebuilds the index from the ring.
+ */
+nt3h_status_t nt3h_kv_mount(nt3h_kv_t *kv)
+{
+    nt3h_status_t rslt;
+    uint8_t blocks[KV_SCAN_BLOCKS * NTAG_I2C_BLOCK_SIZE];
+    uint8_t newest = 0;
+    uint32_t seq;
+
+    if ((rslt = null_ptr_check(kv)) != NT3H_OK)
+        return rslt;
+
+    kv->n_slots = 0;
+    kv->head    = 0;
+    kv->seq     = 0;
+    memset(kv->live, 0, sizeof(kv->live));
+
+    /* First scan finds the newest entry, and so the write position */
+    for (uint16_t base = 0; base < kv->n_blocks; base += KV_SCAN_BLOCKS)
+    {
+        uint8_t cnt = (uint8_t)((kv->n_blocks - base < KV_SCAN_BLOCKS) ? kv->n_blocks - base : KV_SCAN_BLOCKS);
+
+        if ((rslt = nt3h_read_blocks(kv->dev, (uint8_t)(kv->first_block + base), blocks, cnt)) != NT3H_OK)
+            return rslt;
+
+        for (uint8_t i = 0; i < cnt; i++)
+        {
+            if (decode_entry(&blocks[i * NTAG_I2C_BLOCK_SIZE], &seq) && seq > kv->seq)
+            {
+                kv->seq = seq;
+                newest  = (uint8_t)(base + i);
+            }
+        }
+    }
+
+    /* Continue writing after the newest entry */
+    kv->head = (kv->seq == 0) ? 0 : (uint8_t)((newest + 1) % kv->n_blocks);
+
+    /*
+     * Second scan runs from the write position round to the newest entry,
+     * the order in which the blocks were last passed. Every older entry of a
+     * deleted key lies before its deletion marker in this order (see
+     * write_entry()), so a marker only has to drop the key from the index.
+     */
+    for (uint16_t done = 0; done < kv->n_blocks;)
+    {
+        uint8_t start = (uint8_t)((kv->head + done) % kv->n_blocks);
+        uint16_t cnt  = kv->n_blocks - start;
+
+        if (cnt > kv->n_blocks - done)
+            cnt = kv->n_blocks - done;
+
+        if (cnt > KV_SCAN_BLOCKS)
+            cnt = KV_SCAN_BLOCKS;
+
+        if ((rslt = nt3h_read_blocks(kv->dev, (uint8_t)(kv->first_block + start), blocks, (uint8_t)cnt)) != NT3H_OK)
+            return rslt;
+
+        for (uint8_t i = 0; i < cnt; i++)
+        {
+            const uint8_t *entry = &blocks[i * NTAG_I2C_BLOCK_SIZE];
+
+            /* Skip empty blocks and torn or corrupt entries */
+            if (!decode_entry(entry, &seq))
+                continue;
+
+            nt3h_kv_slot_t *slot = find_slot(kv, entry[KV_OFFSET_KEY]);
+
+            /* Superseded entry */
+            if (slot != NULL && seq <= slot->seq)
+                continue;
+
+            if (entry[KV_OFFSET_LEN] & KV_LEN_DELETED)
+            {
+                if (slot != NULL)
+                    drop_slot(kv, slot);
+
+                continue;
+            }
+
+            if (slot == NULL)
+            {
+                if (kv->n_slots == kv->max_slots)
+                    return NT3H_E_NO_SPACE;
+
+                slot = &kv->slots[kv->n_slots++];
+                slot->key = entry[KV_OFFSET_KEY];
+            }
+
+            slot->block = (uint8_t)(start + i);
+            slot->seq   = seq;
+        }
+
+        done += cnt;
+    }
+
+    for (size_t i = 0; i < kv->n_slots; i++)
+        set_live(kv, kv->slots[i].block, true);
+
+    return rslt;
+}
+
+/*!
+ * @brief This API sets the value of a key.
+ */
+nt3h_status_t nt3h_kv_set(nt3h_kv_t *kv, uint8_t key, const void *value, uint8_t len)
+{
+    nt3h_status_t rslt;
+    uint8_t block[NTAG_I2C_BLOCK_SIZE];
+
+    if ((rslt = null_ptr_check(kv)) != NT3H_OK)
+        return rslt;
+
+    /* Check parameters are valid */
+    if (key < NT3H_KV_KEY_MIN || key > NT3H_KV_KEY_MAX || len > NT3H_KV_VALUE_MAX || (value == NULL && len != 0))
+        return NT3H_E_INVALID_ARGS;
+
+    nt3h_kv_slot_t *slot = find_slot(kv, key);
+
+    if (slot != NULL)
+    {
+        /* A read is far cheaper than a program, skip unchanged values */
+        if ((rslt = nt3h_read_blocks(kv->dev, kv->first_block + slot->block, block, 1)) != NT3H_OK)
+            return rslt;
+
+        if (block[KV_OFFSET_LEN] == len && (len == 0 || memcmp(&block[KV_OFFSET_VALUE], value, len) == 0))
+            return rslt;
+    }
+
+    return write_entry(kv, key, (const uint8_t *)value, len, false);
+}
+
+/*!
+ * @brief This API reads the value of a key.
+ */
+nt3h_status_t nt3h_kv_get(nt3h_kv_t *kv, uint8_t key, void *value, uint8_t *len)
+{
+    nt3h_status_t rslt;
+    uint8_t block[NTAG_I2C_BLOCK_SIZE];
+
+    if ((rslt = null_ptr_check(kv)) != NT3H_OK)
+        return rslt;
+
+    if (value == NULL || len == NULL)
+        return NT3H_E_NULL_PTR;
+
+    nt3h_kv_slot_t *slot = find_slot(kv, key);
+
+    if (slot == NULL)
+        return NT3H_E_NOT_FOUND;
+
+    if ((rslt = nt3h_read_blocks(kv->dev, kv->first_block + slot->block, block, 1)) != NT3H_OK)
+        return rslt;
+
+    *len = block[KV_OFFSET_LEN] & KV_LEN_MASK;
+    memcpy(value, &block[KV_OFFSET_VALUE], *len);
+
+    return rslt;
+}
+
+/*!
+ * @brief This API deletes a key by writing a deletion marker.
+ */
+nt3h_status_t nt3h_kv_delete(nt3h_kv_t *kv, uint8_t key)
+{
+    nt3h_status_t rslt;
+
+    if ((rslt = null_ptr_check(kv)) != NT3H_OK)
+        return rslt;
+
+    if (find_slot(kv, key) == NULL)
+        return NT3H_E_NOT_FOUND;
+
+    return write_entry(kv, key, NULL, 0, true);
+}
+
+/*!
+ * @brief This internal API finds the index slot of a key.
+ */
+static nt3h_kv_slot_t *find_slot(nt3h_kv_t *kv, uint8_t key)
+{
+    for (size_t i = 0; i < kv->n_slots; i++)
+    {
+        if (kv->slots[i].key == key)
+            return &kv->slots[i];
+    }
+
+    return NULL;
+}
+
+/*!
+ * @brief This internal API checks an entry and reads its sequence number.
+ *
+ * @param[in]  entry : Ring block.
+ * @param[out]   seq : Sequence number of the entry.
+ *
+ * @return True if the block holds a whole entry, false if it is empty, torn or corrupt.
+ */
+static bool decode_entry(const uint8_t *entry, uint32_t *seq);
+
+/*!
+ * @brief This internal API writes an entry into the next reusable block.
+ */
+static nt3h_status_t write_entry(nt3h_kv_t *kv, uint8_t key, const uint8_t *value, uint8_t len, bool deleted)
+{
+    nt3h_status_t rslt;
+    uint8_t block[NTAG_I2C_BLOCK_SIZE] = { 0 };
+    nt3h_kv_slot_t *slot = find_slot(kv, key);
+    uint16_t target;
+
+    if (slot == NULL && !deleted && kv->n_slots == kv->max_slots)
+        return NT3H_E_NO_SPACE;
+
+    /* Sequence numbers must stay ordered for mount to pick the newest entry */
+    if (kv->seq >= KV_SEQ_MAX)
+        return NT3H_E_NO_SPACE;
+
+    /* Next block from the head that no longer holds a live entry */
+    for (target = 0; target < kv->n_blocks; target++)
+    {
+        if (!is_live(kv, (uint8_t)((kv->head + target) % kv->n_blocks)))
+            break;
+    }
+
+    if (target == kv->n_blocks)
+        return NT3H_E_NO_SPACE;
+
+    uint8_t index = (uint8_t)((kv->head + target) % kv->n_blocks);
+    uint32_t seq  = kv->seq + 1;
+
+    block[KV_OFFSET_KEY]     = key;
+    block[KV_OFFSET_LEN]     = (uint8_t)(len | (deleted ? KV_LEN_DELETED : 0));
+    block[KV_OFFSET_SEQ]     = (uint8_t)seq;
+    block[KV_OFFSET_SEQ + 1] = (uint8_t)(seq >> 8);
+    block[KV_OFFSET_SEQ + 2] = (uint8_t)(seq >> 16);
+
+    if (len != 0)
+        memcpy(&block[KV_OFFSET_VALUE], value, len);
+
+    block[KV_OFFSET_CRC] = nt3h_block_crc8(block, KV_OFFSET_CRC);
+
+    if ((rslt = nt3h_write_blocks(kv->dev, kv->first_block + index, block, 1)) != NT3H_OK)
+        return rslt;
+
+    /* Previous entry is now superseded and its block reusable */
+    if (slot != NULL)
+        set_live(kv, slot->block, false);
+
+    kv->seq  = seq;
+    kv->head = (uint8_t)((index + 1) % kv->n_blocks);
+
+    /*
+     * A deletion marker must outlast the older entries of its key. These are
+     * not live, so the head overwrites each of them before it comes back round
+     * to the marker's block. The marker therefore needs neither an index slot
+     * nor a live block, and its block is reused once the head reaches it.
+     */
+    if (deleted)
+    {
+        drop_slot(kv, slot);
+        return rslt;
+    }
+
+    if (slot == NULL)
+    {
+        slot = &kv->slots[kv->n_slots++];
+        slot->key = key;
+    }
+
+    slot->block = index;
+    slot->seq   = seq;
+    set_live(kv, index, true);
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API removes a key from the index.
+ */
+static void drop_slot(nt3h_kv_t *kv, nt3h_kv_slot_t *slot);
+
+/*!
+ * @brief This internal API checks an entry and reads its sequence number.
+ */
+static bool decode_entry(const uint8_t *entry, uint32_t *seq)
+{
+    if (entry[KV_OFFSET_KEY] == 0 || (entry[KV_OFFSET_LEN] & KV_LEN_MASK) > NT3H_KV_VALUE_MAX ||
+        nt3h_block_crc8(entry, KV_OFFSET_CRC) != entry[KV_OFFSET_CRC])
+        return false;
+
+    *seq = (uint32_t)entry[KV_OFFSET_SEQ] | ((uint32_t)entry[KV_OFFSET_SEQ + 1] << 8) |
+           ((uint32_t)entry[KV_OFFSET_SEQ + 2] << 16);
+
+    return true;
+}
+
+/*!
+ * @brief This internal API removes a key from the index.
+ */
+static void drop_slot(nt3h_kv_t *kv, nt3h_kv_slot_t *slot)
+{
+    /* Index order does not matter, move the last slot into the gap */
+    *slot = kv->slots[--kv->n_slots];
+}
+
+/*!
+ * @brief This internal API tracks which ring blocks hold live entries.
+ */
+static void set_live(nt3h_kv_t *kv, uint8_t block, bool live)
+{
+    if (live)
+        kv->live[block / 8] |= (uint8_t)(1U << (block % 8));
+    else
+        kv->live[block / 8] &= (uint8_t)~(1U << (block % 8));
+}
+
+static bool is_live(const nt3h_kv_t *kv, uint8_t block)
+{
+    return (kv->live[block / 8] & (1U << (block % 8))) != 0;
+}
+
+/*!
+ * @brief This internal API validates the store structure.
+ */
+static nt3h_status_t null_ptr_check(const nt3h_kv_t *kv)
+{
+    if (kv == NULL || kv->dev == NULL || kv->slots == NULL)
+        return NT3H_E_NULL_PTR;
+
+    return NT3H_OK;
+}
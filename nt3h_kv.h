@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_kv.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_kv.h
+ * @brief Log-structured key-value store in NT3H user memory.
+ *
+ * Every entry occupies exactly one block, so updating a key costs one
+ * block program. Blocks are written in turn around a ring of user memory;
+ * the newest entry of a key (highest sequence number) is live and all older
+ * entries are free to be reused as the write position sweeps past them, so
+ * space is reclaimed in place without a separate compaction copy. A deleted
+ * key leaves a deletion marker, which holds no index slot and is reused like
+ * a superseded entry: the write position overwrites the older entries of its
+ * key before it comes back round to the marker. An in-RAM index is rebuilt
+ * at mount time by scanning the ring twice.
+ *
+ * Block layout:
+ *   [0]     key (1-254, 0 marks an empty block)
+ *   [1]     value length, bit 7 set for a deletion marker
+ *   [2..4]  24-bit sequence number, little endian
+ *   [5]     CRC-8 over bytes 0-4 and the value
+ *   [6..15] value
+ */
+
+#ifndef _NT3H_KV_H_
+#define _NT3H_KV_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "nt3h.h"
+
+#define NT3H_KV_VALUE_MAX   10
+#define NT3H_KV_KEY_MIN     0x01
+#define NT3H_KV_KEY_MAX     0xFE
+
+/*
+ * @brief In-RAM index entry, one per key.
+ */
+typedef struct {
+    uint8_t key;
+    uint8_t block;      /* Ring index of the live entry */
+    uint32_t seq;       /* Sequence number of the live entry */
+} nt3h_kv_slot_t;
+
+/*
+ * @brief Key-value store state.
+ */
+typedef struct {
+
+    /* Device the store lives on */
+    nt3h_dev_t *dev;
+
+    /* First block and number of blocks of the ring */
+    uint8_t first_block;
+    uint8_t n_blocks;
+
+    /* User allocated index */
+    nt3h_kv_slot_t *slots;
+    size_t max_slots;
+    size_t n_slots;
+
+    /* Ring index of the next block to consider for writing */
+    uint8_t head;
+
+    /* Sequence number of the newest entry */
+    uint32_t seq;
+
+    /* Blocks holding a live entry, one bit per ring index */
+    uint8_t live[32];
+
+} nt3h_kv_t;
+
+/*!
+ * @brief This API initialises a key-value store over a range of user memory blocks.
+ *
+ * @param[out]        kv : Pointer to store structure.
+ * @param[in]        dev : Pointer to device structure.
+ * @param[in]      is_2k : Device is a 2K part.
+ * @param[in] first_block : First block of the ring.
+ * @param[in]   n_blocks : Number of blocks, should exceed the number of keys,
+ *                         all within user memory.
+ * @param[in]      slots : Index storage, one slot per key.
+ * @param[in]  max_slots : Number of index slots.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_kv_init(nt3h_kv_t *kv, nt3h_dev_t *dev, bool is_2k, uint8_t first_block, uint8_t n_blocks,
+                           nt3h_kv_slot_t *slots, size_t max_slots);
+
+/*!
+ * @brief This API erases the ring, programming every block once.
+ *
+ * @param[in] kv : Pointer to store structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_kv_format(nt3h_kv_t *kv);
+
+/*!
+ * @brief This API rebuilds the index from the ring.
+ *
+ * @param[in] kv : Pointer to store structure.
+ *
+ * @return API status code, NT3H_E_NO_SPACE if there are more keys than slots.
+ */
+nt3h_status_t nt3h_kv_mount(nt3h_kv_t *kv);
+
+/*!
+ * @brief This API sets the value of a key.
+ *
+ * @note Costs one block program, or none if the value is unchanged.
+ *
+ * @param[in]    kv : Pointer to store structure.
+ * @param[in]   key : Key, NT3H_KV_KEY_MIN to NT3H_KV_KEY_MAX.
+ * @param[in] value : Value bytes.
+ * @param[in]   len : Value length, 0 to NT3H_KV_VALUE_MAX.
+ *
+ * @return API status code, NT3H_E_NO_SPACE if every block holds a live entry.
+ */
+nt3h_status_t nt3h_kv_set(nt3h_kv_t *kv, uint8_t key, const void *value, uint8_t len);
+
+/*!
+ * @brief This API reads the value of a key.
+ *
+ * @param[in]      kv : Pointer to store structure.
+ * @param[in]     key : Key.
+ * @param[out]  value : Buffer of at least NT3H_KV_VALUE_MAX bytes.
+ * @param[out]    len : Pointer to store value length.
+ *
+ * @return API status code, NT3H_E_NOT_FOUND if the key is absent or deleted.
+ */
+nt3h_status_t nt3h_kv_get(nt3h_kv_t *kv, uint8_t key, void *value, uint8_t *len);
+
+/*!
+ * @brief This API deletes a key by writing a deletion marker.
+ *
+ * @note Frees the key's index slot straight away.
+ *
+ * @param[in]  kv : Pointer to store structure.
+ * @param[in] key : Key.
+ *
+ * @return API status code, NT3H_E_NOT_FOUND if the key is absent.
+ */
+nt3h_status_t nt3h_kv_delete(nt3h_kv_t *kv, uint8_t key);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* NT3H_KV_H_ */
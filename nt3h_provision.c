@@ -0,0 +1,447 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_provision.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_provision.c
+ * @brief Provisioning engine: programs a fixed image onto several tags.
+ */
+#include <string.h>
+#include "nt3h_provision.h"
+
+/*!
+ * @brief This internal API performs the next block transaction of a fixture.
+ *
+ * @param[in]    image : Image to program.
+ * @param[in,out]   fx : Fixture to step.
+ * @param[in]   verify : Read back programmed blocks.
+ */
+static void fixture_step(const nt3h_prov_image_t *image, nt3h_prov_fixture_t *fx, bool verify);
+
+/*!
+ * @brief This internal API programs one block without waiting for the program to complete.
+ *
+ * @note The fixture may not be accessed again before fx->ready_us, and then
+ *       only once program_done() confirms the program has completed.
+ *
+ * @return Result of API execution status.
+ */
+static nt3h_status_t program_block(nt3h_prov_fixture_t *fx, uint8_t addr, const uint8_t *block);
+
+/*!
+ * @brief This internal API checks whether the last program of a fixture has completed.
+ *
+ * @note While the device is still busy fx->ready_us moves on by one poll
+ *       interval. On failure fx->rslt is set and the fixture is finished.
+ *
+ * @return True once the program has completed.
+ */
+static bool program_done(nt3h_prov_fixture_t *fx);
+
+/*!
+ * @brief This internal API moves a fixture on to the next block of the image.
+ */
+static void advance(const nt3h_prov_image_t *image, nt3h_prov_fixture_t *fx);
+
+/*!
+ * @brief This internal API returns the significant bits of an image block.
+ *
+ * @note Bytes 0 to 9 of block 0 are never significant: byte 0 reads back as
+ *       the manufacturer ID and bytes 1 to 9 are the serial number.
+ *
+ * @param[in]    seg : Segment holding the block.
+ * @param[in]  index : Block within the segment.
+ * @param[out]  mask : Significant bits of the block.
+ */
+static void block_mask(const nt3h_prov_segment_t *seg, uint8_t index, uint8_t *mask);
+
+/*!
+ * @brief This internal API compares the significant bits of a block.
+ *
+ * @return True if every bit selected by mask matches.
+ */
+static bool block_matches(const uint8_t *block, const uint8_t *data, const uint8_t *mask);
+
+/*!
+ * @brief This internal API checks whether a fixture may be accessed again.
+ */
+static bool fixture_ready(const nt3h_prov_fixture_t *fx, uint32_t *wait_us);
+
+/*!
+ * @brief This internal API marks a fixture as finished and records its time.
+ */
+static void fixture_finish(nt3h_prov_fixture_t *fx);
+
+/*!
+ * @brief This internal API validates an image.
+ */
+static nt3h_status_t image_check(const nt3h_prov_image_t *image);
+
+/*!
+ * @brief This API programs an image onto every fixture.
+ */
+nt3h_status_t nt3h_provision(const nt3h_prov_image_t *image, nt3h_prov_fixture_t *fixtures, size_t n,
+                             bool verify)
+{
+    nt3h_status_t rslt;
+
+    if (fixtures == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if ((rslt = image_check(image)) != NT3H_OK)
+        return rslt;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        nt3h_prov_fixture_t *fx = &fixtures[i];
+
+        if (fx->dev == NULL)
+            return NT3H_E_NULL_PTR;
+
+        fx->rslt       = NT3H_OK;
+        fx->skipped    = 0;
+        fx->programmed = 0;
+        fx->elapsed_us = 0;
+        fx->segment    = 0;
+        fx->index      = 0;
+        fx->verifying  = false;
+        fx->programming = false;
+        fx->done       = false;
+        fx->start_us   = (fx->dev->time_us != NULL) ? fx->dev->time_us() : 0;
+        fx->ready_us   = fx->start_us;
+
+        /* Skip empty leading segments */
+        while (fx->segment < image->n_segments && image->segments[fx->segment].cnt == 0)
+            fx->segment++;
+    }
+
+    while (1)
+    {
+        nt3h_prov_fixture_t *next = NULL;
+        uint32_t next_wait_us = UINT32_MAX;
+        bool busy = false;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            nt3h_prov_fixture_t *fx = &fixtures[i];
+            uint32_t wait_us;
+
+            if (fx->done)
+                continue;
+
+            busy = true;
+
+            if (!fixture_ready(fx, &wait_us))
+            {
+                if (wait_us < next_wait_us)
+                {
+                    next = fx;
+                    next_wait_us = wait_us;
+                }
+                continue;
+            }
+
+            /* The estimate may be short, check the device is really done */
+            if (fx->programming && !program_done(fx))
+            {
+                next = NULL;
+                next_wait_us = 0;
+                continue;
+            }
+
+            /* Only finished once the last program has completed */
+            if (fx->segment >= image->n_segments)
+                fixture_finish(fx);
+            else
+                fixture_step(image, fx, verify);
+
+            next = NULL;
+            next_wait_us = 0;
+        }
+
+        if (!busy)
+            break;
+
+        /* Every fixture is programming, wait for the first to finish */
+        if (next != NULL)
+        {
+            if (next->dev->delay_us != NULL)
+                next->dev->delay_us(next_wait_us);
+            else if (next->dev->yield != NULL)
+                next->dev->yield();
+        }
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (fixtures[i].rslt != NT3H_OK)
+            return fixtures[i].rslt;
+    }
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This internal API performs the next block transaction of a fixture.
+ */
+static void fixture_step(const nt3h_prov_image_t *image, nt3h_prov_fixture_t *fx, bool verify)
+{
+    const nt3h_prov_segment_t *seg = &image->segments[fx->segment];
+    const uint8_t *data = &seg->data[fx->index * NTAG_I2C_BLOCK_SIZE];
+    uint8_t addr = (uint8_t)(seg->block + fx->index);
+    uint8_t block[NTAG_I2C_BLOCK_SIZE];
+    uint8_t mask[NTAG_I2C_BLOCK_SIZE];
+
+    block_mask(seg, fx->index, mask);
+
+    if ((fx->rslt = nt3h_read_blocks(fx->dev, addr, block, 1)) != NT3H_OK)
+    {
+        fixture_finish(fx);
+        return;
+    }
+
+    if (fx->verifying)
+    {
+        fx->verifying = false;
+
+        if (!block_matches(block, fx->expect, mask))
+        {
+            fx->rslt = NT3H_E_VERIFY;
+            fixture_finish(fx);
+            return;
+        }
+
+        advance(image, fx);
+        return;
+    }
+
+    if (block_matches(block, data, mask))
+    {
+        fx->skipped++;
+        advance(image, fx);
+        return;
+    }
+
+    for (uint8_t i = 0; i < NTAG_I2C_BLOCK_SIZE; i++)
+        block[i] = (uint8_t)((block[i] & ~mask[i]) | (data[i] & mask[i]));
+
+    /* Byte 0 of block 0 sets the I2C address when written, keep the fixture's */
+    if (addr == 0)
+    {
+        if (fx->dev->i2c_addr == 0)
+        {
+            fx->rslt = NT3H_E_INVALID_ARGS;
+            fixture_finish(fx);
+            return;
+        }
+
+        block[0] = fx->dev->i2c_addr;
+    }
+
+    if ((fx->rslt = program_block(fx, addr, block)) != NT3H_OK)
+    {
+        fixture_finish(fx);
+        return;
+    }
+
+    fx->programmed++;
+
+    if (verify)
+    {
+        /* Read back on the next turn, once the program has completed */
+        memcpy(fx->expect, block, NTAG_I2C_BLOCK_SIZE);
+        fx->verifying = true;
+    }
+    else
+    {
+        advance(image, fx);
+    }
+}
+
+/*!
+ * @brief This internal API programs one block without waiting for the program to complete.
+ */
+static nt3h_status_t program_block(nt3h_prov_fixture_t *fx, uint8_t addr, const uint8_t *block)
+{
+    nt3h_status_t rslt;
+    nt3h_dev_t *dev = fx->dev;
+
+    /* Without a clock the driver has to wait out the program itself */
+    if (dev->time_us == NULL)
+        return nt3h_write_blocks(dev, addr, block, 1);
+
+    /* Skip the driver's own wait, the engine serves other fixtures meanwhile */
+    if ((rslt = nt3h_write_block_start(dev, addr, block)) != NT3H_OK)
+        return rslt;
+
+    fx->programming = true;
+    fx->program_us  = dev->time_us();
+    fx->ready_us    = fx->program_us + (dev->prog.estimate_us ? dev->prog.estimate_us : NT3H_EEPROM_WRITE_US);
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API checks whether the last program of a fixture has completed.
+ */
+static bool program_done(nt3h_prov_fixture_t *fx)
+{
+    nt3h_dev_t *dev = fx->dev;
+    bool busy;
+
+    if ((fx->rslt = nt3h_write_busy(dev, &busy)) != NT3H_OK)
+    {
+        fixture_finish(fx);
+        return false;
+    }
+
+    if (!busy)
+    {
+        fx->programming = false;
+        return true;
+    }
+
+    uint32_t now_us = dev->time_us();
+
+    if (now_us - fx->program_us >= NTAG_MAX_WRITE_DELAY_MS * 1000U)
+    {
+        fx->rslt = NT3H_E_TIMEOUT;
+        fixture_finish(fx);
+        return false;
+    }
+
+    fx->ready_us = now_us + (dev->prog.poll_us ? dev->prog.poll_us : NT3H_PROG_DEFAULT_POLL_US);
+
+    return false;
+}
+
+/*!
+ * @brief This internal API moves a fixture on to the next block of the image.
+ */
+static void advance(const nt3h_prov_image_t *image, nt3h_prov_fixture_t *fx)
+{
+    if (++fx->index < image->segments[fx->segment].cnt)
+        return;
+
+    fx->index = 0;
+
+    do
+    {
+        fx->segment++;
+    } while (fx->segment < image->n_segments && image->segments[fx->segment].cnt == 0);
+}
+
+/*!
+ * @brief This internal API returns the significant bits of an image block.
+ */
+static void block_mask(const nt3h_prov_segment_t *seg, uint8_t index, uint8_t *mask)
+{
+    if (seg->mask != NULL)
+        memcpy(mask, &seg->mask[index * NTAG_I2C_BLOCK_SIZE], NTAG_I2C_BLOCK_SIZE);
+    else
+        memset(mask, 0xFF, NTAG_I2C_BLOCK_SIZE);
+
+    if (seg->block + index == 0)
+        memset(mask, 0, NT3H_BLOCK_0_FIXED_LEN);
+}
+
+/*!
+ * @brief This internal API compares the significant bits of a block.
+ */
+static bool block_matches(const uint8_t *block, const uint8_t *data, const uint8_t *mask)
+{
+    for (uint8_t i = 0; i < NTAG_I2C_BLOCK_SIZE; i++)
+    {
+        if ((block[i] ^ data[i]) & mask[i])
+            return false;
+    }
+
+    return true;
+}
+
+/*!
+ * @brief This internal API checks whether a fixture may be accessed again.
+ */
+static bool fixture_ready(const nt3h_prov_fixture_t *fx, uint32_t *wait_us)
+{
+    *wait_us = 0;
+
+    if (fx->dev->time_us == NULL)
+        return true;
+
+    int32_t remaining = (int32_t)(fx->ready_us - fx->dev->time_us());
+
+    if (remaining <= 0)
+        return true;
+
+    *wait_us = (uint32_t)remaining;
+
+    return false;
+}
+
+/*!
+ * @brief This internal API marks a fixture as finished and records its time.
+ */
+static void fixture_finish(nt3h_prov_fixture_t *fx)
+{
+    fx->done = true;
+
+    if (fx->dev->time_us != NULL)
+        fx->elapsed_us = fx->dev->time_us() - fx->start_us;
+}
+
+/*!
+ * @brief This internal API validates an image.
+ */
+static nt3h_status_t image_check(const nt3h_prov_image_t *image)
+{
+    if (image == NULL || (image->segments == NULL && image->n_segments != 0))
+        return NT3H_E_NULL_PTR;
+
+    uint8_t user_blocks = image->is_2k ? NT3H_USER_BLOCKS_2K : NT3H_USER_BLOCKS_1K;
+    uint8_t config = image->is_2k ? NTAG_MEM_BLOCK_CONFIGURATION_2k : NTAG_MEM_BLOCK_CONFIGURATION_1k;
+
+    for (size_t i = 0; i < image->n_segments; i++)
+    {
+        const nt3h_prov_segment_t *seg = &image->segments[i];
+
+        if (seg->cnt == 0)
+            continue;
+
+        if (seg->data == NULL)
+            return NT3H_E_NULL_PTR;
+
+        uint16_t last = (uint16_t)seg->block + seg->cnt - 1;
+
+        /* Block 0 and user memory, or the configuration block alone. Lock,
+         * SRAM and session blocks are never programmed from an image */
+        if (last > user_blocks && !(seg->block == config && last == config))
+            return NT3H_E_INVALID_ARGS;
+    }
+
+    return NT3H_OK;
+}
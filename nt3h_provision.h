@@ -0,0 +1,139 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_provision.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_provision.h
+ * @brief Provisioning engine: programs a fixed image onto several tags.
+ *
+ * Each fixture is a device on its own bus. The engine steps the fixtures
+ * round robin, one block transaction at a time: while one tag is busy
+ * programming an EEPROM block the others are read, compared and written,
+ * so the program times of different tags overlap. Blocks whose significant
+ * bytes already match the image are skipped, and every programmed block
+ * is read back and compared.
+ *
+ * Overlapping needs dev->time_us on each fixture; without it a fixture
+ * waits out each program itself and fixtures are effectively sequential.
+ */
+
+#ifndef _NT3H_PROVISION_H_
+#define _NT3H_PROVISION_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "nt3h.h"
+
+/*
+ * @brief Run of consecutive blocks in a provisioning image.
+ */
+typedef struct {
+
+    /* First block and number of blocks */
+    uint8_t block;
+    uint8_t cnt;
+
+    /* Block contents, cnt * NTAG_I2C_BLOCK_SIZE bytes */
+    const uint8_t *data;
+
+    /* Significant bits of data, same size, NULL if all bits are. Other
+     * bits keep their current value and are ignored when comparing */
+    const uint8_t *mask;
+
+} nt3h_prov_segment_t;
+
+/*
+ * @brief Provisioning image, segments in programming order.
+ *
+ * Segments may cover block 0, user memory and the configuration block of
+ * the variant. In block 0 only the static lock bytes and capability
+ * container (bytes 10 to 15) are compared and programmed; byte 0 is
+ * written with dev->i2c_addr.
+ */
+typedef struct {
+    const nt3h_prov_segment_t *segments;
+    size_t n_segments;
+    bool is_2k;
+} nt3h_prov_image_t;
+
+/*
+ * @brief One tag being provisioned, with its result and timing.
+ */
+typedef struct {
+
+    /* Device on this fixture */
+    nt3h_dev_t *dev;
+
+    /* Result, NT3H_E_VERIFY if a block read back differently */
+    nt3h_status_t rslt;
+
+    /* Blocks skipped because they already matched, and blocks programmed */
+    uint16_t skipped;
+    uint16_t programmed;
+
+    /* Time from first to last transaction, in us (requires time_us) */
+    uint32_t elapsed_us;
+
+    /* Engine state */
+    size_t segment;
+    uint8_t index;
+    bool verifying;
+    bool programming;
+    bool done;
+    uint32_t start_us;
+    uint32_t program_us;
+    uint32_t ready_us;
+    uint8_t expect[NTAG_I2C_BLOCK_SIZE];
+
+} nt3h_prov_fixture_t;
+
+/*!
+ * @brief This API programs an image onto every fixture.
+ *
+ * @note Returns once every fixture has finished. A failing fixture stops
+ *       and reports its error in fixtures[i].rslt; the others carry on.
+ *
+ * @param[in]         image : Image to program.
+ * @param[in,out] fixtures : Fixtures, dev set by the caller.
+ * @param[in]            n : Number of fixtures.
+ * @param[in]       verify : Read back and compare every programmed block.
+ *
+ * @return API status code, NT3H_OK only if every fixture succeeded. A
+ *         fixture fails with NT3H_E_INVALID_ARGS if block 0 must be
+ *         programmed and its dev->i2c_addr is 0, and with NT3H_E_TIMEOUT
+ *         if a program is still busy after NTAG_MAX_WRITE_DELAY_MS.
+ */
+nt3h_status_t nt3h_provision(const nt3h_prov_image_t *image, nt3h_prov_fixture_t *fixtures, size_t n,
+                             bool verify);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* NT3H_PROVISION_H_ */
@@ -0,0 +1,998 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_sim.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_sim.c
+ * @brief Host simulator of NT3H2111/2211 tags for fleet-scale testing.
+ */
+#include <string.h>
+#include "nt3h_sim.h"
+
+#define SIM_NUM_REGS        8
+
+/* NS_REG bits the I2C host may write, the rest report tag status */
+#define SIM_NS_REG_WRITABLE (NTAG_NS_REG_MASK_I2C_LOCKED | NTAG_NS_REG_MASK_EEPROM_WR_ERR | \
+                             NTAG_NS_REG_MASK_NDEF_DATA_READ)
+
+/* Last SRAM block, whose access moves the pass-through flags */
+#define SIM_SRAM_LAST       (NTAG_MEM_BLOCK_START_SRAM + NTAG_MEM_SRAM_BLOCKS - 1)
+
+/* Bytes of block 0 that do not read back as written: manufacturer ID and serial number */
+#define SIM_SERIAL_LEN      7
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_THREADS__)
+#define SIM_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define SIM_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define SIM_THREAD_LOCAL __declspec(thread)
+#else
+#define SIM_THREAD_LOCAL /* Single threaded hosts */
+#endif
+
+/* Shard bound to the calling thread */
+static SIM_THREAD_LOCAL nt3h_sim_shard_t *current;
+
+/*!
+ * @brief This internal API finds the tag addressed by a bus callback.
+ *
+ * @param[in]  shard : Pointer to shard structure.
+ * @param[in] dev_id : Index of the tag within the shard.
+ * @param[out]   tag : Pointer to store tag.
+ *
+ * @return API status code.
+ */
+static nt3h_status_t lookup(nt3h_sim_shard_t *shard, uint8_t dev_id, nt3h_sim_tag_t **tag);
+
+/*!
+ * @brief This internal API applies the I2C address written to byte 0 of block 0.
+ *
+ * @param[in] tag  : Pointer to tag structure.
+ * @param[in] addr : Address written, 7-bit address shifted left by 1.
+ */
+static void set_address(nt3h_sim_tag_t *tag, uint8_t addr);
+
+/*!
+ * @brief This internal API advances the virtual clock by the time of a bus transaction.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in]   len : Transaction payload length, excluding the address byte.
+ */
+static void bus_time(nt3h_sim_shard_t *shard, size_t len);
+
+/*!
+ * @brief This internal API advances the virtual clock, dispatching events in time order.
+ *
+ * @note The clock is set to each event's time before it is dispatched, and
+ *       never moves backwards if a handler advances it further.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in] period_ns : Time to advance.
+ */
+static void advance(nt3h_sim_shard_t *shard, uint64_t period_ns);
+
+/*!
+ * @brief This internal API applies an event to its tag.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in]   evt : Pointer to event.
+ */
+static void dispatch(nt3h_sim_shard_t *shard, const nt3h_sim_event_t *evt);
+
+/*!
+ * @brief This internal API orders two events by time, then by scheduling order.
+ *
+ * @param[in] a : First event.
+ * @param[in] b : Second event.
+ *
+ * @return True if a is due before b.
+ */
+static bool event_before(const nt3h_sim_event_t *a, const nt3h_sim_event_t *b);
+
+/*!
+ * @brief This internal API adds an event to the queue heap.
+ *
+ * @param[in] shard : Pointer to shard structure, with room for the event.
+ * @param[in]   evt : Pointer to event.
+ */
+static void queue_push(nt3h_sim_shard_t *shard, const nt3h_sim_event_t *evt);
+
+/*!
+ * @brief This internal API removes the earliest event from the queue heap.
+ *
+ * @param[in]  shard : Pointer to shard structure, with at least one event.
+ * @param[out]   evt : Pointer to store event.
+ */
+static void queue_pop(nt3h_sim_shard_t *shard, nt3h_sim_event_t *evt);
+
+/*!
+ * @brief This internal API claims the memory for an I2C access.
+ *
+ * @note Sets I2C_LOCKED and starts the watchdog if not already held. SRAM
+ *       in pass-through mode is arbitrated by the ready flags instead.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in]   tag : Pointer to tag structure.
+ * @param[in] block : Block address.
+ *
+ * @return True if the access may proceed, false if RF holds the memory.
+ */
+static bool i2c_access(nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag, uint8_t block);
+
+/*!
+ * @brief This internal API releases I2C_LOCKED once the watchdog has expired.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in]   tag : Pointer to tag structure.
+ */
+static void wdt_expire(const nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag);
+
+/*!
+ * @brief This internal API returns the watchdog period from the session registers.
+ *
+ * @param[in] tag : Pointer to tag structure.
+ *
+ * @return Watchdog period in nanoseconds.
+ */
+static uint64_t wdt_ns(const nt3h_sim_tag_t *tag);
+
+/*!
+ * @brief This internal API checks whether pass-through mode is enabled.
+ *
+ * @param[in] tag : Pointer to tag structure.
+ *
+ * @return True if PTHRU_ON_OFF is set.
+ */
+static bool pass_through(const nt3h_sim_tag_t *tag);
+
+/*!
+ * @brief This internal API counts and reports a NAK.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in]   tag : Pointer to tag structure.
+ *
+ * @return NT3H_E_NAK.
+ */
+static nt3h_status_t nak(nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag);
+
+/*!
+ * @brief This internal API checks whether a block exists on the tag.
+ *
+ * @param[in]   tag : Pointer to tag structure.
+ * @param[in] block : Block address.
+ *
+ * @return True if the block is EEPROM or SRAM.
+ */
+static bool block_valid(const nt3h_sim_tag_t *tag, uint8_t block);
+
+/*!
+ * @brief This internal API checks whether a block is SRAM.
+ *
+ * @param[in] block : Block address.
+ *
+ * @return True if the block is SRAM.
+ */
+static bool block_sram(uint8_t block);
+
+/*!
+ * @brief This internal API checks whether the tag is still programming EEPROM.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in]   tag : Pointer to tag structure.
+ *
+ * @return True if an EEPROM program is in progress.
+ */
+static bool eeprom_busy(const nt3h_sim_shard_t *shard, const nt3h_sim_tag_t *tag);
+
+/*!
+ * @brief This internal API lets an EEPROM access through once no program is in progress.
+ *
+ * @note With I2C_CLOCK_STR set the tag holds SCL low until the program
+ *       completes, occupying the bus; otherwise the access is NAKed.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in]   tag : Pointer to tag structure.
+ *
+ * @return True if the access may proceed.
+ */
+static bool eeprom_wait(nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag);
+
+/*!
+ * @brief This internal API stores a written block.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in]   tag : Pointer to tag structure.
+ * @param[in] block : Block address.
+ * @param[in]  data : 16 bytes of block data.
+ */
+static void program(nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag, uint8_t block, const uint8_t *data);
+
+/*!
+ * @brief This internal API returns the current value of a session register.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in]   tag : Pointer to tag structure.
+ * @param[in]   reg : Register offset.
+ *
+ * @return Register value.
+ */
+static uint8_t session_read(const nt3h_sim_shard_t *shard, const nt3h_sim_tag_t *tag, uint8_t reg);
+
+/*!
+ * @brief This internal API applies a masked write to a session register.
+ *
+ * @param[in] shard : Pointer to shard structure.
+ * @param[in]   tag : Pointer to tag structure.
+ * @param[in]   reg : Register offset.
+ * @param[in]  mask : Bits to write.
+ * @param[in]  data : New value of the masked bits.
+ */
+static void session_write(const nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag, uint8_t reg, uint8_t mask,
+                          uint8_t data);
+
+/*!
+ * @brief This internal API returns the configuration block of the tag.
+ *
+ * @param[in] tag : Pointer to tag structure.
+ *
+ * @return Block address.
+ */
+static uint8_t config_block(const nt3h_sim_tag_t *tag);
+
+/*!
+ * @brief This API formats a tag to its factory state and powers it on.
+ */
+nt3h_status_t nt3h_sim_tag_init(nt3h_sim_tag_t *tag, nt3h_sim_mem_t *mem, bool is_2k, uint64_t serial)
+{
+    static const uint8_t block_0[]  = NT3H_FACTORY_VALUE_BLOCK_0;
+    static const uint8_t block_56[] = NT3H_FACTORY_VALUE_BLOCK_56;
+    static const uint8_t block_57[] = NT3H_FACTORY_VALUE_BLOCK_57;
+    static const uint8_t block_58[] = NT3H_FACTORY_VALUE_BLOCK_58;
+
+    if (tag == NULL || mem == NULL)
+        return NT3H_E_NULL_PTR;
+
+    memset(tag, 0, sizeof(*tag));
+    memset(mem, 0, sizeof(*mem));
+    tag->mem   = mem;
+    tag->is_2k = is_2k;
+
+    uint8_t config = config_block(tag);
+
+    memcpy(mem->blocks[0], block_0, NTAG_I2C_BLOCK_SIZE);
+    for (uint8_t i = 1; i < SIM_SERIAL_LEN; i++)
+        mem->blocks[0][i] = (uint8_t)(serial >> (8U * (SIM_SERIAL_LEN - 1U - i)));
+    mem->blocks[0][NT3H_CC_MLEN_OFFSET] = is_2k ? NT3H_CC_MLEN_2K : NT3H_CC_MLEN_1K;
+
+    memcpy(mem->blocks[config - 2], block_56, NTAG_I2C_BLOCK_SIZE);
+    memcpy(mem->blocks[config - 1], block_57, NTAG_I2C_BLOCK_SIZE);
+    memcpy(mem->blocks[config], block_58, NTAG_I2C_BLOCK_SIZE);
+
+    /* Record the variant so the image describes itself */
+    mem->blocks[NT3H_SIM_META_BLOCK][NT3H_SIM_META_OFFSET_FLAGS] = is_2k ? NT3H_SIM_META_FLAG_2K : 0;
+
+    return nt3h_sim_tag_reset(tag);
+}
+
+/*!
+ * @brief This API power cycles a tag.
+ */
+nt3h_status_t nt3h_sim_tag_reset(nt3h_sim_tag_t *tag)
+{
+    if (tag == NULL || tag->mem == NULL)
+        return NT3H_E_NULL_PTR;
+
+    uint8_t *session = tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS];
+
+    /* Session registers load from the configuration registers, NS_REG clears */
+    memset(session, 0, NTAG_I2C_BLOCK_SIZE);
+    memcpy(session, tag->mem->blocks[config_block(tag)], NTAG_MEM_OFFSET_NS_REG);
+
+    memset(tag->mem->blocks[NTAG_MEM_BLOCK_START_SRAM], 0, NTAG_MEM_SRAM_SIZE);
+
+    tag->block         = 0;
+    tag->reg           = 0;
+    tag->reg_access    = false;
+    tag->busy_until_ns = 0;
+    tag->wdt_until_ns  = 0;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API initialises a shard over a set of tags.
+ */
+nt3h_status_t nt3h_sim_shard_init(nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tags, size_t n_tags)
+{
+    if (shard == NULL || tags == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (n_tags == 0 || n_tags > NT3H_SIM_MAX_TAGS)
+        return NT3H_E_INVALID_ARGS;
+
+    memset(shard, 0, sizeof(*shard));
+    shard->tags   = tags;
+    shard->n_tags = n_tags;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API gives a shard storage for scheduled events.
+ */
+nt3h_status_t nt3h_sim_queue_init(nt3h_sim_shard_t *shard, nt3h_sim_event_t *events, size_t max_events)
+{
+    if (shard == NULL || events == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (max_events == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    shard->events     = events;
+    shard->max_events = max_events;
+    shard->n_events   = 0;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API schedules an event.
+ */
+nt3h_status_t nt3h_sim_schedule(nt3h_sim_shard_t *shard, uint32_t after_us, const nt3h_sim_event_t *evt)
+{
+    if (shard == NULL || evt == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (evt->type > NT3H_SIM_EVT_CALL)
+        return NT3H_E_INVALID_ARGS;
+
+    if (evt->type == NT3H_SIM_EVT_CALL ? evt->func == NULL : evt->dev_id >= shard->n_tags)
+        return NT3H_E_INVALID_ARGS;
+
+    if (shard->events == NULL || shard->n_events >= shard->max_events)
+        return NT3H_E_NO_SPACE;
+
+    nt3h_sim_event_t queued = *evt;
+
+    queued.at_ns = shard->now_ns + (uint64_t)after_us * 1000U;
+    queued.seq   = shard->seq++;
+    queue_push(shard, &queued);
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API advances the virtual clock, dispatching events that fall due.
+ */
+nt3h_status_t nt3h_sim_advance_us(nt3h_sim_shard_t *shard, uint32_t period_us)
+{
+    if (shard == NULL)
+        return NT3H_E_NULL_PTR;
+
+    advance(shard, (uint64_t)period_us * 1000U);
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API advances the virtual clock until no events are pending.
+ */
+nt3h_status_t nt3h_sim_run(nt3h_sim_shard_t *shard)
+{
+    if (shard == NULL)
+        return NT3H_E_NULL_PTR;
+
+    /* The clock never passes a pending event, so the difference is never negative */
+    while (shard->n_events > 0)
+        advance(shard, shard->events[0].at_ns - shard->now_ns);
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API binds a shard to the calling thread.
+ */
+void nt3h_sim_bind(nt3h_sim_shard_t *shard)
+{
+    current = shard;
+}
+
+/*!
+ * @brief This API returns the shard bound to the calling thread.
+ */
+nt3h_sim_shard_t *nt3h_sim_current(void)
+{
+    return current;
+}
+
+/*!
+ * @brief This API points the callbacks of a device at a simulated tag.
+ */
+nt3h_status_t nt3h_sim_dev_init(nt3h_dev_t *dev, uint8_t dev_id)
+{
+    if (dev == NULL)
+        return NT3H_E_NULL_PTR;
+
+    dev->dev_id   = dev_id;
+    dev->i2c_addr = NT3H_SIM_I2C_ADDR;
+    dev->write    = nt3h_sim_write;
+    dev->read     = nt3h_sim_read;
+    dev->delay_ms = nt3h_sim_delay_ms;
+    dev->delay_us = nt3h_sim_delay_us;
+    dev->yield    = nt3h_sim_yield;
+    dev->time_us  = nt3h_sim_time_us;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API handles an I2C write to a simulated tag.
+ */
+nt3h_status_t nt3h_sim_write(uint8_t dev_id, uint8_t *data, size_t len)
+{
+    nt3h_status_t rslt;
+    nt3h_sim_shard_t *shard = current;
+    nt3h_sim_tag_t *tag;
+
+    if ((rslt = lookup(shard, dev_id, &tag)) != NT3H_OK)
+        return rslt;
+
+    if (data == NULL || len == 0)
+        return NT3H_E_INVALID_ARGS;
+
+    bus_time(shard, len);
+    wdt_expire(shard, tag);
+
+    uint8_t block = data[0];
+
+    /* Register read address (2 bytes) or masked register write (4 bytes) */
+    if (block == NTAG_MEM_BLOCK_SESSION_REGS && (len == 2 || len == 4))
+    {
+        if (data[1] >= SIM_NUM_REGS)
+            return nak(shard, tag);
+
+        tag->reg        = data[1];
+        tag->reg_access = true;
+
+        if (len == 4)
+            session_write(shard, tag, data[1], data[2], data[3]);
+
+        return NT3H_OK;
+    }
+
+    /* Block read address (1 byte) or block write (17 bytes) */
+    if ((len != 1 && len != 1 + NTAG_I2C_BLOCK_SIZE) || !block_valid(tag, block))
+        return nak(shard, tag);
+
+    if (!block_sram(block) && !eeprom_wait(shard, tag))
+        return nak(shard, tag);
+
+    if (!i2c_access(shard, tag, block))
+        return nak(shard, tag);
+
+    tag->block      = block;
+    tag->reg_access = false;
+
+    if (len > 1)
+    {
+        program(shard, tag, block, &data[1]);
+
+        /* Byte 0 of block 0 reads back as the manufacturer ID but sets the address */
+        if (block == 0)
+            set_address(tag, data[1]);
+
+        /* I2C to RF pass-through: data is ready for the RF side */
+        if (block == SIM_SRAM_LAST && pass_through(tag))
+            tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS][NTAG_MEM_OFFSET_NS_REG] |= NTAG_NS_REG_MASK_SRAM_RF_READY;
+    }
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API handles an I2C read from a simulated tag.
+ */
+nt3h_status_t nt3h_sim_read(uint8_t dev_id, uint8_t *data, size_t len)
+{
+    nt3h_status_t rslt;
+    nt3h_sim_shard_t *shard = current;
+    nt3h_sim_tag_t *tag;
+
+    if ((rslt = lookup(shard, dev_id, &tag)) != NT3H_OK)
+        return rslt;
+
+    if (data == NULL || len == 0 || len > NTAG_I2C_BLOCK_SIZE)
+        return NT3H_E_INVALID_ARGS;
+
+    bus_time(shard, len);
+    wdt_expire(shard, tag);
+
+    if (tag->reg_access)
+    {
+        if (len != 1)
+            return nak(shard, tag);
+
+        data[0] = session_read(shard, tag, tag->reg);
+        return NT3H_OK;
+    }
+
+    if (!block_sram(tag->block) && !eeprom_wait(shard, tag))
+        return nak(shard, tag);
+
+    if (!i2c_access(shard, tag, tag->block))
+        return nak(shard, tag);
+
+    memcpy(data, tag->mem->blocks[tag->block], len);
+
+    /* RF to I2C pass-through: data has been taken by the I2C side */
+    if (tag->block == SIM_SRAM_LAST && pass_through(tag))
+        tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS][NTAG_MEM_OFFSET_NS_REG] &= (uint8_t)~NTAG_NS_REG_MASK_SRAM_I2C_READY;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API advances the virtual clock of the bound shard.
+ */
+void nt3h_sim_delay_ms(uint32_t period_ms)
+{
+    if (current != NULL)
+        advance(current, (uint64_t)period_ms * 1000000U);
+}
+
+/*!
+ * @brief This API advances the virtual clock of the bound shard.
+ */
+void nt3h_sim_delay_us(uint32_t period_us)
+{
+    if (current != NULL)
+        advance(current, (uint64_t)period_us * 1000U);
+}
+
+/*!
+ * @brief This API advances the virtual clock of the bound shard to the next
+ * event, or by the yield time if no event is due sooner.
+ */
+void nt3h_sim_yield(void)
+{
+    nt3h_sim_shard_t *shard = current;
+
+    if (shard == NULL)
+        return;
+
+    uint64_t step = (shard->yield_ns != 0) ? shard->yield_ns : NT3H_SIM_DEFAULT_YIELD_NS;
+
+    if (shard->n_events > 0 && shard->events[0].at_ns - shard->now_ns < step)
+        step = shard->events[0].at_ns - shard->now_ns;
+
+    advance(shard, step);
+}
+
+/*!
+ * @brief This API returns the virtual clock of the bound shard.
+ */
+uint32_t nt3h_sim_time_us(void)
+{
+    return (current != NULL) ? (uint32_t)(current->now_ns / 1000U) : 0;
+}
+
+/*!
+ * @brief This internal API finds the tag addressed by a bus callback.
+ */
+static nt3h_status_t lookup(nt3h_sim_shard_t *shard, uint8_t dev_id, nt3h_sim_tag_t **tag)
+{
+    if (shard == NULL || shard->tags == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (dev_id >= shard->n_tags || shard->tags[dev_id].mem == NULL)
+        return NT3H_E_DEV_NOT_FOUND;
+
+    /* A tag moved to another address no longer acknowledges this one */
+    if (shard->tags[dev_id].mem->blocks[NT3H_SIM_META_BLOCK][NT3H_SIM_META_OFFSET_FLAGS] & NT3H_SIM_META_FLAG_MOVED)
+        return NT3H_E_DEV_NOT_FOUND;
+
+    *tag = &shard->tags[dev_id];
+    shard->transactions++;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This internal API applies the I2C address written to byte 0 of block 0.
+ */
+static void set_address(nt3h_sim_tag_t *tag, uint8_t addr)
+{
+    uint8_t *meta = tag->mem->blocks[NT3H_SIM_META_BLOCK];
+
+    if (addr == NT3H_SIM_I2C_ADDR)
+        return;
+
+    meta[NT3H_SIM_META_OFFSET_FLAGS] |= NT3H_SIM_META_FLAG_MOVED;
+    meta[NT3H_SIM_META_OFFSET_ADDR]   = addr;
+    tag->addr_changes++;
+}
+
+/*!
+ * @brief This internal API advances the virtual clock by the time of a bus transaction.
+ */
+static void bus_time(nt3h_sim_shard_t *shard, size_t len)
+{
+    uint32_t byte_ns = (shard->byte_ns != 0) ? shard->byte_ns : NT3H_SIM_DEFAULT_BYTE_NS;
+
+    /* Device address byte plus payload */
+    uint64_t period_ns = (uint64_t)(len + 1U) * byte_ns;
+
+    shard->bus_ns += period_ns;
+    advance(shard, period_ns);
+}
+
+/*!
+ * @brief This internal API advances the virtual clock, dispatching events in time order.
+ */
+static void advance(nt3h_sim_shard_t *shard, uint64_t period_ns)
+{
+    uint64_t target = shard->now_ns + period_ns;
+
+    while (shard->n_events > 0 && shard->events[0].at_ns <= target)
+    {
+        nt3h_sim_event_t evt;
+
+        queue_pop(shard, &evt);
+
+        if (evt.at_ns > shard->now_ns)
+            shard->now_ns = evt.at_ns;
+
+        dispatch(shard, &evt);
+    }
+
+    if (target > shard->now_ns)
+        shard->now_ns = target;
+}
+
+/*!
+ * @brief This internal API applies an event to its tag.
+ */
+static void dispatch(nt3h_sim_shard_t *shard, const nt3h_sim_event_t *evt)
+{
+    shard->dispatched++;
+
+    if (evt->type == NT3H_SIM_EVT_CALL)
+    {
+        evt->func(evt->dev_id, evt->ctx);
+        return;
+    }
+
+    nt3h_sim_tag_t *tag = &shard->tags[evt->dev_id];
+
+    if (tag->mem == NULL)
+        return;
+
+    wdt_expire(shard, tag);
+
+    uint8_t *ns_reg = &tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS][NTAG_MEM_OFFSET_NS_REG];
+    bool field      = (*ns_reg & NTAG_NS_REG_MASK_RF_FIELD_PRESENT) != 0;
+    bool i2c_locked = (*ns_reg & NTAG_NS_REG_MASK_I2C_LOCKED) != 0;
+    bool sram       = block_sram(evt->block) && pass_through(tag);
+
+    switch (evt->type)
+    {
+    case NT3H_SIM_EVT_FIELD_ON:
+        *ns_reg |= NTAG_NS_REG_MASK_RF_FIELD_PRESENT;
+        break;
+
+    case NT3H_SIM_EVT_FIELD_OFF:
+        *ns_reg &= (uint8_t)~(NTAG_NS_REG_MASK_RF_FIELD_PRESENT | NTAG_NS_REG_MASK_RF_LOCKED);
+        break;
+
+    case NT3H_SIM_EVT_RF_LOCK:
+        if (!field || i2c_locked)
+            tag->rf_denied++;
+        else
+            *ns_reg |= NTAG_NS_REG_MASK_RF_LOCKED;
+        break;
+
+    case NT3H_SIM_EVT_RF_UNLOCK:
+        *ns_reg &= (uint8_t)~NTAG_NS_REG_MASK_RF_LOCKED;
+        break;
+
+    case NT3H_SIM_EVT_RF_WRITE:
+        /* EEPROM takes no new write until the current program completes */
+        if (!field || !block_valid(tag, evt->block) || (i2c_locked && !sram) ||
+            (!block_sram(evt->block) && eeprom_busy(shard, tag)))
+        {
+            tag->rf_denied++;
+            break;
+        }
+
+        program(shard, tag, evt->block, evt->data);
+
+        /* RF to I2C pass-through: data is ready for the I2C side */
+        if (sram && evt->block == SIM_SRAM_LAST)
+            *ns_reg |= NTAG_NS_REG_MASK_SRAM_I2C_READY;
+        break;
+
+    case NT3H_SIM_EVT_RF_READ:
+        if (!field || !block_valid(tag, evt->block) || (i2c_locked && !sram))
+        {
+            tag->rf_denied++;
+            break;
+        }
+
+        /* I2C to RF pass-through: data has been taken by the RF side */
+        if (sram && evt->block == SIM_SRAM_LAST)
+            *ns_reg &= (uint8_t)~NTAG_NS_REG_MASK_SRAM_RF_READY;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*!
+ * @brief This internal API orders two events by time, then by scheduling order.
+ */
+static bool event_before(const nt3h_sim_event_t *a, const nt3h_sim_event_t *b)
+{
+    if (a->at_ns != b->at_ns)
+        return a->at_ns < b->at_ns;
+
+    return (int32_t)(a->seq - b->seq) < 0;
+}
+
+/*!
+ * @brief This internal API adds an event to the queue heap.
+ */
+static void queue_push(nt3h_sim_shard_t *shard, const nt3h_sim_event_t *evt)
+{
+    nt3h_sim_event_t *heap = shard->events;
+    size_t i = shard->n_events++;
+
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+
+        if (!event_before(evt, &heap[parent]))
+            break;
+
+        heap[i] = heap[parent];
+        i = parent;
+    }
+
+    heap[i] = *evt;
+}
+
+/*!
+ * @brief This internal API removes the earliest event from the queue heap.
+ */
+static void queue_pop(nt3h_sim_shard_t *shard, nt3h_sim_event_t *evt)
+{
+    nt3h_sim_event_t *heap = shard->events;
+    size_t n = --shard->n_events;
+    size_t i = 0;
+
+    *evt = heap[0];
+
+    while (2 * i + 1 < n)
+    {
+        size_t child = 2 * i + 1;
+
+        if (child + 1 < n && event_before(&heap[child + 1], &heap[child]))
+            child++;
+
+        if (!event_before(&heap[child], &heap[n]))
+            break;
+
+        heap[i] = heap[child];
+        i = child;
+    }
+
+    heap[i] = heap[n];
+}
+
+/*!
+ * @brief This internal API claims the memory for an I2C access.
+ */
+static bool i2c_access(nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag, uint8_t block)
+{
+    uint8_t *ns_reg = &tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS][NTAG_MEM_OFFSET_NS_REG];
+
+    if (block_sram(block) && pass_through(tag))
+        return true;
+
+    if (*ns_reg & NTAG_NS_REG_MASK_RF_LOCKED)
+        return false;
+
+    if ((*ns_reg & NTAG_NS_REG_MASK_I2C_LOCKED) == 0)
+    {
+        *ns_reg |= NTAG_NS_REG_MASK_I2C_LOCKED;
+        tag->wdt_until_ns = shard->now_ns + wdt_ns(tag);
+    }
+
+    return true;
+}
+
+/*!
+ * @brief This internal API releases I2C_LOCKED once the watchdog has expired.
+ */
+static void wdt_expire(const nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag)
+{
+    uint8_t *ns_reg = &tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS][NTAG_MEM_OFFSET_NS_REG];
+
+    if ((*ns_reg & NTAG_NS_REG_MASK_I2C_LOCKED) && shard->now_ns >= tag->wdt_until_ns)
+        *ns_reg &= (uint8_t)~NTAG_NS_REG_MASK_I2C_LOCKED;
+}
+
+/*!
+ * @brief This internal API returns the watchdog period from the session registers.
+ */
+static uint64_t wdt_ns(const nt3h_sim_tag_t *tag)
+{
+    const uint8_t *session = tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS];
+    uint32_t ticks = ((uint32_t)session[NTAG_MEM_OFFSET_WDT_MS] << 8) | session[NTAG_MEM_OFFSET_WDT_LS];
+
+    return (uint64_t)ticks * NT3H_WDT_TICK_NS;
+}
+
+/*!
+ * @brief This internal API checks whether pass-through mode is enabled.
+ */
+static bool pass_through(const nt3h_sim_tag_t *tag)
+{
+    return (tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS][NTAG_MEM_OFFSET_NC_REG] & NTAG_NC_REG_MASK_PTHRU_ON_OFF) != 0;
+}
+
+/*!
+ * @brief This internal API counts and reports a NAK.
+ */
+static nt3h_status_t nak(nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag)
+{
+    shard->naks++;
+    tag->naks++;
+
+    return NT3H_E_NAK;
+}
+
+/*!
+ * @brief This internal API checks whether a block exists on the tag.
+ */
+static bool block_valid(const nt3h_sim_tag_t *tag, uint8_t block)
+{
+    return block <= config_block(tag) || block_sram(block);
+}
+
+/*!
+ * @brief This internal API checks whether a block is SRAM.
+ */
+static bool block_sram(uint8_t block)
+{
+    return block >= NTAG_MEM_BLOCK_START_SRAM &&
+           block < (NTAG_MEM_BLOCK_START_SRAM + NTAG_MEM_SRAM_BLOCKS);
+}
+
+/*!
+ * @brief This internal API checks whether the tag is still programming EEPROM.
+ */
+static bool eeprom_busy(const nt3h_sim_shard_t *shard, const nt3h_sim_tag_t *tag)
+{
+    return shard->now_ns < tag->busy_until_ns;
+}
+
+/*!
+ * @brief This internal API lets an EEPROM access through once no program is in progress.
+ */
+static bool eeprom_wait(nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag)
+{
+    if (!eeprom_busy(shard, tag))
+        return true;
+
+    if ((tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS][NTAG_MEM_OFFSET_I2C_CLOCK_STR] &
+         NTAG_I2C_CLOCK_STR_MASK_ON_OFF) == 0)
+        return false;
+
+    uint64_t held_ns = tag->busy_until_ns - shard->now_ns;
+
+    shard->bus_ns     += held_ns;
+    shard->stretch_ns += held_ns;
+    advance(shard, held_ns);
+
+    return true;
+}
+
+/*!
+ * @brief This internal API stores a written block.
+ */
+static void program(nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag, uint8_t block, const uint8_t *data)
+{
+    uint8_t *dst = tag->mem->blocks[block];
+
+    if (block_sram(block))
+    {
+        memcpy(dst, data, NTAG_I2C_BLOCK_SIZE);
+        return;
+    }
+
+    /* Serial number bytes of block 0 are read-only */
+    if (block == 0)
+        memcpy(&dst[SIM_SERIAL_LEN], &data[SIM_SERIAL_LEN], NTAG_I2C_BLOCK_SIZE - SIM_SERIAL_LEN);
+    else
+        memcpy(dst, data, NTAG_I2C_BLOCK_SIZE);
+
+    uint32_t eeprom_us = (shard->eeprom_us != 0) ? shard->eeprom_us : NT3H_EEPROM_WRITE_US;
+
+    tag->busy_until_ns = shard->now_ns + (uint64_t)eeprom_us * 1000U;
+    tag->programs++;
+}
+
+/*!
+ * @brief This internal API returns the current value of a session register.
+ */
+static uint8_t session_read(const nt3h_sim_shard_t *shard, const nt3h_sim_tag_t *tag, uint8_t reg)
+{
+    uint8_t value = tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS][reg];
+
+    if (reg == NTAG_MEM_OFFSET_NS_REG && eeprom_busy(shard, tag))
+        value |= NTAG_NS_REG_MASK_EEPROM_WR_BUSY;
+
+    return value;
+}
+
+/*!
+ * @brief This internal API applies a masked write to a session register.
+ */
+static void session_write(const nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tag, uint8_t reg, uint8_t mask,
+                          uint8_t data)
+{
+    uint8_t *value = &tag->mem->blocks[NTAG_MEM_BLOCK_SESSION_REGS][reg];
+
+    /* I2C_CLOCK_STR only loads from the configuration at power-on */
+    if (reg == NTAG_MEM_OFFSET_I2C_CLOCK_STR)
+        mask = 0;
+
+    if (reg == NTAG_MEM_OFFSET_NS_REG)
+    {
+        mask &= SIM_NS_REG_WRITABLE;
+
+        /* RF holds the memory, I2C_LOCKED cannot be taken */
+        if ((*value & NTAG_NS_REG_MASK_RF_LOCKED) != 0)
+            mask &= (uint8_t)~NTAG_NS_REG_MASK_I2C_LOCKED;
+
+        /* Taking I2C_LOCKED explicitly starts the watchdog */
+        if ((mask & data & ~*value & NTAG_NS_REG_MASK_I2C_LOCKED) != 0)
+            tag->wdt_until_ns = shard->now_ns + wdt_ns(tag);
+    }
+
+    *value = (uint8_t)((*value & ~mask) | (data & mask));
+}
+
+/*!
+ * @brief This internal API returns the configuration block of the tag.
+ */
+static uint8_t config_block(const nt3h_sim_tag_t *tag)
+{
+    return tag->is_2k ? NTAG_MEM_BLOCK_CONFIGURATION_2k : NTAG_MEM_BLOCK_CONFIGURATION_1k;
+}
@@ -0,0 +1,333 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_sim.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_sim.h
+ * @brief Host simulator of NT3H2111/2211 tags for fleet-scale testing.
+ *
+ * Each simulated tag has its own memory image and virtual timing: block
+ * writes to EEPROM keep the tag busy for the program time, during which
+ * NS_REG reports EEPROM_WR_BUSY and EEPROM accesses are NAKed or, with
+ * I2C_CLOCK_STR set at power-on, held by stretching SCL until the program
+ * completes, exactly as the driver sees on real hardware. Bus transactions and delays advance a
+ * virtual clock instead of sleeping, so simulated waits cost no wall time.
+ *
+ * The clock is discrete-event: scripted RF activity (field on/off, RF
+ * memory lock, RF reads and writes) is queued per shard and dispatched in
+ * time order whenever the clock moves, whether through a bus transaction,
+ * a delay or a yield callback. Memory arbitration follows the tag: an I2C
+ * memory access sets I2C_LOCKED until released or the watchdog expires,
+ * RF access is refused while it is set, and I2C memory access is NAKed
+ * while RF_LOCKED is set. RF writes to EEPROM program like I2C writes and
+ * are refused while a program is in progress. In pass-through mode the SRAM_I2C_READY and
+ * SRAM_RF_READY flags follow writes and reads of the last SRAM block.
+ *
+ * Bytes 1 to 6 of block 0 are the read-only serial number and byte 0 reads
+ * back as the manufacturer ID. Writing byte 0 with anything other than the
+ * tag's address, NT3H_SIM_I2C_ADDR, moves the tag to that address: it no
+ * longer answers on its dev_id, and the bus callbacks fail with
+ * NT3H_E_DEV_NOT_FOUND until the tag is initialised again. The move is
+ * kept in the memory image like the EEPROM it models.
+ *
+ * Tags are grouped into shards of up to NT3H_SIM_MAX_TAGS, addressed by the
+ * dev_id passed to the bus callbacks. A shard is owned by one thread, which
+ * binds it with nt3h_sim_bind() before driving its devices; shards share no
+ * state, so any number of threads run without locks. A thread may own
+ * several shards and rebind between them.
+ *
+ * Usage:
+ *   nt3h_sim_tag_init(&tags[i], &mems[i], false, serial);   for each tag
+ *   nt3h_sim_shard_init(&shard, tags, n_tags);
+ *   nt3h_sim_bind(&shard);
+ *   nt3h_sim_dev_init(&dev, i);
+ *   nt3h_write_bytes(&dev, ...);
+ */
+
+#ifndef _NT3H_SIM_H_
+#define _NT3H_SIM_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "nt3h.h"
+
+/* Blocks of the I2C address space, session registers are held in block 0xFE */
+#define NT3H_SIM_BLOCKS             256
+
+/* Block holding simulator metadata, not addressable over I2C */
+#define NT3H_SIM_META_BLOCK         0xFF
+#define NT3H_SIM_META_OFFSET_FLAGS  0
+#define NT3H_SIM_META_FLAG_2K       0x01
+#define NT3H_SIM_META_FLAG_MOVED    0x02    /* I2C address changed, tag unreachable */
+#define NT3H_SIM_META_OFFSET_ADDR   1       /* Address written, if moved */
+
+/* I2C address of every tag as held in block 0 byte 0, i.e. 0x55 shifted left by 1 */
+#define NT3H_SIM_I2C_ADDR           0xAA
+
+/* Tags per shard, limited by the 8-bit dev_id of the bus callbacks */
+#define NT3H_SIM_MAX_TAGS           256
+
+/* Default time per bus byte, 9 clocks at 400 kHz */
+#define NT3H_SIM_DEFAULT_BYTE_NS    22500U
+
+/* Default clock advance of a yield with no event due sooner */
+#define NT3H_SIM_DEFAULT_YIELD_NS   10000U
+
+/*
+ * @brief Memory image of one tag, as seen from I2C.
+ */
+typedef struct {
+    uint8_t blocks[NT3H_SIM_BLOCKS][NTAG_I2C_BLOCK_SIZE];
+} nt3h_sim_mem_t;
+
+/*
+ * @brief Simulated event types.
+ */
+typedef enum {
+    NT3H_SIM_EVT_FIELD_ON,      /* RF field appears */
+    NT3H_SIM_EVT_FIELD_OFF,     /* RF field disappears, releasing RF_LOCKED */
+    NT3H_SIM_EVT_RF_LOCK,       /* RF side takes the memory */
+    NT3H_SIM_EVT_RF_UNLOCK,     /* RF side releases the memory */
+    NT3H_SIM_EVT_RF_WRITE,      /* RF writes data to block */
+    NT3H_SIM_EVT_RF_READ,       /* RF reads block */
+    NT3H_SIM_EVT_CALL           /* func(dev_id, ctx) is called */
+} nt3h_sim_evt_type_t;
+
+typedef void (*nt3h_sim_event_func_ptr_t)(uint8_t dev_id, void *ctx);
+
+/*
+ * @brief Scheduled event.
+ */
+typedef struct {
+
+    /* Virtual time and order of scheduling, set by nt3h_sim_schedule() */
+    uint64_t at_ns;
+    uint32_t seq;
+
+    nt3h_sim_evt_type_t type;
+    uint8_t dev_id;
+
+    /* Block and data of RF_WRITE and RF_READ */
+    uint8_t block;
+    uint8_t data[NTAG_I2C_BLOCK_SIZE];
+
+    /* Handler of CALL */
+    nt3h_sim_event_func_ptr_t func;
+    void *ctx;
+
+} nt3h_sim_event_t;
+
+/*
+ * @brief Simulated tag state.
+ */
+typedef struct {
+
+    /* Memory image, user allocated */
+    nt3h_sim_mem_t *mem;
+
+    /* 2K part (user memory to block 0x77, config at 0x7A) */
+    bool is_2k;
+
+    /* Block and session register latched by the last address write */
+    uint8_t block;
+    uint8_t reg;
+
+    /* Last address write selected a session register */
+    bool reg_access;
+
+    /* Virtual time at which the current EEPROM program completes */
+    uint64_t busy_until_ns;
+
+    /* Virtual time at which the watchdog releases I2C_LOCKED */
+    uint64_t wdt_until_ns;
+
+    /* Statistics */
+    uint32_t programs;
+    uint32_t naks;
+    uint32_t rf_denied;
+    uint32_t addr_changes;
+
+} nt3h_sim_tag_t;
+
+/*
+ * @brief Group of tags driven by one thread.
+ */
+typedef struct {
+
+    /* User allocated tags, indexed by dev_id */
+    nt3h_sim_tag_t *tags;
+    size_t n_tags;
+
+    /* Virtual clock */
+    uint64_t now_ns;
+
+    /* Bus byte, EEPROM program and yield times, 0 for the defaults */
+    uint32_t byte_ns;
+    uint32_t eeprom_us;
+    uint32_t yield_ns;
+
+    /* User allocated event queue, a binary heap ordered by time */
+    nt3h_sim_event_t *events;
+    size_t max_events;
+    size_t n_events;
+    uint32_t seq;
+
+    /* Statistics */
+    uint64_t transactions;
+    uint64_t naks;
+    uint64_t dispatched;
+
+    /* Bus occupancy, of which clock stretching */
+    uint64_t bus_ns;
+    uint64_t stretch_ns;
+
+} nt3h_sim_shard_t;
+
+/*!
+ * @brief This API formats a tag to its factory state and powers it on.
+ *
+ * @param[out]   tag : Pointer to tag structure.
+ * @param[in]    mem : Memory image for the tag.
+ * @param[in]  is_2k : Simulate a 2K part.
+ * @param[in] serial : Serial number, the low 48 bits are used.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_tag_init(nt3h_sim_tag_t *tag, nt3h_sim_mem_t *mem, bool is_2k, uint64_t serial);
+
+/*!
+ * @brief This API power cycles a tag.
+ *
+ * @note Session registers are reloaded from the configuration block and
+ *       SRAM is cleared. A program in progress is completed.
+ *
+ * @param[in] tag : Pointer to tag structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_tag_reset(nt3h_sim_tag_t *tag);
+
+/*!
+ * @brief This API initialises a shard over a set of tags.
+ *
+ * @param[out]  shard : Pointer to shard structure.
+ * @param[in]    tags : Initialised tags, indexed by dev_id.
+ * @param[in]  n_tags : Number of tags, at most NT3H_SIM_MAX_TAGS.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_shard_init(nt3h_sim_shard_t *shard, nt3h_sim_tag_t *tags, size_t n_tags);
+
+/*!
+ * @brief This API gives a shard storage for scheduled events.
+ *
+ * @param[in,out] shard : Pointer to shard structure.
+ * @param[in]    events : Event storage.
+ * @param[in] max_events : Number of events that can be pending at once.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_queue_init(nt3h_sim_shard_t *shard, nt3h_sim_event_t *events, size_t max_events);
+
+/*!
+ * @brief This API schedules an event.
+ *
+ * @note Events due at the same time are dispatched in the order scheduled.
+ *
+ * @param[in,out] shard : Pointer to shard structure.
+ * @param[in]  after_us : Delay from the current virtual time.
+ * @param[in]       evt : Event, at_ns and seq are filled in.
+ *
+ * @return API status code, NT3H_E_NO_SPACE if the queue is full.
+ */
+nt3h_status_t nt3h_sim_schedule(nt3h_sim_shard_t *shard, uint32_t after_us, const nt3h_sim_event_t *evt);
+
+/*!
+ * @brief This API advances the virtual clock, dispatching events that fall due.
+ *
+ * @param[in,out] shard : Pointer to shard structure.
+ * @param[in]  period_us : Time to advance.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_advance_us(nt3h_sim_shard_t *shard, uint32_t period_us);
+
+/*!
+ * @brief This API advances the virtual clock until no events are pending.
+ *
+ * @param[in,out] shard : Pointer to shard structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_run(nt3h_sim_shard_t *shard);
+
+/*!
+ * @brief This API binds a shard to the calling thread.
+ *
+ * @note Bus and delay callbacks made on this thread act on the bound shard.
+ *
+ * @param[in] shard : Pointer to shard structure, NULL to unbind.
+ */
+void nt3h_sim_bind(nt3h_sim_shard_t *shard);
+
+/*!
+ * @brief This API returns the shard bound to the calling thread.
+ *
+ * @return Pointer to shard structure, NULL if none is bound.
+ */
+nt3h_sim_shard_t *nt3h_sim_current(void);
+
+/*!
+ * @brief This API points the callbacks of a device at a simulated tag.
+ *
+ * @note Only dev_id, i2c_addr and the callbacks are set, other fields are
+ *       untouched. The driver prefers delay_us; clear it to exercise yield waits.
+ *
+ * @param[in,out] dev : Pointer to device structure.
+ * @param[in]  dev_id : Index of the tag within the shard.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_dev_init(nt3h_dev_t *dev, uint8_t dev_id);
+
+/*!
+ * @brief Bus and timing callbacks, acting on the shard bound to the calling thread.
+ */
+nt3h_status_t nt3h_sim_write(uint8_t dev_id, uint8_t *data, size_t len);
+nt3h_status_t nt3h_sim_read(uint8_t dev_id, uint8_t *data, size_t len);
+void nt3h_sim_delay_ms(uint32_t period_ms);
+void nt3h_sim_delay_us(uint32_t period_us);
+void nt3h_sim_yield(void);
+uint32_t nt3h_sim_time_us(void);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* NT3H_SIM_H_ */
@@ -0,0 +1,323 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_sim_bench.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_sim_bench.c
+ * @brief Fleet benchmark of the driver against simulated tags.
+ *
+ * Measures aggregate driver operations per second as the number of tags
+ * and threads grows. Each thread owns its tags in private shards, so the
+ * only shared state is the start barrier. Every operation is a
+ * nt3h_write_bytes() or nt3h_read_bytes() of 8 bytes; EEPROM program time
+ * elapses on the virtual clock and costs no wall time.
+ *
+ * A second table shows the effect of I2C clock stretching on a block read
+ * issued while the tag is still programming EEPROM: the read latency and
+ * the share of that time the bus is held, in virtual time. With stretching
+ * the tag holds SCL until the program completes; without it the read is
+ * NAKed and retried, leaving the bus free for other devices in between.
+ *
+ * Build on a POSIX host:
+ *   cc -O2 -pthread nt3h_sim_bench.c nt3h_sim.c nt3h.c -o nt3h_sim_bench
+ *   ./nt3h_sim_bench [max_tags] [max_threads] [ops_per_tag]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nt3h_sim.h"
+
+#define BENCH_DEFAULT_MAX_TAGS      4096
+#define BENCH_DEFAULT_MAX_THREADS   8
+#define BENCH_DEFAULT_OPS           64
+#define BENCH_OP_LEN                8
+#define BENCH_BLOCKS                32
+#define BENCH_STRETCH_READS         100
+
+/*
+ * @brief Per-thread benchmark state.
+ *
+ * Workers sit next to each other in an array, so results are counted in
+ * locals and stored once at the end rather than updated per operation.
+ */
+typedef struct {
+    pthread_barrier_t *start;
+    size_t n_tags;
+    uint32_t ops;
+    uint32_t seed;
+
+    /* Results */
+    uint64_t done;
+    uint64_t errors;
+    uint64_t virtual_ns;
+    uint64_t start_ns;
+    uint64_t end_ns;
+} bench_worker_t;
+
+/*!
+ * @brief This internal API returns the monotonic wall clock in nanoseconds.
+ */
+static uint64_t wall_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/*!
+ * @brief This internal API runs one thread of the benchmark.
+ */
+static void *bench_worker(void *arg)
+{
+    bench_worker_t *w = arg;
+    size_t n_shards = (w->n_tags + NT3H_SIM_MAX_TAGS - 1) / NT3H_SIM_MAX_TAGS;
+    uint64_t done = 0;
+    uint64_t errors = 0;
+
+    /* Allocated by the worker so memory is local to the thread */
+    nt3h_sim_mem_t *mems     = calloc(w->n_tags, sizeof(*mems));
+    nt3h_sim_tag_t *tags     = calloc(w->n_tags, sizeof(*tags));
+    nt3h_dev_t *devs         = calloc(w->n_tags, sizeof(*devs));
+    nt3h_sim_shard_t *shards = calloc(n_shards, sizeof(*shards));
+
+    if (mems != NULL && tags != NULL && devs != NULL && shards != NULL)
+    {
+        for (size_t i = 0; i < w->n_tags; i++)
+        {
+            nt3h_sim_tag_init(&tags[i], &mems[i], false, ((uint64_t)w->seed << 24) | i);
+            nt3h_sim_dev_init(&devs[i], (uint8_t)(i % NT3H_SIM_MAX_TAGS));
+        }
+
+        for (size_t s = 0; s < n_shards; s++)
+        {
+            size_t first = s * NT3H_SIM_MAX_TAGS;
+            size_t n     = w->n_tags - first;
+
+            nt3h_sim_shard_init(&shards[s], &tags[first], (n < NT3H_SIM_MAX_TAGS) ? n : NT3H_SIM_MAX_TAGS);
+        }
+    }
+    else
+    {
+        errors++;
+    }
+
+    pthread_barrier_wait(w->start);
+    uint64_t start_ns = wall_ns();
+
+    for (uint32_t op = 0; op < w->ops && errors == 0; op++)
+    {
+        uint8_t buf[BENCH_OP_LEN];
+        uint16_t block = (uint16_t)(NTAG_MEM_BLOCK_START_USER_MEMORY + (op / 2U) % BENCH_BLOCKS);
+
+        for (size_t s = 0; s < n_shards; s++)
+        {
+            nt3h_sim_bind(&shards[s]);
+
+            for (size_t i = 0; i < shards[s].n_tags; i++)
+            {
+                nt3h_dev_t *dev = &devs[s * NT3H_SIM_MAX_TAGS + i];
+                nt3h_status_t rslt;
+
+                if ((op & 1U) == 0)
+                {
+                    memset(buf, (int)op, sizeof(buf));
+                    rslt = nt3h_write_bytes(dev, block, 0, buf, sizeof(buf));
+                }
+                else
+                {
+                    rslt = nt3h_read_bytes(dev, block, 0, buf, sizeof(buf));
+                }
+
+                if (rslt != NT3H_OK)
+                    errors++;
+
+                done++;
+            }
+        }
+    }
+
+    w->end_ns   = wall_ns();
+    w->start_ns = start_ns;
+    w->done     = done;
+    w->errors   = errors;
+
+    for (size_t s = 0; s < n_shards && shards != NULL; s++)
+        if (shards[s].now_ns > w->virtual_ns)
+            w->virtual_ns = shards[s].now_ns;
+
+    nt3h_sim_bind(NULL);
+    free(shards);
+    free(devs);
+    free(tags);
+    free(mems);
+
+    return NULL;
+}
+
+/*!
+ * @brief This internal API runs the benchmark for one tag and thread count.
+ */
+static int bench_run(size_t n_tags, unsigned n_threads, uint32_t ops)
+{
+    pthread_t threads[64];
+    bench_worker_t workers[64];
+    pthread_barrier_t start;
+
+    if (n_threads > 64 || pthread_barrier_init(&start, NULL, n_threads) != 0)
+        return -1;
+
+    for (unsigned t = 0; t < n_threads; t++)
+    {
+        memset(&workers[t], 0, sizeof(workers[t]));
+        workers[t].start  = &start;
+        workers[t].n_tags = n_tags / n_threads + ((t < n_tags % n_threads) ? 1U : 0U);
+        workers[t].ops    = ops;
+        workers[t].seed   = t + 1U;
+
+        if (pthread_create(&threads[t], NULL, bench_worker, &workers[t]) != 0)
+            return -1;
+    }
+
+    uint64_t done = 0, errors = 0, virtual_ns = 0;
+    uint64_t first_ns = UINT64_MAX, last_ns = 0;
+
+    for (unsigned t = 0; t < n_threads; t++)
+    {
+        pthread_join(threads[t], NULL);
+
+        done   += workers[t].done;
+        errors += workers[t].errors;
+        if (workers[t].virtual_ns > virtual_ns)
+            virtual_ns = workers[t].virtual_ns;
+        if (workers[t].start_ns < first_ns)
+            first_ns = workers[t].start_ns;
+        if (workers[t].end_ns > last_ns)
+            last_ns = workers[t].end_ns;
+    }
+
+    pthread_barrier_destroy(&start);
+
+    double wall_s = (double)(last_ns - first_ns) / 1e9;
+
+    printf("%8zu %8u %12llu %10.1f %14.0f %12.1f %8llu\n", n_tags, n_threads, (unsigned long long)done,
+           wall_s * 1e3, (wall_s > 0) ? (double)done / wall_s : 0.0, (double)virtual_ns / 1e9,
+           (unsigned long long)errors);
+
+    return (errors == 0) ? 0 : -1;
+}
+
+/*!
+ * @brief This internal API measures block reads racing an EEPROM program.
+ */
+static int bench_stretch(bool enable)
+{
+    static nt3h_sim_mem_t mem;
+    nt3h_sim_tag_t tag;
+    nt3h_sim_shard_t shard;
+    nt3h_dev_t dev;
+    uint8_t block[NTAG_I2C_BLOCK_SIZE];
+    uint64_t latency_ns = 0, bus_ns = 0;
+    nt3h_status_t rslt;
+
+    memset(&dev, 0, sizeof(dev));
+    nt3h_sim_tag_init(&tag, &mem, false, 0);
+    nt3h_sim_shard_init(&shard, &tag, 1);
+    nt3h_sim_bind(&shard);
+    nt3h_sim_dev_init(&dev, 0);
+
+    /* Writes return straight after the program starts, reads retry NAKs every ms */
+    dev.retry.mode        = NT3H_RETRY_FIXED;
+    dev.retry.delay_ms    = 1;
+    dev.retry.max_retries = 10;
+    dev.retry.ack_polling = true;
+
+    /* I2C_CLOCK_STR takes effect from the next power-on */
+    if ((rslt = nt3h_set_clock_stretch(&dev, NT3H_REG_CONFIG, enable)) != NT3H_OK)
+        return -1;
+
+    nt3h_sim_delay_us(NT3H_EEPROM_WRITE_US);
+    nt3h_sim_tag_reset(&tag);
+
+    memset(block, 0xA5, sizeof(block));
+
+    for (uint32_t i = 0; i < BENCH_STRETCH_READS && rslt == NT3H_OK; i++)
+    {
+        if ((rslt = nt3h_write_blocks(&dev, 1, block, 1)) != NT3H_OK)
+            break;
+
+        uint64_t start_ns = shard.now_ns;
+        uint64_t start_bus_ns = shard.bus_ns;
+
+        rslt = nt3h_read_blocks(&dev, 2, block, 1);
+
+        latency_ns += shard.now_ns - start_ns;
+        bus_ns     += shard.bus_ns - start_bus_ns;
+
+        /* Let the program finish before the next round */
+        nt3h_sim_delay_us(NT3H_EEPROM_WRITE_US);
+    }
+
+    nt3h_sim_bind(NULL);
+
+    printf("%10s %12.1f %12.1f %8llu %8s\n", enable ? "on" : "off",
+           (double)latency_ns / BENCH_STRETCH_READS / 1e3,
+           (latency_ns > 0) ? 100.0 * (double)bus_ns / (double)latency_ns : 0.0,
+           (unsigned long long)shard.naks, (rslt == NT3H_OK) ? "ok" : "error");
+
+    return (rslt == NT3H_OK) ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_tags      = (argc > 1) ? strtoul(argv[1], NULL, 0) : BENCH_DEFAULT_MAX_TAGS;
+    unsigned max_threads = (argc > 2) ? (unsigned)strtoul(argv[2], NULL, 0) : BENCH_DEFAULT_MAX_THREADS;
+    uint32_t ops         = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : BENCH_DEFAULT_OPS;
+    int status = 0;
+
+    if (max_threads == 0 || max_threads > 64)
+        max_threads = BENCH_DEFAULT_MAX_THREADS;
+
+    printf("%8s %8s %12s %10s %14s %12s %8s\n", "tags", "threads", "ops", "wall_ms", "ops/s", "virtual_s", "errors");
+
+    for (size_t n_tags = NT3H_SIM_MAX_TAGS; n_tags <= max_tags; n_tags *= 4)
+        for (unsigned n_threads = 1; n_threads <= max_threads && n_threads <= n_tags; n_threads *= 2)
+            if (bench_run(n_tags, n_threads, ops) != 0)
+                status = 1;
+
+    printf("\n%10s %12s %12s %8s %8s\n", "clock_str", "read_us", "bus_busy_%", "naks", "status");
+
+    if (bench_stretch(true) != 0 || bench_stretch(false) != 0)
+        status = 1;
+
+    return status;
+}
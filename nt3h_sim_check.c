@@ -0,0 +1,514 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_sim_check.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_sim_check.c
+ * @brief Power loss checks of the driver's recovery paths against a simulated tag.
+ *
+ * Each check runs a scripted workload on a fresh tag and cuts power once
+ * a given number of EEPROM programs have started, for every count from 0
+ * until the workload completes uncut. After the cut the bus is dead, so
+ * the driver call in progress fails. The tag is then power cycled, which
+ * completes the last program, and the module's recovery path runs against
+ * what reached EEPROM:
+ *
+ *   datalog   nt3h_datalog_recover() finds the newest programmed block
+ *   kv        nt3h_kv_mount() restores every key, the interrupted one old or new
+ *   journal   nt3h_journal_recover() leaves all or none of a commit home
+ *   remap     a restored remap table reads the last or the interrupted write
+ *   provision re-running nt3h_provision() completes the image
+ *   address   writing block 0 with another I2C address moves the tag
+ *
+ * Build on a host:
+ *   cc -O2 nt3h_sim_check.c nt3h_sim.c nt3h.c nt3h_datalog.c nt3h_kv.c nt3h_journal.c \
+ *      nt3h_provision.c -o nt3h_sim_check
+ *   ./nt3h_sim_check
+ */
+#include <stdio.h>
+#include <string.h>
+#include "nt3h_sim.h"
+#include "nt3h_datalog.h"
+#include "nt3h_kv.h"
+#include "nt3h_journal.h"
+#include "nt3h_provision.h"
+
+#define CHECK_MAX_CUTS          512
+#define CHECK_NO_CUT            UINT32_MAX
+
+#define DATALOG_FIRST_BLOCK     4
+#define DATALOG_BLOCKS          8
+#define DATALOG_RECORD_SIZE     4
+#define DATALOG_RECORDS         60
+#define DATALOG_FLUSH_EVERY     7
+
+#define KV_FIRST_BLOCK          4
+#define KV_BLOCKS               12
+#define KV_KEYS                 6
+#define KV_OPS                  40
+
+#define JOURNAL_HOME_BLOCK      4
+#define JOURNAL_BLOCKS          4
+#define JOURNAL_MARKER_BLOCK    40
+#define JOURNAL_ROUNDS          3
+
+#define REMAP_BLOCK             5
+#define REMAP_INTERVAL          2
+#define REMAP_WRITES            12
+
+#define PROV_USER_BLOCK         4
+#define PROV_USER_BLOCKS        8
+
+typedef bool (*check_func_ptr_t)(nt3h_dev_t *dev, uint32_t cut_at);
+
+static nt3h_sim_mem_t mem;
+static nt3h_sim_tag_t tag;
+static nt3h_sim_shard_t shard;
+
+/* Power cut state: programs started since arming, and the count to cut after */
+static uint32_t programs;
+static uint32_t cut_after;
+static bool cut_off;
+static bool cut_hit;
+
+/* Ring blocks as last programmed, the datalog reference model */
+static uint8_t datalog_image[DATALOG_BLOCKS][NTAG_I2C_BLOCK_SIZE];
+
+/*!
+ * @brief This internal API forwards a bus write unless power has been cut.
+ */
+static nt3h_status_t cut_write(uint8_t dev_id, uint8_t *data, size_t len)
+{
+    if (cut_off)
+        return NT3H_E_DEV_NOT_FOUND;
+
+    nt3h_status_t rslt = nt3h_sim_write(dev_id, data, len);
+
+    if (rslt != NT3H_OK || len != 1 + NTAG_I2C_BLOCK_SIZE)
+        return rslt;
+
+    if (data[0] >= DATALOG_FIRST_BLOCK && data[0] < DATALOG_FIRST_BLOCK + DATALOG_BLOCKS)
+        memcpy(datalog_image[data[0] - DATALOG_FIRST_BLOCK], &data[1], NTAG_I2C_BLOCK_SIZE);
+
+    /* The program has started and completes on its own, power goes right after */
+    if (++programs == cut_after)
+        cut_off = cut_hit = true;
+
+    return rslt;
+}
+
+/*!
+ * @brief This internal API forwards a bus read unless power has been cut.
+ */
+static nt3h_status_t cut_read(uint8_t dev_id, uint8_t *data, size_t len)
+{
+    if (cut_off)
+        return NT3H_E_DEV_NOT_FOUND;
+
+    return nt3h_sim_read(dev_id, data, len);
+}
+
+/*!
+ * @brief This internal API starts a check run on a factory-fresh tag.
+ */
+static void fresh(nt3h_dev_t *dev)
+{
+    nt3h_sim_tag_init(&tag, &mem, false, 0x0102030405ULL);
+    nt3h_sim_shard_init(&shard, &tag, 1);
+    nt3h_sim_bind(&shard);
+
+    memset(dev, 0, sizeof(*dev));
+    nt3h_sim_dev_init(dev, 0);
+    dev->write = cut_write;
+    dev->read  = cut_read;
+
+    memset(datalog_image, 0, sizeof(datalog_image));
+    programs  = 0;
+    cut_after = CHECK_NO_CUT;
+    cut_off   = false;
+    cut_hit   = false;
+}
+
+/*!
+ * @brief This internal API cuts power once cut_at more programs have started.
+ */
+static void arm(uint32_t cut_at)
+{
+    programs  = 0;
+    cut_after = cut_at;
+    cut_off   = cut_hit = (cut_at == 0);
+}
+
+/*!
+ * @brief This internal API restores power, completing any program in progress.
+ */
+static void power_cycle(void)
+{
+    nt3h_sim_tag_reset(&tag);
+    cut_after = CHECK_NO_CUT;
+    cut_off   = false;
+}
+
+/*!
+ * @brief This internal API returns the next value of a fixed pseudo-random sequence.
+ */
+static uint32_t next_random(uint32_t *state)
+{
+    *state = *state * 1103515245U + 12345U;
+
+    return *state >> 16;
+}
+
+/*!
+ * @brief This internal API checks data logger recovery.
+ */
+static bool check_datalog(nt3h_dev_t *dev, uint32_t cut_at)
+{
+    nt3h_datalog_t log;
+    uint8_t capacity = (NT3H_DATALOG_PAYLOAD_LEN / DATALOG_RECORD_SIZE) * DATALOG_RECORD_SIZE;
+
+    if (nt3h_datalog_init(&log, dev, false, DATALOG_FIRST_BLOCK, DATALOG_BLOCKS, DATALOG_RECORD_SIZE) != NT3H_OK ||
+        nt3h_datalog_format(&log) != NT3H_OK)
+        return false;
+
+    arm(cut_at);
+
+    for (uint32_t i = 0; i < DATALOG_RECORDS; i++)
+    {
+        uint8_t record[DATALOG_RECORD_SIZE];
+
+        memset(record, (int)i, sizeof(record));
+
+        if (nt3h_datalog_append(&log, record) != NT3H_OK ||
+            ((i + 1) % DATALOG_FLUSH_EVERY == 0 && nt3h_datalog_flush(&log) != NT3H_OK))
+            break;
+    }
+
+    power_cycle();
+
+    /* Expected state from the blocks that were programmed */
+    uint32_t seq = 0;
+    uint8_t used = 0, newest = 0;
+
+    for (uint8_t i = 0; i < DATALOG_BLOCKS; i++)
+    {
+        const uint8_t *b = datalog_image[i];
+        uint32_t hdr = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+
+        if ((hdr >> 4) > seq)
+        {
+            seq    = hdr >> 4;
+            used   = (uint8_t)(hdr & 0x0FU);
+            newest = i;
+        }
+    }
+
+    if (nt3h_datalog_init(&log, dev, false, DATALOG_FIRST_BLOCK, DATALOG_BLOCKS, DATALOG_RECORD_SIZE) != NT3H_OK ||
+        nt3h_datalog_recover(&log) != NT3H_OK)
+        return false;
+
+    if (seq == 0)
+        return log.head == 0 && log.seq == 1 && log.used == 0;
+
+    if (used < capacity)
+        return log.head == newest && log.seq == seq && log.used == used &&
+               memcmp(log.pending, &datalog_image[newest][NT3H_DATALOG_HDR_LEN], used) == 0;
+
+    return log.head == (newest + 1) % DATALOG_BLOCKS && log.seq == seq + 1 && log.used == 0;
+}
+
+/*!
+ * @brief This internal API checks key-value store mounting.
+ */
+static bool check_kv(nt3h_dev_t *dev, uint32_t cut_at)
+{
+    nt3h_kv_t kv;
+    nt3h_kv_slot_t slots[KV_KEYS];
+    uint8_t ref[KV_KEYS + 1][NT3H_KV_VALUE_MAX], ref_len[KV_KEYS + 1];
+    uint8_t value[NT3H_KV_VALUE_MAX], len = 0;
+    uint8_t key = 0;
+    bool deleting = false;
+    uint32_t state = 1;
+
+    /* Absent keys have an out of range length */
+    memset(ref_len, 0xFF, sizeof(ref_len));
+
+    if (nt3h_kv_init(&kv, dev, false, KV_FIRST_BLOCK, KV_BLOCKS, slots, KV_KEYS) != NT3H_OK ||
+        nt3h_kv_format(&kv) != NT3H_OK)
+        return false;
+
+    arm(cut_at);
+
+    for (uint32_t op = 0; op < KV_OPS; op++)
+    {
+        nt3h_status_t rslt;
+
+        key      = (uint8_t)(1 + next_random(&state) % KV_KEYS);
+        deleting = (next_random(&state) % 4 == 0) && ref_len[key] != 0xFF;
+        len      = (uint8_t)(next_random(&state) % (NT3H_KV_VALUE_MAX + 1));
+        memset(value, (int)op, sizeof(value));
+
+        rslt = deleting ? nt3h_kv_delete(&kv, key) : nt3h_kv_set(&kv, key, value, len);
+
+        if (rslt != NT3H_OK)
+            break;
+
+        if (deleting)
+        {
+            ref_len[key] = 0xFF;
+        }
+        else
+        {
+            memcpy(ref[key], value, len);
+            ref_len[key] = len;
+        }
+
+        key = 0;
+    }
+
+    power_cycle();
+
+    if (nt3h_kv_init(&kv, dev, false, KV_FIRST_BLOCK, KV_BLOCKS, slots, KV_KEYS) != NT3H_OK ||
+        nt3h_kv_mount(&kv) != NT3H_OK)
+        return false;
+
+    for (uint8_t k = 1; k <= KV_KEYS; k++)
+    {
+        uint8_t got[NT3H_KV_VALUE_MAX], got_len;
+        nt3h_status_t rslt = nt3h_kv_get(&kv, k, got, &got_len);
+        bool old_ok = (ref_len[k] == 0xFF) ? rslt == NT3H_E_NOT_FOUND
+                                           : rslt == NT3H_OK && got_len == ref_len[k] &&
+                                             memcmp(got, ref[k], got_len) == 0;
+
+        /* The interrupted update may or may not have landed */
+        bool new_ok = (k == key) && (deleting ? rslt == NT3H_E_NOT_FOUND
+                                              : rslt == NT3H_OK && got_len == len && memcmp(got, value, len) == 0);
+
+        if (!old_ok && !new_ok)
+            return false;
+    }
+
+    return true;
+}
+
+/*!
+ * @brief This internal API checks atomic journal commits.
+ */
+static bool check_journal(nt3h_dev_t *dev, uint32_t cut_at)
+{
+    nt3h_journal_t jnl;
+    nt3h_journal_entry_t entries[JOURNAL_BLOCKS];
+    uint8_t block[JOURNAL_BLOCKS * NTAG_I2C_BLOCK_SIZE];
+    uint8_t done = 0, round;
+
+    if (nt3h_journal_init(&jnl, dev, false, entries, JOURNAL_BLOCKS, JOURNAL_MARKER_BLOCK) != NT3H_OK)
+        return false;
+
+    arm(cut_at);
+
+    for (round = 1; round <= JOURNAL_ROUNDS; round++)
+    {
+        memset(block, round, sizeof(block));
+
+        if (nt3h_journal_write(&jnl, JOURNAL_HOME_BLOCK, 0, block, sizeof(block)) != NT3H_OK ||
+            nt3h_journal_commit(&jnl) != NT3H_OK)
+            break;
+
+        done = round;
+    }
+
+    power_cycle();
+
+    if (nt3h_journal_init(&jnl, dev, false, entries, JOURNAL_BLOCKS, JOURNAL_MARKER_BLOCK) != NT3H_OK ||
+        nt3h_journal_recover(&jnl, NULL) != NT3H_OK ||
+        nt3h_read_blocks(dev, JOURNAL_HOME_BLOCK, block, JOURNAL_BLOCKS) != NT3H_OK)
+        return false;
+
+    /* Every home block holds the last complete commit, or all of the interrupted one */
+    for (size_t i = 0; i < sizeof(block); i++)
+    {
+        if (block[i] != block[0])
+            return false;
+    }
+
+    return block[0] == done || (round <= JOURNAL_ROUNDS && block[0] == round);
+}
+
+/*!
+ * @brief This internal API persists a remap table, as an application would.
+ */
+static void remap_save(void *ctx, const nt3h_remap_entry_t *entries, size_t n)
+{
+    memcpy(ctx, entries, n * sizeof(*entries));
+}
+
+/*!
+ * @brief This internal API checks a remapped block survives a power cut.
+ */
+static bool check_remap(nt3h_dev_t *dev, uint32_t cut_at)
+{
+    static const uint8_t spares[] = { 30, 31 };
+    nt3h_remap_t remap;
+    nt3h_remap_entry_t entries[1] = { { REMAP_BLOCK, 0, 0 } };
+    nt3h_remap_entry_t saved[1];
+    uint8_t block[NTAG_I2C_BLOCK_SIZE];
+    uint8_t done = 0, i;
+
+    if (nt3h_remap_init(&remap, false, entries, 1, spares, sizeof(spares), true) != NT3H_OK)
+        return false;
+
+    remap.interval = REMAP_INTERVAL;
+    remap.save     = remap_save;
+    remap.save_ctx = saved;
+    memcpy(saved, entries, sizeof(saved));
+    dev->remap = &remap;
+
+    arm(cut_at);
+
+    for (i = 1; i <= REMAP_WRITES; i++)
+    {
+        memset(block, i, sizeof(block));
+
+        if (nt3h_write_blocks(dev, REMAP_BLOCK, block, 1) != NT3H_OK)
+            break;
+
+        done = i;
+    }
+
+    power_cycle();
+
+    /* Start-up restores the saved table */
+    if (nt3h_remap_init(&remap, false, saved, 1, spares, sizeof(spares), false) != NT3H_OK ||
+        nt3h_read_blocks(dev, REMAP_BLOCK, block, 1) != NT3H_OK)
+        return false;
+
+    return block[0] == done || (i <= REMAP_WRITES && block[0] == i);
+}
+
+/*!
+ * @brief This internal API checks provisioning completes when re-run after a power cut.
+ */
+static bool check_provision(nt3h_dev_t *dev, uint32_t cut_at)
+{
+    static uint8_t user[PROV_USER_BLOCKS * NTAG_I2C_BLOCK_SIZE];
+    uint8_t block_0[NTAG_I2C_BLOCK_SIZE] = { 0 };
+    uint8_t readback[PROV_USER_BLOCKS * NTAG_I2C_BLOCK_SIZE];
+    nt3h_prov_segment_t segs[2];
+    nt3h_prov_image_t image = { segs, 2, false };
+    nt3h_prov_fixture_t fixture = { 0 };
+
+    for (size_t i = 0; i < sizeof(user); i++)
+        user[i] = (uint8_t)(i * 7U + 1U);
+
+    /* Capability container for a read-only NDEF tag */
+    block_0[12] = 0xE1;
+    block_0[13] = 0x10;
+    block_0[14] = NT3H_CC_MLEN_1K;
+    block_0[15] = 0x0F;
+
+    segs[0] = (nt3h_prov_segment_t){ 0, 1, block_0, NULL };
+    segs[1] = (nt3h_prov_segment_t){ PROV_USER_BLOCK, PROV_USER_BLOCKS, user, NULL };
+    fixture.dev = dev;
+
+    arm(cut_at);
+    nt3h_provision(&image, &fixture, 1, true);
+    power_cycle();
+
+    if (nt3h_provision(&image, &fixture, 1, true) != NT3H_OK ||
+        nt3h_read_blocks(dev, 0, block_0, 1) != NT3H_OK ||
+        nt3h_read_blocks(dev, PROV_USER_BLOCK, readback, PROV_USER_BLOCKS) != NT3H_OK)
+        return false;
+
+    /* The tag kept its address throughout */
+    return tag.addr_changes == 0 && block_0[15] == 0x0F && memcmp(readback, user, sizeof(user)) == 0;
+}
+
+/*!
+ * @brief This internal API checks writing another I2C address moves the tag.
+ */
+static bool check_address(nt3h_dev_t *dev, uint32_t cut_at)
+{
+    uint8_t block[NTAG_I2C_BLOCK_SIZE];
+
+    (void)cut_at;
+
+    if (nt3h_read_blocks(dev, 0, block, 1) != NT3H_OK)
+        return false;
+
+    /* Same address: the tag stays where it is */
+    block[0] = NT3H_SIM_I2C_ADDR;
+    if (nt3h_write_blocks(dev, 0, block, 1) != NT3H_OK || tag.addr_changes != 0)
+        return false;
+
+    /* Another address: the tag stops answering mid-write, so the result is not checked */
+    block[0] = NT3H_SIM_I2C_ADDR + 2U;
+    (void)nt3h_write_blocks(dev, 0, block, 1);
+
+    return tag.addr_changes == 1 && nt3h_read_blocks(dev, 0, block, 1) == NT3H_E_DEV_NOT_FOUND;
+}
+
+/*!
+ * @brief This internal API runs a check for every power cut point.
+ */
+static int check_run(const char *name, check_func_ptr_t func)
+{
+    nt3h_dev_t dev;
+    uint32_t cut_at;
+    bool ok = true;
+
+    for (cut_at = 0; cut_at < CHECK_MAX_CUTS && ok; cut_at++)
+    {
+        fresh(&dev);
+        ok = func(&dev, cut_at);
+
+        /* Workload completed before the cut, every point is covered */
+        if (!cut_hit)
+            break;
+    }
+
+    nt3h_sim_bind(NULL);
+
+    printf("%-10s %8u %8s\n", name, ok ? cut_at : cut_at - 1, ok ? "ok" : "FAIL");
+
+    return ok ? 0 : 1;
+}
+
+int main(void)
+{
+    int status = 0;
+
+    printf("%-10s %8s %8s\n", "check", "cuts", "status");
+
+    status |= check_run("datalog", check_datalog);
+    status |= check_run("kv", check_kv);
+    status |= check_run("journal", check_journal);
+    status |= check_run("remap", check_remap);
+    status |= check_run("provision", check_provision);
+    status |= check_run("address", check_address);
+
+    return status;
+}
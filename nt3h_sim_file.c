@@ -0,0 +1,225 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_sim_file.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_sim_file.c
+ * @brief Memory-mapped persistent images of simulated tags.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "nt3h_sim_file.h"
+#include "nt3h_util.h"
+
+#define HDR_OFFSET_VERSION  4
+#define HDR_OFFSET_PAGE     8
+#define HDR_OFFSET_N_TAGS   12
+
+/* Tag images are mapped in place, one per page: fails to compile if they differ */
+typedef char page_size_check[(NT3H_SIM_FILE_PAGE == sizeof(nt3h_sim_mem_t)) ? 1 : -1];
+
+/*!
+ * @brief This internal API maps a file and fills in the file structure.
+ *
+ * @param[out]     file : Pointer to file structure.
+ * @param[in]        fd : Open file descriptor, closed on return.
+ * @param[in]      size : Bytes to map.
+ * @param[in] read_only : Map privately instead of shared.
+ *
+ * @return API status code.
+ */
+static nt3h_status_t map(nt3h_sim_file_t *file, int fd, size_t size, bool read_only);
+
+/*!
+ * @brief This API creates a file of factory-fresh tags and maps it for writing.
+ */
+nt3h_status_t nt3h_sim_file_create(nt3h_sim_file_t *file, const char *path, size_t n_tags, bool is_2k,
+                                   uint64_t serial)
+{
+    nt3h_status_t rslt;
+
+    if (file == NULL || path == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (n_tags == 0 || n_tags > UINT32_MAX || n_tags > SIZE_MAX / NT3H_SIM_FILE_PAGE - 1)
+        return NT3H_E_INVALID_ARGS;
+
+    size_t size = NT3H_SIM_FILE_PAGE * (n_tags + 1);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+        return NT3H_E_NOT_FOUND;
+
+    if (ftruncate(fd, (off_t)size) != 0)
+    {
+        close(fd);
+        return NT3H_E_NO_SPACE;
+    }
+
+    if ((rslt = map(file, fd, size, false)) != NT3H_OK)
+        return rslt;
+
+    /* ftruncate() zero fills the file; every tag page is then written by its factory initialisation */
+    memcpy(file->base, NT3H_SIM_FILE_MAGIC, 4);
+    nt3h_put_le16(&file->base[HDR_OFFSET_VERSION], NT3H_SIM_FILE_VERSION);
+    nt3h_put_le32(&file->base[HDR_OFFSET_PAGE], NT3H_SIM_FILE_PAGE);
+    nt3h_put_le32(&file->base[HDR_OFFSET_N_TAGS], (uint32_t)n_tags);
+
+    for (size_t i = 0; i < n_tags && rslt == NT3H_OK; i++)
+    {
+        nt3h_sim_tag_t tag;
+
+        rslt = nt3h_sim_tag_init(&tag, &file->mems[i], is_2k, serial + i);
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API maps an existing file.
+ */
+nt3h_status_t nt3h_sim_file_open(nt3h_sim_file_t *file, const char *path, bool read_only)
+{
+    nt3h_status_t rslt;
+    struct stat st;
+
+    if (file == NULL || path == NULL)
+        return NT3H_E_NULL_PTR;
+
+    int fd = open(path, read_only ? O_RDONLY : O_RDWR);
+
+    if (fd < 0)
+        return NT3H_E_NOT_FOUND;
+
+    if (fstat(fd, &st) != 0 || st.st_size < NT3H_SIM_FILE_PAGE)
+    {
+        close(fd);
+        return NT3H_E_INVALID_ARGS;
+    }
+
+    if ((rslt = map(file, fd, (size_t)st.st_size, read_only)) != NT3H_OK)
+        return rslt;
+
+    const uint8_t *hdr = file->base;
+    uint32_t n_tags    = nt3h_get_le32(&hdr[HDR_OFFSET_N_TAGS]);
+
+    if (memcmp(hdr, NT3H_SIM_FILE_MAGIC, 4) != 0 ||
+        nt3h_get_le16(&hdr[HDR_OFFSET_VERSION]) != NT3H_SIM_FILE_VERSION ||
+        nt3h_get_le32(&hdr[HDR_OFFSET_PAGE]) != NT3H_SIM_FILE_PAGE ||
+        n_tags == 0 || n_tags > file->size / NT3H_SIM_FILE_PAGE - 1)
+    {
+        nt3h_sim_file_close(file);
+        return NT3H_E_INVALID_ARGS;
+    }
+
+    file->n_tags = n_tags;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API points tags at their images in a mapped file.
+ */
+nt3h_status_t nt3h_sim_file_attach(const nt3h_sim_file_t *file, nt3h_sim_tag_t *tags, size_t first, size_t n)
+{
+    if (file == NULL || file->mems == NULL || tags == NULL)
+        return NT3H_E_NULL_PTR;
+
+    if (first > file->n_tags || n > file->n_tags - first)
+        return NT3H_E_INVALID_ARGS;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        nt3h_sim_mem_t *mem = &file->mems[first + i];
+
+        memset(&tags[i], 0, sizeof(tags[i]));
+        tags[i].mem   = mem;
+        tags[i].is_2k = (mem->blocks[NT3H_SIM_META_BLOCK][NT3H_SIM_META_OFFSET_FLAGS] & NT3H_SIM_META_FLAG_2K) != 0;
+    }
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API writes changes back to the file.
+ */
+nt3h_status_t nt3h_sim_file_sync(const nt3h_sim_file_t *file)
+{
+    if (file == NULL || file->base == NULL)
+        return NT3H_E_NULL_PTR;
+
+    /* Private mappings have nothing to write back */
+    if (file->read_only)
+        return NT3H_OK;
+
+    if (msync(file->base, file->size, MS_SYNC) != 0)
+        return NT3H_E_NO_SPACE;
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This API unmaps a file.
+ */
+nt3h_status_t nt3h_sim_file_close(nt3h_sim_file_t *file)
+{
+    if (file == NULL || file->base == NULL)
+        return NT3H_E_NULL_PTR;
+
+    munmap(file->base, file->size);
+    memset(file, 0, sizeof(*file));
+
+    return NT3H_OK;
+}
+
+/*!
+ * @brief This internal API maps a file and fills in the file structure.
+ */
+static nt3h_status_t map(nt3h_sim_file_t *file, int fd, size_t size, bool read_only)
+{
+    /* Read-only files are still mapped writable, copy-on-write, so attached tags can run */
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, read_only ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+
+    /* The mapping keeps its own reference to the file */
+    close(fd);
+
+    if (base == MAP_FAILED)
+        return NT3H_E_NO_SPACE;
+
+    file->base      = base;
+    file->size      = size;
+    file->mems      = (nt3h_sim_mem_t *)(file->base + NT3H_SIM_FILE_PAGE);
+    file->n_tags    = size / NT3H_SIM_FILE_PAGE - 1;
+    file->read_only = read_only;
+
+    return NT3H_OK;
+}
@@ -0,0 +1,162 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_sim_file.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_sim_file.h
+ * @brief Memory-mapped persistent images of simulated tags.
+ *
+ * A fleet of simulated tags is stored in one file that is mapped into
+ * memory and used in place, so state survives restarts and opening is
+ * instant however many tags the file holds: no tag is read until it is
+ * accessed. Several processes may map the same file; writable mappings
+ * share changes, read-only mappings see the file and keep any changes
+ * they make private (copy-on-write). POSIX hosts only.
+ *
+ * All header fields are little endian. Each tag occupies one page, so
+ * tag images are page aligned:
+ *
+ *   Header (NT3H_SIM_FILE_PAGE bytes)
+ *     [0..3]   magic "NT3S"
+ *     [4..5]   format version (NT3H_SIM_FILE_VERSION)
+ *     [6..7]   reserved, zero
+ *     [8..11]  page size, NT3H_SIM_FILE_PAGE
+ *     [12..15] number of tags, n
+ *     [16..]   reserved, zero
+ *
+ *   Tag i at offset NT3H_SIM_FILE_PAGE * (i + 1), for i = 0 to n - 1
+ *     The I2C address space, 256 blocks of 16 bytes in block order
+ *     (nt3h_sim_mem_t):
+ *     0x00         serial number, static lock bytes and CC
+ *     0x01-0x37    user memory (1K), 0x01-0x77 (2K)
+ *     0x38-0x3A    dynamic lock bytes and configuration (1K), 0x78-0x7A (2K)
+ *     0xF8-0xFB    SRAM
+ *     0xFE         session registers in bytes 0-7
+ *     0xFF         simulator metadata, byte 0 bit 0 set for a 2K part
+ *     Other blocks are unused and zero.
+ *
+ * Only memory is persisted. Bus pointers and in-flight EEPROM programs are
+ * per-process tag state and start idle when tags are attached.
+ */
+
+#ifndef _NT3H_SIM_FILE_H_
+#define _NT3H_SIM_FILE_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "nt3h_sim.h"
+
+#define NT3H_SIM_FILE_MAGIC     "NT3S"
+#define NT3H_SIM_FILE_VERSION   1
+#define NT3H_SIM_FILE_PAGE      4096    /* Header size, equal to sizeof(nt3h_sim_mem_t) */
+
+/*
+ * @brief Mapped simulator file.
+ */
+typedef struct {
+
+    /* Mapping of the whole file */
+    uint8_t *base;
+    size_t size;
+
+    /* Tag images within the mapping */
+    nt3h_sim_mem_t *mems;
+    size_t n_tags;
+
+    /* Changes stay private to this process */
+    bool read_only;
+
+} nt3h_sim_file_t;
+
+/*!
+ * @brief This API creates a file of factory-fresh tags and maps it for writing.
+ *
+ * @note An existing file at path is replaced.
+ *
+ * @param[out]   file : Pointer to file structure.
+ * @param[in]    path : File path.
+ * @param[in]  n_tags : Number of tags.
+ * @param[in]   is_2k : Simulate 2K parts.
+ * @param[in]  serial : Serial number of the first tag, incremented for each tag.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_file_create(nt3h_sim_file_t *file, const char *path, size_t n_tags, bool is_2k,
+                                   uint64_t serial);
+
+/*!
+ * @brief This API maps an existing file.
+ *
+ * @param[out]      file : Pointer to file structure.
+ * @param[in]       path : File path.
+ * @param[in] read_only : Map without write access to the file; changes made
+ *                        through the mapping stay private to this process.
+ *
+ * @return API status code, NT3H_E_NOT_FOUND if the file cannot be opened,
+ *         NT3H_E_INVALID_ARGS if it is not a simulator file.
+ */
+nt3h_status_t nt3h_sim_file_open(nt3h_sim_file_t *file, const char *path, bool read_only);
+
+/*!
+ * @brief This API points tags at their images in a mapped file.
+ *
+ * @note The memory images are used as they are, without a power cycle.
+ *
+ * @param[in]   file : Pointer to file structure.
+ * @param[out]  tags : Tags to attach.
+ * @param[in]  first : Index in the file of the first tag.
+ * @param[in]      n : Number of tags.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_file_attach(const nt3h_sim_file_t *file, nt3h_sim_tag_t *tags, size_t first, size_t n);
+
+/*!
+ * @brief This API writes changes back to the file.
+ *
+ * @param[in] file : Pointer to file structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_file_sync(const nt3h_sim_file_t *file);
+
+/*!
+ * @brief This API unmaps a file, tags attached to it must no longer be used.
+ *
+ * @param[in,out] file : Pointer to file structure.
+ *
+ * @return API status code.
+ */
+nt3h_status_t nt3h_sim_file_close(nt3h_sim_file_t *file);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* NT3H_SIM_FILE_H_ */
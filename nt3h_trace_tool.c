@@ -0,0 +1,246 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_trace_tool.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_trace_tool.c
+ * @brief Host tool to summarise and replay captured bus traces.
+ *
+ * A trace is the linear buffer written by nt3h_trace_export(), saved to a
+ * file. The tool prints the nt3h_trace_summarise() totals, then replays the
+ * trace with nt3h_trace_replay() against freshly initialised simulated
+ * tags, one per dev_id seen in the trace, and reports the reads and
+ * statuses which differ from the capture. With "timed" the gaps between
+ * records are reproduced on the virtual clock, so reads issued while an
+ * EEPROM program is in progress see the same NAKs as on the bench.
+ *
+ * "record" captures an example trace from a simulated tag: init, format,
+ * a multi-block write and read back, and a session register update.
+ * Replaying it against a tag of the same variant reports no mismatches.
+ *
+ * Build on a POSIX host:
+ *   cc -O2 -DNT3H_ENABLE_TRACE nt3h_trace_tool.c nt3h_sim.c nt3h.c -o nt3h_trace_tool
+ *   ./nt3h_trace_tool record <file> [2k]
+ *   ./nt3h_trace_tool replay <file> [2k] [timed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nt3h_sim.h"
+
+#ifndef NT3H_ENABLE_TRACE
+#error "nt3h_trace_tool needs the driver built with NT3H_ENABLE_TRACE"
+#endif
+
+#define TOOL_TRACE_SIZE     (64U * 1024U)
+#define TOOL_RECORD_LEN     100
+#define TOOL_SERIAL         0x04A1B2C3D4E5F6ULL
+
+/*!
+ * @brief This internal API reads a whole file into a new buffer.
+ */
+static uint8_t *load_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf = NULL;
+    long size;
+
+    if (f == NULL)
+        return NULL;
+
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0 &&
+        (buf = malloc(size ? (size_t)size : 1U)) != NULL)
+    {
+        if (fread(buf, 1, (size_t)size, f) == (size_t)size)
+        {
+            *len = (size_t)size;
+        }
+        else
+        {
+            free(buf);
+            buf = NULL;
+        }
+    }
+
+    fclose(f);
+
+    return buf;
+}
+
+/*!
+ * @brief This internal API captures an example trace from a simulated tag.
+ */
+static int trace_record_example(const char *path, bool is_2k)
+{
+    static nt3h_sim_mem_t mem;
+    static uint8_t ring[TOOL_TRACE_SIZE];
+    static uint8_t out[TOOL_TRACE_SIZE];
+    nt3h_sim_tag_t tag;
+    nt3h_sim_shard_t shard;
+    nt3h_trace_t trace;
+    nt3h_dev_t dev;
+    uint8_t data[TOOL_RECORD_LEN];
+    size_t n_out = 0;
+    nt3h_status_t rslt;
+
+    memset(&dev, 0, sizeof(dev));
+    nt3h_sim_tag_init(&tag, &mem, is_2k, TOOL_SERIAL);
+    nt3h_sim_shard_init(&shard, &tag, 1);
+    nt3h_sim_bind(&shard);
+    nt3h_sim_dev_init(&dev, 0);
+    nt3h_trace_init(&trace, ring, sizeof(ring));
+    dev.trace = &trace;
+
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)i;
+
+    if ((rslt = nt3h_init(&dev)) == NT3H_OK &&
+        (rslt = nt3h_format(&dev, is_2k)) == NT3H_OK &&
+        (rslt = nt3h_write_bytes(&dev, NTAG_MEM_BLOCK_START_USER_MEMORY, 4, data, sizeof(data))) == NT3H_OK &&
+        (rslt = nt3h_read_bytes(&dev, NTAG_MEM_BLOCK_START_USER_MEMORY, 4, data, sizeof(data))) == NT3H_OK &&
+        (rslt = nt3h_set_watchdog_us(&dev, NT3H_REG_SESSION, 20000)) == NT3H_OK)
+        rslt = nt3h_trace_export(&trace, out, sizeof(out), &n_out);
+
+    nt3h_sim_bind(NULL);
+
+    if (rslt != NT3H_OK || trace.dropped != 0)
+    {
+        fprintf(stderr, "record failed: status %d, %lu records dropped\n", rslt, (unsigned long)trace.dropped);
+        return -1;
+    }
+
+    FILE *f = fopen(path, "wb");
+
+    if (f == NULL || fwrite(out, 1, n_out, f) != n_out)
+    {
+        if (f != NULL)
+            fclose(f);
+        fprintf(stderr, "cannot write %s\n", path);
+        return -1;
+    }
+
+    fclose(f);
+    printf("%lu records, %zu bytes written to %s\n", (unsigned long)trace.records, n_out, path);
+
+    return 0;
+}
+
+/*!
+ * @brief This internal API summarises a trace file and replays it against simulated tags.
+ */
+static int trace_replay_file(const char *path, bool is_2k, bool timed)
+{
+    static nt3h_sim_mem_t mems[NT3H_SIM_MAX_TAGS];
+    static nt3h_sim_tag_t tags[NT3H_SIM_MAX_TAGS];
+    nt3h_sim_shard_t shard;
+    nt3h_trace_summary_t sum;
+    nt3h_trace_record_t rec;
+    nt3h_dev_t dev;
+    size_t len = 0, pos = 0, n_tags = 0;
+    uint32_t mismatches = 0;
+    nt3h_status_t rslt;
+
+    uint8_t *buf = load_file(path, &len);
+
+    if (buf == NULL)
+    {
+        fprintf(stderr, "cannot read %s\n", path);
+        return -1;
+    }
+
+    /* Simulate every dev_id up to the highest one addressed */
+    while (nt3h_trace_next(buf, len, &pos, &rec))
+        if ((size_t)rec.dev_id + 1U > n_tags)
+            n_tags = (size_t)rec.dev_id + 1U;
+
+    if (pos != len)
+        fprintf(stderr, "warning: %zu trailing bytes are not a whole record\n", len - pos);
+
+    nt3h_trace_summarise(buf, len, &sum);
+
+    printf("%10s %10s %10s %12s %12s %12s %12s %8s\n", "writes", "reads", "errors", "block_writes",
+           "bytes_wr", "bytes_rd", "span_us", "tags");
+    printf("%10lu %10lu %10lu %12lu %12lu %12lu %12lu %8zu\n", (unsigned long)sum.writes,
+           (unsigned long)sum.reads, (unsigned long)sum.errors, (unsigned long)sum.block_writes,
+           (unsigned long)sum.bytes_written, (unsigned long)sum.bytes_read, (unsigned long)sum.span_us, n_tags);
+
+    if (n_tags == 0)
+    {
+        free(buf);
+        return 0;
+    }
+
+    for (size_t i = 0; i < n_tags; i++)
+        nt3h_sim_tag_init(&tags[i], &mems[i], is_2k, TOOL_SERIAL + i);
+
+    nt3h_sim_shard_init(&shard, tags, n_tags);
+    nt3h_sim_bind(&shard);
+
+    /* The replay drives the bus callbacks directly, any dev_id will do */
+    memset(&dev, 0, sizeof(dev));
+    nt3h_sim_dev_init(&dev, 0);
+
+    rslt = nt3h_trace_replay(buf, len, &dev, timed, &mismatches);
+
+    printf("\nreplay %s against %zu %s tag(s): %lu mismatches, %llu naks, %.1f ms virtual\n",
+           timed ? "timed" : "untimed", n_tags, is_2k ? "2K" : "1K", (unsigned long)mismatches,
+           (unsigned long long)shard.naks, (double)shard.now_ns / 1e6);
+
+    nt3h_sim_bind(NULL);
+    free(buf);
+
+    return (rslt == NT3H_OK && mismatches == 0) ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    bool is_2k = false, timed = false;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s record <file> [2k]\n       %s replay <file> [2k] [timed]\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "2k") == 0)
+            is_2k = true;
+        else if (strcmp(argv[i], "timed") == 0)
+            timed = true;
+    }
+
+    if (strcmp(argv[1], "record") == 0)
+        return (trace_record_example(argv[2], is_2k) == 0) ? 0 : 1;
+
+    if (strcmp(argv[1], "replay") == 0)
+        return (trace_replay_file(argv[2], is_2k, timed) == 0) ? 0 : 1;
+
+    fprintf(stderr, "unknown command %s\n", argv[1]);
+
+    return 2;
+}
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nt3h_util.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nt3h_util.h
+ * @brief Internal helpers shared by the NT3H modules, not part of the public API.
+ */
+#ifndef _NT3H_UTIL_H_
+#define _NT3H_UTIL_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "nt3h.h"
+
+/*!
+ * @brief This internal API computes the CRC-8 (polynomial 0x07) of a block,
+ * skipping the byte that holds the CRC itself.
+ *
+ * @param[in] block : Block data.
+ * @param[in] skip  : Offset of the CRC byte within the block.
+ *
+ * @return CRC-8 of the remaining bytes.
+ */
+static inline uint8_t nt3h_block_crc8(const uint8_t *block, uint8_t skip)
+{
+    uint8_t crc = 0;
+
+    for (uint8_t i = 0; i < NTAG_I2C_BLOCK_SIZE; i++)
+    {
+        if (i == skip)
+            continue;
+
+        crc ^= block[i];
+
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (uint8_t)((crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1));
+    }
+
+    return crc;
+}
+
+/*!
+ * @brief Little endian field helpers, for byte aligned file and image formats.
+ */
+static inline void nt3h_put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void nt3h_put_le32(uint8_t *p, uint32_t v)
+{
+    nt3h_put_le16(p, (uint16_t)v);
+    nt3h_put_le16(&p[2], (uint16_t)(v >> 16));
+}
+
+static inline uint16_t nt3h_get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t nt3h_get_le32(const uint8_t *p)
+{
+    return (uint32_t)nt3h_get_le16(p) | ((uint32_t)nt3h_get_le16(&p[2]) << 16);
+}
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* NT3H_UTIL_H_ */
@@ -65,6 +65,8 @@
 #define NTAG_NC_REG_MASK_SRAM_MIRROR_ON_OFF 0x02
 #define NTAG_NC_REG_MASK_TRANSFER_DIR       0x01
 
+#define NTAG_I2C_CLOCK_STR_MASK_ON_OFF      0x01
+
 #define NTAG_REG_LOCK_MASK_CONF_BYTES_ACCESS_I2C    0x02
 #define NTAG_REG_LOCK_MASK_CONF_BYTES_ACCESS_RF     0x01
 